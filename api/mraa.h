@@ -35,6 +35,8 @@ extern "C" {
 #include "mraa/uart.h"
 #include "mraa/uart_ow.h"
 #include "mraa/led.h"
+#include "mraa/led_strip.h"
+#include "mraa/sampler.h"
 
 #ifdef __cplusplus
 }
@@ -32,3 +32,4 @@
 #include "mraa/spi.hpp"
 #include "mraa/uart.hpp"
 #include "mraa/led.hpp"
+#include "mraa/led_strip.hpp"
@@ -104,6 +104,15 @@ typedef enum {
     MRAA_GPIO_PUSH_PULL = 1,  /**< Push Pull Configuration */
 } mraa_gpio_out_driver_mode_t;
 
+/**
+ * Clock used to timestamp edge events
+ */
+typedef enum {
+    MRAA_GPIO_EVENT_CLOCK_MONOTONIC = 0, /**< Default. CLOCK_MONOTONIC */
+    MRAA_GPIO_EVENT_CLOCK_REALTIME = 1,  /**< CLOCK_REALTIME */
+    MRAA_GPIO_EVENT_CLOCK_HTE = 2        /**< Hardware timestamp engine, if the chip has one */
+} mraa_gpio_event_clock_t;
+
 typedef long long unsigned int mraa_timestamp_t;
 
 /**
@@ -116,6 +125,17 @@ typedef struct {
 
 typedef mraa_gpio_event* mraa_gpio_events_t;
 
+/**
+ * Gpio edge event as queued by the chardev interface
+ */
+typedef struct {
+    int id; /**< pin id, as provided at init */
+    mraa_timestamp_t timestamp; /**< kernel timestamp of the edge in nanoseconds */
+    mraa_gpio_edge_t edge; /**< MRAA_GPIO_EDGE_RISING or MRAA_GPIO_EDGE_FALLING */
+    unsigned int seqno; /**< kernel sequence number across the pins of the chip, 0 if unsupported */
+    unsigned int line_seqno; /**< kernel sequence number of the pin, 0 if unsupported */
+} mraa_gpio_edge_event;
+
 /**
  * Initialise gpio_context, based on board number
  *
@@ -142,6 +162,19 @@ mraa_gpio_context mraa_gpio_init_multi(int pins[], int num_pins);
  */
 mraa_gpio_context mraa_gpio_init_raw(int gpiopin);
 
+/**
+ * Initialise one gpio context per pin, based on board numbers. On sysfs
+ * platforms all pins are exported in one pass and their 'value' nodes are
+ * then waited for together, which is much faster than calling
+ * mraa_gpio_init() for each pin. Either all pins are initialised or none.
+ *
+ * @param pins Pin array read from the board
+ * @param num_pins Number of pins in the pins array
+ * @return Array of num_pins gpio contexts or NULL. Close every context with
+ * mraa_gpio_close() and free() the array itself when done.
+ */
+mraa_gpio_context* mraa_gpio_init_bulk(int pins[], int num_pins);
+
 /**
  * Set the edge mode on the gpio
  *
@@ -163,6 +196,18 @@ mraa_result_t mraa_gpio_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode);
  */
 mraa_result_t mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t edge, void (*fptr)(void*), void* args);
 
+/**
+ * Deliver interrupts of subsequently registered isrs from a shared pool of
+ * epoll event loop threads instead of one thread per context. Contexts whose
+ * platform replaces the interrupt wait loop keep using a dedicated thread.
+ * Can only be changed while no isr is registered through the dispatcher, and
+ * not from within a dispatched isr.
+ *
+ * @param num_threads Number of event loop threads, 0 to disable the dispatcher
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_isr_dispatcher(unsigned int num_threads);
+
 /**
  * Get an array of structures describing triggered events.
  *
@@ -173,6 +218,72 @@ mraa_result_t mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t edge, void (
  */
 mraa_gpio_events_t mraa_gpio_get_events(mraa_gpio_context dev);
 
+/**
+ * Drain queued edge events of all pins of the context, oldest first. Every
+ * edge reported by the kernel is kept in a bounded per pin queue until read,
+ * so bursts are not lost between two interrupts. If no isr is running the
+ * kernel queues are read directly. Only available on the chardev interface,
+ * once an edge mode has been set. Concurrent callers are serialized, each
+ * event is returned to exactly one of them. Fails while a capture runs on
+ * the context, the capture consumes the events.
+ *
+ * @param dev The Gpio context
+ * @param buf Array receiving the events
+ * @param max Length of buf
+ * @return Number of events stored in buf, or -1 on error
+ */
+int mraa_gpio_read_events(mraa_gpio_context dev, mraa_gpio_edge_event* buf, int max);
+
+/**
+ * Get the number of edge events dropped because a per pin queue was full.
+ *
+ * @param dev The Gpio context
+ * @return Number of dropped events
+ */
+unsigned long mraa_gpio_get_events_overflow(mraa_gpio_context dev);
+
+/**
+ * Filter edges of input pins in the kernel, an edge is only reported once the
+ * level has been stable for the given period. Requires the GPIO v2 chardev
+ * uAPI (linux 5.10+) and applies to already requested pins right away.
+ *
+ * @param dev The Gpio context
+ * @param period_us Debounce period in microseconds, 0 disables debouncing
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_debounce(mraa_gpio_context dev, unsigned int period_us);
+
+/**
+ * Select the clock edge event timestamps are taken from. Requires the GPIO v2
+ * chardev uAPI, hardware timestamps additionally need kernel and chip support.
+ *
+ * @param dev The Gpio context
+ * @param clock Clock to use
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_event_clock(mraa_gpio_context dev, mraa_gpio_event_clock_t clock);
+
+/**
+ * Drop edges in software before the isr is called, on any platform. An edge
+ * of a pin is held back and only delivered once the pin stayed at the new
+ * level for the hold time; if it goes back before that, both edges are
+ * dropped as a glitch. Contact bounce thus ends in a single edge to the final
+ * level, delivered one hold time after the last bounce. Rising and falling
+ * edges can use different hold times for hysteresis, 0 falls back to
+ * stable_us. With a single edge mode every edge restarts the hold time.
+ *
+ * @param dev The Gpio context
+ * @param stable_us Time the pin has to be stable before an edge is delivered,
+ * in microseconds, all three 0 disables the filter
+ * @param rising_us Time the pin has to stay high after a rising edge, 0 for stable_us
+ * @param falling_us Time the pin has to stay low after a falling edge, 0 for stable_us
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_glitch_filter(mraa_gpio_context dev,
+                                      unsigned int stable_us,
+                                      unsigned int rising_us,
+                                      unsigned int falling_us);
+
 /**
  * Stop the current interrupt watcher on this Gpio, and set the Gpio edge mode
  * to MRAA_GPIO_EDGE_NONE(only for sysfs interface).
@@ -258,6 +369,124 @@ mraa_result_t mraa_gpio_write(mraa_gpio_context dev, int value);
  */
 mraa_result_t mraa_gpio_write_multi(mraa_gpio_context dev, int input_values[]);
 
+/**
+ * Write a subset of the pins of a multi pin context at once. Bit i of mask and
+ * values refers to the i-th pin given to mraa_gpio_init_multi(). With memory
+ * mapped gpio enabled (mraa_gpio_use_mmaped()) pins sharing a register bank
+ * change with a single set and a single clear register store, on the chardev
+ * interface with one ioctl per gpio chip.
+ *
+ * @param dev The Gpio context
+ * @param mask Pins to write, only the first 32 pins can be addressed
+ * @param values Levels for the pins selected in mask
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_write_mask(mraa_gpio_context dev, uint32_t mask, uint32_t values);
+
+/**
+ * Read a subset of the pins of a multi pin context, sampling pins that share
+ * a register bank (or gpio chip) at the same time.
+ *
+ * @param dev The Gpio context
+ * @param mask Pins to read, only the first 32 pins can be addressed
+ * @param values Receives the levels, bit i for the i-th pin, unselected bits are 0
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_read_mask(mraa_gpio_context dev, uint32_t mask, uint32_t* values);
+
+/**
+ * Pulse statistics of one pin over a capture window
+ */
+typedef struct {
+    int id;                  /**< pin id, as provided at init */
+    unsigned int edges;      /**< number of edges seen */
+    unsigned int periods;    /**< number of complete periods */
+    uint64_t period_min_ns;  /**< shortest period */
+    uint64_t period_max_ns;  /**< longest period */
+    uint64_t period_mean_ns; /**< average period */
+    unsigned int pulses;     /**< number of complete high pulses, needs both edges */
+    uint64_t width_min_ns;   /**< shortest high pulse */
+    uint64_t width_max_ns;   /**< longest high pulse */
+    uint64_t width_mean_ns;  /**< average high pulse */
+    double frequency_hz;     /**< periods per second */
+    double duty_cycle;       /**< high time over high plus low time, 0 to 1, needs both edges */
+} mraa_gpio_capture_stats;
+
+/**
+ * One level change of a waveform
+ */
+typedef struct {
+    uint32_t mask;      /**< pins to change, as for mraa_gpio_write_mask() */
+    uint32_t values;    /**< levels of the pins selected in mask */
+    uint64_t offset_ns; /**< time of the change from the start of the waveform */
+} mraa_gpio_wave_step;
+
+/**
+ * Timing achieved while playing a waveform
+ */
+typedef struct {
+    unsigned int num_writes; /**< register stores or ioctls issued */
+    uint64_t max_late_ns;    /**< worst delay of a write past its offset */
+    uint64_t mean_late_ns;   /**< average delay of a write past its offset */
+    uint64_t duration_ns;    /**< total time taken */
+} mraa_gpio_wave_stats;
+
+/**
+ * Play a precomputed waveform on the pins of a (multi pin) context. The steps
+ * are played on a dedicated thread that is given the real time priority (see
+ * mraa_set_priority()). It sleeps on CLOCK_MONOTONIC until about 100us before
+ * each step and busy waits the rest, so long gaps don't hog a cpu. If all
+ * used pins are memory mapped (mraa_gpio_use_mmaped()) the steps are turned
+ * into bank register stores before playback starts, otherwise every step is a
+ * mraa_gpio_write_mask() call, i.e. one ioctl per gpio chip on chardev. The
+ * call blocks until the waveform is done.
+ *
+ * @param dev The Gpio context
+ * @param steps Level changes, sorted by offset_ns
+ * @param num_steps Number of steps
+ * @param priority Real time priority of the player thread, 0 keeps the default
+ * @param stats Receives the achieved timing, may be NULL
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_play_waveform(mraa_gpio_context dev,
+                                      const mraa_gpio_wave_step* steps,
+                                      unsigned int num_steps,
+                                      int priority,
+                                      mraa_gpio_wave_stats* stats);
+
+/**
+ * Start measuring pulses on all pins of the context in the background. Edge
+ * timestamps taken by the kernel are accumulated by the context's isr (a
+ * dedicated thread or the shared dispatcher), so no user code runs per edge.
+ * Only available on the chardev interface. The capture takes the isr of the
+ * context, mraa_gpio_isr_exit() stops it as well. mraa_gpio_read_events() is
+ * refused while it runs.
+ *
+ * @param dev The Gpio context
+ * @param edges Edges to timestamp, MRAA_GPIO_EDGE_BOTH is needed for pulse widths and duty cycle
+ * @param window_ms Length of a measurement window, 0 accumulates from one read to the next
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_capture_start(mraa_gpio_context dev, mraa_gpio_edge_t edges, unsigned int window_ms);
+
+/**
+ * Get pulse statistics. With a window length the stats of the last completed
+ * window are returned, otherwise everything since the previous read.
+ *
+ * @param dev The Gpio context
+ * @param stats Array with one entry per pin of the context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_capture_read(mraa_gpio_context dev, mraa_gpio_capture_stats stats[]);
+
+/**
+ * Stop a capture started with mraa_gpio_capture_start().
+ *
+ * @param dev The Gpio context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_capture_stop(mraa_gpio_context dev);
+
 /**
  * Change ownership of the context.
  *
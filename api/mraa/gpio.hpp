@@ -29,9 +29,9 @@
 #include <stdexcept>
 
 #if defined(SWIGJAVASCRIPT)
-#if NODE_MODULE_VERSION >= 0x000D
-#include <uv.h>
-#endif
+#include "javascript/mraajs_async.hpp"
+#elif defined(SWIGPYTHON)
+#include "python/mraapy.h"
 #endif
 
 namespace mraa
@@ -85,6 +85,32 @@ typedef enum {
     MODE_OUT_PUSH_PULL = 1,  /**< Push Pull Configuration */
 } OutputMode;
 
+/**
+ * Clocks used to timestamp edge events
+ */
+typedef enum {
+    EVENT_CLOCK_MONOTONIC = 0, /**< Default. CLOCK_MONOTONIC */
+    EVENT_CLOCK_REALTIME = 1,  /**< CLOCK_REALTIME */
+    EVENT_CLOCK_HTE = 2        /**< Hardware timestamp engine */
+} EventClock;
+
+/**
+ * Pulse statistics over a capture window, see Gpio::captureStart()
+ */
+struct CaptureStats {
+    unsigned int edges;     /**< number of edges seen */
+    unsigned int periods;   /**< number of complete periods */
+    uint64_t periodMinNs;   /**< shortest period */
+    uint64_t periodMaxNs;   /**< longest period */
+    uint64_t periodMeanNs;  /**< average period */
+    unsigned int pulses;    /**< number of complete high pulses */
+    uint64_t widthMinNs;    /**< shortest high pulse */
+    uint64_t widthMaxNs;    /**< longest high pulse */
+    uint64_t widthMeanNs;   /**< average high pulse */
+    double frequencyHz;     /**< periods per second */
+    double dutyCycle;       /**< high time over high plus low time, 0 to 1 */
+};
+
 /**
  * @brief API to General Purpose IO
  *
@@ -161,48 +187,90 @@ class Gpio
     {
         return (Result) mraa_gpio_isr(m_gpio, (mraa_gpio_edge_t) mode, (void (*) (void*)) pyfunc, (void*) args);
     }
+
+    /**
+     * Sets a callback called with lists of (pin, timestamp, edge) tuples.
+     * Edges are collected natively and pyfunc is called, with the GIL taken
+     * once, when maxEvents edges are pending or maxLatencyUs after the first
+     * of them. Timestamps are in nanoseconds, on sysfs only the latest edge of
+     * each pin per wakeup is seen and the edge is the mode passed here. With
+     * pyfunc None edges are only buffered for readEvents(). Ended by isrExit().
+     *
+     * @param mode The edge mode to set
+     * @param pyfunc Callable taking one list, or None
+     * @param maxEvents Number of pending edges that trigger a call
+     * @param maxLatencyUs Longest time an edge waits for its call
+     * @return Result of operation
+     */
+    Result
+    isrBatch(Edge mode, PyObject* pyfunc, unsigned int maxEvents = 64, unsigned int maxLatencyUs = 1000)
+    {
+        return (Result) mraa_python_isr_batch(m_gpio, (mraa_gpio_edge_t) mode, pyfunc, maxEvents, maxLatencyUs);
+    }
+
+    /**
+     * Take edges buffered by isrBatch() that were not delivered yet
+     *
+     * @param max Most edges to return
+     * @return List of (pin, timestamp, edge) tuples, empty if none are pending
+     */
+    PyObject*
+    readEvents(int max = 256)
+    {
+        return mraa_python_read_events(m_gpio, max);
+    }
 #elif defined(SWIGJAVASCRIPT)
     static void
-    v8isr(uv_work_t* req, int status)
+    v8isr(void* owner, const unsigned char* events, unsigned int count)
     {
 #if NODE_MODULE_VERSION >= 0x000D
         v8::HandleScope scope(v8::Isolate::GetCurrent());
 #endif
-        mraa::Gpio* This = (mraa::Gpio*) req->data;
+        mraa::Gpio* This = (mraa::Gpio*) owner;
+        if (This->m_v8isr.IsEmpty()) {
+            return;
+        }
+        // isr(): one call per edge with -1 as before, isrBatch(): one call per
+        // wakeup of the loop with the number of edges it covers
+        unsigned int calls = This->m_v8batch ? 1 : count;
         int argc = 1;
-        v8::Local<v8::Value> argv[] = { SWIGV8_INTEGER_NEW(-1) };
+        v8::Local<v8::Value> argv[] = { SWIGV8_INTEGER_NEW(This->m_v8batch ? (int) count : -1) };
 #if NODE_MODULE_VERSION >= 0x000D
         v8::Local<v8::Function> f = v8::Local<v8::Function>::New(v8::Isolate::GetCurrent(), This->m_v8isr);
-        f->Call(SWIGV8_CURRENT_CONTEXT()->Global(), argc, argv);
+#endif
+        for (unsigned int i = 0; i < calls && !This->m_v8isr.IsEmpty(); ++i) {
+#if NODE_MODULE_VERSION >= 0x000D
+            f->Call(SWIGV8_CURRENT_CONTEXT()->Global(), argc, argv);
 #else
-        This->m_v8isr->Call(SWIGV8_CURRENT_CONTEXT()->Global(), argc, argv);
+            This->m_v8isr->Call(SWIGV8_CURRENT_CONTEXT()->Global(), argc, argv);
 #endif
-        delete req;
+        }
     }
 
     static void
-    nop(uv_work_t* req)
+    uvpush(void* ctx)
     {
-        // Do nothing.
+        ((mraa::Gpio*) ctx)->m_uvchannel.push(1);
     }
 
-    static void
-    uvwork(void* ctx)
+    Result
+    isr(Edge mode, v8::Handle<v8::Function> func)
     {
-        uv_work_t* req = new uv_work_t;
-        req->data = ctx;
-        uv_queue_work(uv_default_loop(), req, nop, v8isr);
+        return v8isrStart(mode, func, false);
     }
 
+    /**
+     * Like isr(), but edges arriving before the event loop gets to run are
+     * folded into one call, which receives the number of edges it covers
+     *
+     * @param mode The edge mode to set
+     * @param func Function taking the number of edges
+     * @return Result of operation
+     */
     Result
-    isr(Edge mode, v8::Handle<v8::Function> func)
+    isrBatch(Edge mode, v8::Handle<v8::Function> func)
     {
-#if NODE_MODULE_VERSION >= 0x000D
-        m_v8isr.Reset(v8::Isolate::GetCurrent(), func);
-#else
-        m_v8isr = v8::Persistent<v8::Function>::New(func);
-#endif
-        return (Result) mraa_gpio_isr(m_gpio, (mraa_gpio_edge_t) mode, &uvwork, this);
+        return v8isrStart(mode, func, true);
     }
 #elif defined(SWIGJAVA) || defined(JAVACALLBACK)
     Result
@@ -226,6 +294,19 @@ class Gpio
         return (Result) mraa_gpio_isr(m_gpio, (mraa_gpio_edge_t) mode, fptr, args);
     }
 
+    /**
+     * Serve isrs registered from now on with a shared pool of event loop
+     * threads instead of one thread per Gpio
+     *
+     * @param numThreads Number of event loop threads, 0 disables the pool
+     * @return Result of operation
+     */
+    static Result
+    isrDispatcher(unsigned int numThreads)
+    {
+        return (Result) mraa_gpio_isr_dispatcher(numThreads);
+    }
+
     /**
      * Exits callback - this call will not kill the isr thread immediately
      * but only when it is out of it's critical section
@@ -236,15 +317,116 @@ class Gpio
     isrExit()
     {
 #if defined(SWIGJAVASCRIPT)
+        Result ret = (Result) mraa_gpio_isr_exit(m_gpio);
+        // the isr thread is gone, edges still queued are dropped
+        m_uvchannel.close();
 #if NODE_MODULE_VERSION >= 0x000D
         m_v8isr.Reset();
 #else
         m_v8isr.Dispose();
         m_v8isr.Clear();
 #endif
-#endif
+        return ret;
+#else
         return (Result) mraa_gpio_isr_exit(m_gpio);
+#endif
     }
+    /**
+     * Debounce edges of input pins in the kernel, needs the GPIO v2 chardev
+     * interface
+     *
+     * @param periodUs Debounce period in microseconds, 0 disables it
+     * @return Result of operation
+     */
+    Result
+    debounce(unsigned int periodUs)
+    {
+        return (Result) mraa_gpio_debounce(m_gpio, periodUs);
+    }
+
+    /**
+     * Drop edges in software before the isr is called, an edge is only
+     * delivered once its pin stayed at the new level for the hold time
+     *
+     * @param stableUs Time a pin has to be stable in microseconds, all 0 disables the filter
+     * @param risingUs Time a pin has to stay high after a rising edge, 0 for stableUs
+     * @param fallingUs Time a pin has to stay low after a falling edge, 0 for stableUs
+     * @return Result of operation
+     */
+    Result
+    glitchFilter(unsigned int stableUs, unsigned int risingUs = 0, unsigned int fallingUs = 0)
+    {
+        return (Result) mraa_gpio_glitch_filter(m_gpio, stableUs, risingUs, fallingUs);
+    }
+
+    /**
+     * Select the clock edge events are timestamped with, needs the GPIO v2
+     * chardev interface
+     *
+     * @param clock The clock to use
+     * @return Result of operation
+     */
+    Result
+    eventClock(EventClock clock)
+    {
+        return (Result) mraa_gpio_event_clock(m_gpio, (mraa_gpio_event_clock_t) clock);
+    }
+
+    /**
+     * Start measuring pulses in the background from kernel edge timestamps,
+     * chardev interface only. Takes the isr of the Gpio.
+     *
+     * @param edges Edges to timestamp, EDGE_BOTH is needed for widths and duty cycle
+     * @param windowMs Measurement window, 0 accumulates from one read to the next
+     * @return Result of operation
+     */
+    Result
+    captureStart(Edge edges, unsigned int windowMs)
+    {
+        return (Result) mraa_gpio_capture_start(m_gpio, (mraa_gpio_edge_t) edges, windowMs);
+    }
+
+    /**
+     * Get the pulse statistics of the last window, or since the last read
+     *
+     * @throw std::runtime_error if no capture is running
+     * @return Pulse statistics
+     */
+    CaptureStats
+    captureRead()
+    {
+        mraa_gpio_capture_stats st;
+        CaptureStats stats;
+
+        if (mraa_gpio_capture_read(m_gpio, &st) != MRAA_SUCCESS) {
+            throw std::runtime_error("Failed to read capture");
+        }
+
+        stats.edges = st.edges;
+        stats.periods = st.periods;
+        stats.periodMinNs = st.period_min_ns;
+        stats.periodMaxNs = st.period_max_ns;
+        stats.periodMeanNs = st.period_mean_ns;
+        stats.pulses = st.pulses;
+        stats.widthMinNs = st.width_min_ns;
+        stats.widthMaxNs = st.width_max_ns;
+        stats.widthMeanNs = st.width_mean_ns;
+        stats.frequencyHz = st.frequency_hz;
+        stats.dutyCycle = st.duty_cycle;
+        return stats;
+    }
+
+    /**
+     * Stop a running capture
+     *
+     * @return Result of operation
+     */
+    Result
+    captureStop()
+    {
+        return (Result) mraa_gpio_capture_stop(m_gpio);
+    }
+
     /**
      * Change Gpio mode
      *
@@ -360,6 +542,27 @@ class Gpio
     mraa_gpio_context m_gpio;
 #if defined(SWIGJAVASCRIPT)
     v8::Persistent<v8::Function> m_v8isr;
+    bool m_v8batch;
+    UvChannel<unsigned char> m_uvchannel;
+
+    Result
+    v8isrStart(Edge mode, v8::Handle<v8::Function> func, bool batch)
+    {
+        if (!m_uvchannel.open(v8isr, this)) {
+            return ERROR_UNSPECIFIED;
+        }
+        m_v8batch = batch;
+#if NODE_MODULE_VERSION >= 0x000D
+        m_v8isr.Reset(v8::Isolate::GetCurrent(), func);
+#else
+        m_v8isr = v8::Persistent<v8::Function>::New(func);
+#endif
+        Result ret = (Result) mraa_gpio_isr(m_gpio, (mraa_gpio_edge_t) mode, &uvpush, this);
+        if (ret != SUCCESS) {
+            m_uvchannel.close();
+        }
+        return ret;
+    }
 #endif
 };
 }
@@ -52,6 +52,30 @@ extern "C" {
  */
 typedef struct _i2c* mraa_i2c_context;
 
+/**
+ * Most messages a single mraa_i2c_transfer() takes, the kernel limit for one
+ * I2C_RDWR ioctl
+ */
+#define MRAA_I2C_TRANSFER_MAX_MSGS 42
+
+/**
+ * Flags of a mraa_i2c_msg_t, values match the kernel i2c_msg flags
+ */
+typedef enum {
+    MRAA_I2C_MSG_RD = 0x0001,     /**< read into buf instead of writing it */
+    MRAA_I2C_MSG_NOSTART = 0x4000 /**< continue the previous message without a repeated start or address */
+} mraa_i2c_msg_flag_t;
+
+/**
+ * A single message of a mraa_i2c_transfer()
+ */
+typedef struct {
+    uint8_t addr;   /**< 7-bit slave address of this message */
+    uint16_t flags; /**< bitwise or of mraa_i2c_msg_flag_t */
+    uint16_t len;   /**< number of bytes to read or write */
+    uint8_t* buf;   /**< data to write, or room for len bytes to read */
+} mraa_i2c_msg_t;
+
 /**
  * Initialise i2c context, using board defintions
  *
@@ -114,7 +138,9 @@ int mraa_i2c_read_byte_data(mraa_i2c_context dev, const uint8_t command);
 int mraa_i2c_read_word_data(mraa_i2c_context dev, const uint8_t command);
 
 /**
- * Bulk read from i2c context, starting from designated register
+ * Bulk read from i2c context, starting from designated register. Adapters
+ * that only speak SMBus are read in 32 byte blocks or byte by byte, which
+ * relies on the device auto incrementing its register address.
  *
  * @param dev The i2c context
  * @param command The register
@@ -126,12 +152,15 @@ int mraa_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* dat
 
 /**
  * Write length bytes to the bus, the first byte in the array is the
- * command/register to write
+ * command/register to write. Like mraa_i2c_read_bytes_data() this is split
+ * into 32 byte register blocks on adapters that only speak SMBus. Adapters
+ * without block writes only take a register and at most one data byte.
  *
  * @param dev The i2c context
  * @param data pointer to the byte array to be written
  * @param length the number of bytes to transmit
- * @return Result of operation
+ * @return Result of operation, MRAA_ERROR_FEATURE_NOT_SUPPORTED if the
+ * adapter can't write that many bytes
  */
 mraa_result_t mraa_i2c_write(mraa_i2c_context dev, const uint8_t* data, int length);
 
@@ -164,6 +193,202 @@ mraa_result_t mraa_i2c_write_byte_data(mraa_i2c_context dev, const uint8_t data,
  */
 mraa_result_t mraa_i2c_write_word_data(mraa_i2c_context dev, const uint16_t data, const uint8_t command);
 
+/**
+ * Run several messages as one combined transaction. Messages are separated by
+ * repeated starts with a single stop at the end, each with its own slave
+ * address, so register reads from several slaves take a single syscall on
+ * Linux i2c-dev buses. Other backends emulate the transfer message by
+ * message, where a one byte write followed by a read from the same address
+ * becomes a register read. The context's own address is not changed.
+ *
+ * @param dev The i2c context
+ * @param msgs Messages to run in order, read buffers are filled in
+ * @param num_msgs Number of messages, at most MRAA_I2C_TRANSFER_MAX_MSGS
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_transfer(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int num_msgs);
+
+/**
+ * Priority of a transaction submitted to the bus worker, lower runs first
+ */
+typedef enum {
+    MRAA_I2C_PRIO_HIGH = 0,   /**< latency critical, e.g. sensor data reads */
+    MRAA_I2C_PRIO_NORMAL = 1, /**< default */
+    MRAA_I2C_PRIO_LOW = 2     /**< bulk traffic, e.g. eeprom writes or logging */
+} mraa_i2c_prio_t;
+
+/**
+ * Flags of a mraa_i2c_request_t
+ */
+typedef enum {
+    /** A register read (one byte register write, then a read) that may be
+     * merged with queued reads of adjacent registers of the same slave and
+     * priority, whose deadline has not passed, into a single read. The
+     * device has to increment its register address on its own. */
+    MRAA_I2C_REQ_COALESCE = 0x01
+} mraa_i2c_req_flag_t;
+
+/**
+ * A transaction for mraa_i2c_submit()
+ */
+typedef struct {
+    mraa_i2c_msg_t* msgs;     /**< messages as for mraa_i2c_transfer(), valid until completion */
+    int num_msgs;             /**< number of messages */
+    mraa_i2c_prio_t prio;     /**< queue priority */
+    unsigned int deadline_us; /**< fail with MRAA_ERROR_NO_RESOURCES if not started in time, 0 for none */
+    unsigned int flags;       /**< bitwise or of mraa_i2c_req_flag_t */
+    void (*done)(mraa_result_t result, void* args); /**< called by the bus worker on completion, may be NULL, stopping the context waits for it to return */
+    void* args;               /**< passed to done */
+} mraa_i2c_request_t;
+
+/**
+ * Opaque handle of a submitted transaction
+ */
+typedef struct _i2c_job* mraa_i2c_job;
+
+/**
+ * Queue a transaction on the worker thread of the context's bus, started
+ * with the first submission. The worker runs one transaction at a time in
+ * priority order, earliest deadline first within a priority, so callers in
+ * different threads no longer interleave on the bus. Only transactions
+ * submitted this way are ordered, plain calls still go straight to the bus.
+ * The returned job has to be given back with mraa_i2c_job_wait() or
+ * mraa_i2c_job_release() before the context is stopped. Transactions that
+ * write registers drop them from the context's register cache on the worker
+ * thread, so the mraa_i2c_regmap*() functions must not be used on the context
+ * while such a job is in flight. Register reads leave the cache alone.
+ *
+ * @param dev The i2c context
+ * @param req The transaction, copied except for the messages
+ * @return job handle or NULL if it could not be queued
+ */
+mraa_i2c_job mraa_i2c_submit(mraa_i2c_context dev, const mraa_i2c_request_t* req);
+
+/**
+ * Wait for a submitted transaction to complete and release it. On timeout
+ * the job stays valid and can be waited for again.
+ *
+ * @param job The job
+ * @param timeout_ms How long to wait, -1 for as long as it takes
+ * @return Result of the transaction, MRAA_ERROR_NO_DATA_AVAILABLE on timeout
+ */
+mraa_result_t mraa_i2c_job_wait(mraa_i2c_job job, int timeout_ms);
+
+/**
+ * Release a submitted transaction without waiting for it, e.g. when its
+ * result is delivered through the done callback
+ *
+ * @param job The job
+ */
+void mraa_i2c_job_release(mraa_i2c_job job);
+
+/**
+ * Register cache flags of a mraa_i2c_reg_t
+ */
+typedef enum {
+    MRAA_I2C_REG_VOLATILE = 0x01 /**< changes on its own (status, data), always read from the device */
+} mraa_i2c_reg_flag_t;
+
+/**
+ * A register of the layout given to mraa_i2c_regmap()
+ */
+typedef struct {
+    uint8_t reg;   /**< register address */
+    uint8_t flags; /**< bitwise or of mraa_i2c_reg_flag_t */
+} mraa_i2c_reg_t;
+
+/**
+ * Attach a register cache to an i2c context. Declared non volatile registers
+ * are read from the device once and served from the cache afterwards, writes
+ * go through to the device. Undeclared registers are never cached. The cache
+ * belongs to the current slave address and starts over empty when the context
+ * is moved to another one. Writes done with the plain mraa_i2c_write*()
+ * functions drop the registers they touch from the cache, see
+ * mraa_i2c_submit() for writes queued on the bus worker.
+ *
+ * @param dev The i2c context
+ * @param regs Register layout, NULL removes the cache
+ * @param num_regs Number of entries in regs
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap(mraa_i2c_context dev, const mraa_i2c_reg_t* regs, int num_regs);
+
+/**
+ * Read a register through the register cache
+ *
+ * @param dev The i2c context
+ * @param reg The register
+ * @return The register value or -1 if failed
+ */
+int mraa_i2c_regmap_read(mraa_i2c_context dev, uint8_t reg);
+
+/**
+ * Read consecutive registers through the register cache, the device is only
+ * accessed (with one mraa_i2c_read_bytes_data()) when one of them is not
+ * cached
+ *
+ * @param dev The i2c context
+ * @param reg The first register
+ * @param data pointer to the byte array to read data in to
+ * @param length number of registers to read
+ * @return The length in bytes passed to the function or -1
+ */
+int mraa_i2c_regmap_read_bytes(mraa_i2c_context dev, uint8_t reg, uint8_t* data, int length);
+
+/**
+ * Write a register and remember its value, in cache only mode the write is
+ * held back until mraa_i2c_regmap_sync()
+ *
+ * @param dev The i2c context
+ * @param reg The register
+ * @param value The value to write
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_write(mraa_i2c_context dev, uint8_t reg, uint8_t value);
+
+/**
+ * Read-modify-write the bits in mask of a register, nothing is written when
+ * the cached value already has them set that way
+ *
+ * @param dev The i2c context
+ * @param reg The register
+ * @param mask Bits to change
+ * @param value New value of the bits in mask
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_update_bits(mraa_i2c_context dev, uint8_t reg, uint8_t mask, uint8_t value);
+
+/**
+ * Keep register writes in the cache only, e.g. while the device is powered
+ * down or to batch a reconfiguration, see mraa_i2c_regmap_sync()
+ *
+ * @param dev The i2c context
+ * @param enable true to hold back writes, false to write through again
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_cache_only(mraa_i2c_context dev, mraa_boolean_t enable);
+
+/**
+ * Write all held back registers to the device. Runs of consecutive registers
+ * are written with a single mraa_i2c_write(), which needs a device that
+ * increments its register address on its own. Adapters that can only do
+ * SMBus byte data writes get one write per register instead, the device
+ * then sees a stop between the registers of a run.
+ *
+ * @param dev The i2c context
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_sync(mraa_i2c_context dev);
+
+/**
+ * Forget all cached register values, e.g. after a device reset. Writes not
+ * synced yet are dropped.
+ *
+ * @param dev The i2c context
+ * @return Result of operation
+ */
+mraa_result_t mraa_i2c_regmap_invalidate(mraa_i2c_context dev);
+
 /**
  * Sets the i2c slave address.
  *
@@ -31,6 +31,40 @@
 namespace mraa
 {
 
+/**
+ * Flags of an I2cMsg, these must match mraa_i2c_msg_flag_t in i2c.h
+ */
+typedef enum {
+    I2C_MSG_RD = 0x0001,     /**< read into buf instead of writing it */
+    I2C_MSG_NOSTART = 0x4000 /**< continue the previous message without a repeated start or address */
+} I2cMsgFlag;
+
+/**
+ * A single message of I2c::transfer(), see mraa_i2c_msg_t
+ */
+typedef mraa_i2c_msg_t I2cMsg;
+
+/**
+ * Bus worker priorities, these must match mraa_i2c_prio_t in i2c.h
+ */
+typedef enum {
+    I2C_PRIO_HIGH = 0,   /**< latency critical */
+    I2C_PRIO_NORMAL = 1, /**< default */
+    I2C_PRIO_LOW = 2     /**< bulk traffic */
+} I2cPrio;
+
+/**
+ * Register cache flags of an I2cReg, these must match mraa_i2c_reg_flag_t in i2c.h
+ */
+typedef enum {
+    I2C_REG_VOLATILE = 0x01 /**< changes on its own, always read from the device */
+} I2cRegFlag;
+
+/**
+ * A register of the layout given to I2c::regmap(), see mraa_i2c_reg_t
+ */
+typedef mraa_i2c_reg_t I2cReg;
+
 /**
  * @brief API to Inter-Integrated Circuit
  *
@@ -244,6 +278,153 @@ class I2c
         return (Result) mraa_i2c_write_word_data(m_i2c, data, reg);
     }
 
+    /**
+     * Like transfer(), but queued on the bus worker thread that orders the
+     * transactions of all threads by priority and deadline, see
+     * mraa_i2c_submit(). Blocks until the transaction is done.
+     *
+     * @param msgs Messages to run in order, read buffers are filled in
+     * @param numMsgs Number of messages, at most MRAA_I2C_TRANSFER_MAX_MSGS
+     * @param prio Queue priority
+     * @param deadlineUs Give up if not started within this time, 0 waits forever
+     * @param coalesce Allow merging with adjacent queued register reads
+     * @return Result of operation
+     */
+    Result
+    transferScheduled(I2cMsg* msgs, int numMsgs, I2cPrio prio = I2C_PRIO_NORMAL,
+                      unsigned int deadlineUs = 0, bool coalesce = false)
+    {
+        mraa_i2c_request_t req = { msgs, numMsgs, (mraa_i2c_prio_t) prio, deadlineUs,
+                                   coalesce ? (unsigned int) MRAA_I2C_REQ_COALESCE : 0, NULL, NULL };
+        mraa_i2c_job job = mraa_i2c_submit(m_i2c, &req);
+        if (job == NULL) {
+            return ERROR_UNSPECIFIED;
+        }
+        return (Result) mraa_i2c_job_wait(job, -1);
+    }
+
+    /**
+     * Attach a register cache, see mraa_i2c_regmap()
+     *
+     * @param regs Register layout, NULL removes the cache
+     * @param numRegs Number of entries in regs
+     * @return Result of operation
+     */
+    Result
+    regmap(const I2cReg* regs, int numRegs)
+    {
+        return (Result) mraa_i2c_regmap(m_i2c, regs, numRegs);
+    }
+
+    /**
+     * Read a register through the register cache
+     *
+     * @param reg Register to read from
+     *
+     * @throws std::invalid_argument in case of error
+     * @return char read from register
+     */
+    uint8_t
+    regmapRead(uint8_t reg)
+    {
+        int x = mraa_i2c_regmap_read(m_i2c, reg);
+        if (x == -1) {
+            throw std::invalid_argument("Unknown error in I2c::regmapRead()");
+        }
+        return (uint8_t) x;
+    }
+
+    /**
+     * Read consecutive registers through the register cache
+     *
+     * @param reg First register to read from
+     * @param data pointer to the byte array to read data in to
+     * @param length number of registers to read
+     * @return length passed to the function or -1
+     */
+    int
+    regmapReadBytes(uint8_t reg, uint8_t* data, int length)
+    {
+        return mraa_i2c_regmap_read_bytes(m_i2c, reg, data, length);
+    }
+
+    /**
+     * Write a register through the register cache
+     *
+     * @param reg Register to write to
+     * @param data Value to write to register
+     * @return Result of operation
+     */
+    Result
+    regmapWrite(uint8_t reg, uint8_t data)
+    {
+        return (Result) mraa_i2c_regmap_write(m_i2c, reg, data);
+    }
+
+    /**
+     * Change some bits of a register, skipped if they already match
+     *
+     * @param reg Register to update
+     * @param mask Bits to change
+     * @param data New value of the bits in mask
+     * @return Result of operation
+     */
+    Result
+    regmapUpdateBits(uint8_t reg, uint8_t mask, uint8_t data)
+    {
+        return (Result) mraa_i2c_regmap_update_bits(m_i2c, reg, mask, data);
+    }
+
+    /**
+     * Hold register writes in the cache until regmapSync()
+     *
+     * @param enable true to hold back writes, false to write through again
+     * @return Result of operation
+     */
+    Result
+    regmapCacheOnly(bool enable)
+    {
+        return (Result) mraa_i2c_regmap_cache_only(m_i2c, enable);
+    }
+
+    /**
+     * Write held back registers, consecutive ones in a single write unless
+     * the adapter only does SMBus byte data writes, see mraa_i2c_regmap_sync()
+     *
+     * @return Result of operation
+     */
+    Result
+    regmapSync()
+    {
+        return (Result) mraa_i2c_regmap_sync(m_i2c);
+    }
+
+    /**
+     * Forget all cached register values
+     *
+     * @return Result of operation
+     */
+    Result
+    regmapInvalidate()
+    {
+        return (Result) mraa_i2c_regmap_invalidate(m_i2c);
+    }
+
+    /**
+     * Run several messages, to one or more slaves, as one combined
+     * transaction with repeated starts in between. The address set with
+     * address() is left alone.
+     *
+     * @param msgs Messages to run in order, read buffers are filled in
+     * @param numMsgs Number of messages, at most MRAA_I2C_TRANSFER_MAX_MSGS
+     * @return Result of operation
+     */
+    Result
+    transfer(I2cMsg* msgs, int numMsgs)
+    {
+        return (Result) mraa_i2c_transfer(m_i2c, msgs, numMsgs);
+    }
+
   private:
     mraa_i2c_context m_i2c;
 };
@@ -290,7 +290,8 @@ mraa_result_t mraa_iio_create_trigger(mraa_iio_context dev, const char* trigger)
 mraa_result_t mraa_iio_update_channels(mraa_iio_context dev);
 
 /**
- * De-inits an mraa_iio_context device
+ * De-inits an mraa_iio_context device, a trigger or event callback is stopped
+ * before this returns
  *
  * @param dev The iio context
  * @return Result of operation
@@ -29,6 +29,10 @@
 #include <sstream>
 #include <stdexcept>
 
+#if defined(SWIGJAVASCRIPT)
+#include "javascript/mraajs_async.hpp"
+#endif
+
 namespace mraa
 {
 
@@ -242,7 +246,124 @@ class Iio
         }
     }
 
+#if defined(SWIGJAVASCRIPT)
+    /**
+     * Call a function on the event loop for iio events. Events arriving
+     * while the loop is busy are delivered back to back on its next wakeup.
+     *
+     * @param func Called with channelType, modifier, type, direction,
+     * channel, channel2 and diff of each event
+     * @return Result of operation
+     */
+    Result
+    onEvent(v8::Handle<v8::Function> func)
+    {
+        if (!m_uvevents.open(v8event, this)) {
+            return ERROR_UNSPECIFIED;
+        }
+        setV8Callback(m_v8event, func);
+        Result ret = (Result) mraa_iio_event_setup_callback(m_iio, uvevent, this);
+        if (ret != SUCCESS) {
+            m_uvevents.close();
+        }
+        return ret;
+    }
+
+    /**
+     * Call a function on the event loop when the buffer trigger fires
+     *
+     * @param func Called with the number of trigger reads since the
+     * previous call
+     * @return Result of operation
+     */
+    Result
+    onTrigger(v8::Handle<v8::Function> func)
+    {
+        if (!m_uvtriggers.open(v8trigger, this)) {
+            return ERROR_UNSPECIFIED;
+        }
+        setV8Callback(m_v8trigger, func);
+        Result ret = (Result) mraa_iio_trigger_buffer(m_iio, uvtrigger, this);
+        if (ret != SUCCESS) {
+            m_uvtriggers.close();
+        }
+        return ret;
+    }
+#endif
+
   private:
+#if defined(SWIGJAVASCRIPT)
+    static void
+    setV8Callback(v8::Persistent<v8::Function>& callback, v8::Handle<v8::Function> func)
+    {
+#if NODE_MODULE_VERSION >= 0x000D
+        callback.Reset(v8::Isolate::GetCurrent(), func);
+#else
+        callback = v8::Persistent<v8::Function>::New(func);
+#endif
+    }
+
+    static void
+    callV8(v8::Persistent<v8::Function>& callback, int argc, v8::Local<v8::Value>* argv)
+    {
+        if (callback.IsEmpty()) {
+            return;
+        }
+#if NODE_MODULE_VERSION >= 0x000D
+        v8::Local<v8::Function> f = v8::Local<v8::Function>::New(v8::Isolate::GetCurrent(), callback);
+        f->Call(SWIGV8_CURRENT_CONTEXT()->Global(), argc, argv);
+#else
+        callback->Call(SWIGV8_CURRENT_CONTEXT()->Global(), argc, argv);
+#endif
+    }
+
+    static void
+    uvevent(iio_event_data* data, void* args)
+    {
+        Iio* This = (Iio*) args;
+        IioEventData eventData;
+        mraa_iio_event_extract_event(data, &eventData.channelType, &eventData.modifier,
+                                     &eventData.type, &eventData.direction, &eventData.channel,
+                                     &eventData.channel2, &eventData.diff);
+        This->m_uvevents.push(eventData);
+    }
+
+    static void
+    v8event(void* owner, const IioEventData* events, unsigned int count)
+    {
+#if NODE_MODULE_VERSION >= 0x000D
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+#endif
+        Iio* This = (Iio*) owner;
+        for (unsigned int i = 0; i < count; i++) {
+            v8::Local<v8::Value> argv[] = { SWIGV8_INTEGER_NEW(events[i].channelType),
+                                            SWIGV8_INTEGER_NEW(events[i].modifier),
+                                            SWIGV8_INTEGER_NEW(events[i].type),
+                                            SWIGV8_INTEGER_NEW(events[i].direction),
+                                            SWIGV8_INTEGER_NEW(events[i].channel),
+                                            SWIGV8_INTEGER_NEW(events[i].channel2),
+                                            SWIGV8_INTEGER_NEW(events[i].diff) };
+            callV8(This->m_v8event, 7, argv);
+        }
+    }
+
+    static void
+    uvtrigger(char* data, void* args)
+    {
+        ((Iio*) args)->m_uvtriggers.push(1);
+    }
+
+    static void
+    v8trigger(void* owner, const unsigned char* events, unsigned int count)
+    {
+#if NODE_MODULE_VERSION >= 0x000D
+        v8::HandleScope scope(v8::Isolate::GetCurrent());
+#endif
+        v8::Local<v8::Value> argv[] = { SWIGV8_INTEGER_NEW(count) };
+        callV8(((Iio*) owner)->m_v8trigger, 1, argv);
+    }
+#endif
+
     static void
     private_event_handler(iio_event_data* data, void* args)
     {
@@ -264,5 +385,11 @@ class Iio
     }
 
     mraa_iio_context m_iio;
+#if defined(SWIGJAVASCRIPT)
+    v8::Persistent<v8::Function> m_v8event;
+    v8::Persistent<v8::Function> m_v8trigger;
+    UvChannel<IioEventData, 64> m_uvevents;
+    UvChannel<unsigned char> m_uvtriggers;
+#endif
 };
 }
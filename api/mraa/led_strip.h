@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+/**
+ * @file
+ * @brief Addressable LED strip
+ *
+ * Drives WS2812, SK6812 and APA102 style LED strips from a spi context.
+ * WS2812 and SK6812 have no clock line; their one wire waveform is built
+ * out of spi bits, so only MOSI is connected. Pixels are corrected for
+ * gamma and brightness, encoded into a buffer kept with the strip and
+ * pushed with a single mraa_spi_transfer_buf().
+ *
+ * A one wire frame has to fit in one spidev message, so WS2812 strips of
+ * more than 445 pixels and SK6812 strips of more than 248 pixels need the
+ * spidev bufsiz module parameter (4096 bytes by default) raised, e.g.
+ * spidev.bufsiz=65536 on the kernel command line.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "common.h"
+#include "spi.h"
+
+/**
+ * Opaque pointer definition to the internal struct _led_strip
+ */
+typedef struct _led_strip* mraa_led_strip_context;
+
+/**
+ * LED controller on the strip
+ */
+typedef enum {
+    MRAA_LED_STRIP_WS2812 = 0, /**< one wire, GRB, spi clocked at 2.4MHz, 3 spi bits per bit */
+    MRAA_LED_STRIP_SK6812 = 1, /**< one wire, GRBW, spi clocked at 3.2MHz, 4 spi bits per bit */
+    MRAA_LED_STRIP_APA102 = 2  /**< clock and data, BGR, spi clock left as configured */
+} mraa_led_strip_type_t;
+
+/**
+ * Layout of the pixels passed to mraa_led_strip_show()
+ */
+typedef enum {
+    MRAA_LED_STRIP_RGB = 0,  /**< 3 bytes per pixel, red first */
+    MRAA_LED_STRIP_GRB = 1,  /**< 3 bytes per pixel, green first */
+    MRAA_LED_STRIP_RGBW = 2  /**< 4 bytes per pixel, white last, dropped on strips without white */
+} mraa_led_strip_format_t;
+
+/**
+ * Set up a strip on a spi context. The spi context is reconfigured for the
+ * strip (mode 0, msb first, 8 bits per word and for one wire strips the
+ * clock) and has to outlive the strip. Fails for a one wire strip whose
+ * frame is longer than the spidev bufsiz: at the default bufsiz of 4096
+ * bytes that is more than 445 WS2812 or 248 SK6812 pixels, so e.g. a 1000
+ * pixel WS2812 strip (a 9091 byte frame) is refused until spidev.bufsiz is
+ * raised. APA102 frames are split as needed and have no such limit.
+ *
+ * @param spi The spi context the strip is connected to
+ * @param type LED controller on the strip
+ * @param num_pixels Number of pixels on the strip
+ * @return strip context or NULL
+ */
+mraa_led_strip_context mraa_led_strip_init(mraa_spi_context spi, mraa_led_strip_type_t type, unsigned int num_pixels);
+
+/**
+ * Set the gamma correction applied to every channel, 1.0 turns it off,
+ * 2.2 to 2.8 look linear to the eye
+ *
+ * @param dev The strip context
+ * @param gamma Gamma exponent, greater than 0
+ * @return Result of operation
+ */
+mraa_result_t mraa_led_strip_gamma(mraa_led_strip_context dev, float gamma);
+
+/**
+ * Scale every channel after gamma correction
+ *
+ * @param dev The strip context
+ * @param brightness 0 for off up to 255 for full
+ * @return Result of operation
+ */
+mraa_result_t mraa_led_strip_brightness(mraa_led_strip_context dev, uint8_t brightness);
+
+/**
+ * Encode pixels and send them to the strip
+ *
+ * @param dev The strip context
+ * @param pixels Pixel data, one pixel after the other starting at the input
+ * @param length Bytes in pixels, num_pixels times 3 or 4 depending on format
+ * @param format Layout of pixels
+ * @return Result of operation
+ */
+mraa_result_t mraa_led_strip_show(mraa_led_strip_context dev, const uint8_t* pixels, int length, mraa_led_strip_format_t format);
+
+/**
+ * Free a strip, the spi context is left open
+ *
+ * @param dev The strip context
+ * @return Result of operation
+ */
+mraa_result_t mraa_led_strip_close(mraa_led_strip_context dev);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "led_strip.h"
+#include "types.hpp"
+#include <stdexcept>
+
+namespace mraa
+{
+
+/**
+ * LED controller on the strip, see mraa_led_strip_type_t
+ */
+typedef enum {
+    LED_STRIP_WS2812 = 0, /**< one wire, GRB */
+    LED_STRIP_SK6812 = 1, /**< one wire, GRBW */
+    LED_STRIP_APA102 = 2  /**< clock and data, BGR */
+} LedStripType;
+
+/**
+ * Layout of the pixels passed to LedStrip::show(), see mraa_led_strip_format_t
+ */
+typedef enum {
+    LED_STRIP_RGB = 0,  /**< 3 bytes per pixel, red first */
+    LED_STRIP_GRB = 1,  /**< 3 bytes per pixel, green first */
+    LED_STRIP_RGBW = 2  /**< 4 bytes per pixel, white last */
+} LedStripFormat;
+
+/**
+ * @brief API to addressable LED strips
+ *
+ * This file defines the addressable LED strip interface for libmraa, the
+ * strip takes over a spi bus of its own
+ */
+class LedStrip
+{
+  public:
+    /**
+     * Instantiates an LED strip on a spi bus
+     *
+     * @param bus Spi bus to use, as listed in the platform definition
+     * @param type LED controller on the strip
+     * @param numPixels Number of pixels on the strip
+     */
+    LedStrip(int bus, LedStripType type, unsigned int numPixels)
+    {
+        m_spi = mraa_spi_init(bus);
+        if (m_spi == NULL) {
+            throw std::invalid_argument("Error initialising SPI bus");
+        }
+
+        m_strip = mraa_led_strip_init(m_spi, (mraa_led_strip_type_t) type, numPixels);
+        if (m_strip == NULL) {
+            mraa_spi_stop(m_spi);
+            throw std::invalid_argument("Error initialising LED strip");
+        }
+    }
+
+    /**
+     * LedStrip object destructor, closes the spi bus
+     */
+    ~LedStrip()
+    {
+        mraa_led_strip_close(m_strip);
+        mraa_spi_stop(m_spi);
+    }
+
+    /**
+     * Set the gamma correction applied to every channel, 1.0 turns it off
+     *
+     * @param gamma Gamma exponent, greater than 0
+     * @return Result of operation
+     */
+    Result
+    gamma(float gamma)
+    {
+        return (Result) mraa_led_strip_gamma(m_strip, gamma);
+    }
+
+    /**
+     * Scale every channel after gamma correction
+     *
+     * @param brightness 0 for off up to 255 for full
+     * @return Result of operation
+     */
+    Result
+    brightness(uint8_t brightness)
+    {
+        return (Result) mraa_led_strip_brightness(m_strip, brightness);
+    }
+
+    /**
+     * Encode pixels and send them to the strip
+     *
+     * @param data Pixel data, 3 or 4 bytes per pixel depending on format
+     * @param length Bytes in data
+     * @param format Layout of data
+     * @return Result of operation
+     */
+    Result
+    show(const uint8_t* data, int length, LedStripFormat format = LED_STRIP_RGB)
+    {
+        return (Result) mraa_led_strip_show(m_strip, data, length, (mraa_led_strip_format_t) format);
+    }
+
+  private:
+    mraa_spi_context m_spi;
+    mraa_led_strip_context m_strip;
+};
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+/**
+ * @file
+ * @brief Periodic sampler
+ *
+ * A sampler reads registers of i2c and spi devices and aio pins at fixed
+ * periods from a single timerfd driven thread. Jobs on the same bus are
+ * started in phase so that their reads land back to back. Every read is
+ * stored with its CLOCK_MONOTONIC timestamp in a per job ring buffer that
+ * the application drains whenever it suits it.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "common.h"
+#include "aio.h"
+#include "i2c.h"
+#include "spi.h"
+
+/** Largest number of bytes a single sample can hold */
+#define MRAA_SAMPLER_MAX_SAMPLE_LEN 32
+
+/**
+ * Opaque pointer definition to the internal struct _sampler
+ */
+typedef struct _sampler* mraa_sampler_context;
+
+/**
+ * What a sampler job reads from
+ */
+typedef enum {
+    MRAA_SAMPLER_I2C = 0, /**< len bytes from register reg of i2c slave addr */
+    MRAA_SAMPLER_SPI = 1, /**< len bytes clocked in after sending reg, include the read bit in reg */
+    MRAA_SAMPLER_AIO = 2  /**< one mraa_aio_read(), stored as a native int */
+} mraa_sampler_bus_t;
+
+/**
+ * A periodic read
+ */
+typedef struct {
+    mraa_sampler_bus_t type; /**< kind of context */
+    void* context;           /**< mraa_i2c_context, mraa_spi_context or mraa_aio_context */
+    uint8_t addr;            /**< i2c slave address, the context's own address is left alone */
+    uint8_t reg;             /**< register to read from, unused for aio */
+    uint16_t len;            /**< bytes to read, at most MRAA_SAMPLER_MAX_SAMPLE_LEN, unused for aio */
+    unsigned int period_us;  /**< time between reads */
+    unsigned int ring_size;  /**< samples buffered until drained, rounded up to a power of two, 0 for 64 */
+} mraa_sampler_job_t;
+
+/**
+ * A sample as returned by mraa_sampler_read()
+ */
+typedef struct {
+    uint64_t timestamp_ns; /**< CLOCK_MONOTONIC time the read started */
+    uint16_t len;          /**< valid bytes in data */
+    uint8_t data[MRAA_SAMPLER_MAX_SAMPLE_LEN]; /**< raw bytes as read from the device */
+} mraa_sampler_sample_t;
+
+/**
+ * Counters of a sampler job
+ */
+typedef struct {
+    unsigned long samples; /**< reads stored */
+    unsigned long missed;  /**< periods skipped because the sampler ran late */
+    unsigned long dropped; /**< samples lost because the ring was full */
+    unsigned long errors;  /**< failed reads */
+} mraa_sampler_stats_t;
+
+/**
+ * Create a sampler, it does nothing until jobs are added and it is started
+ *
+ * @return sampler context or NULL
+ */
+mraa_sampler_context mraa_sampler_init();
+
+/**
+ * Add a job, only while the sampler is stopped. The context of the job has to
+ * outlive the sampler and should not be used by other threads while it runs,
+ * unless the backend serialises access itself (i2c-dev buses do).
+ *
+ * @param dev The sampler context
+ * @param job The job to add, copied
+ * @return job id for mraa_sampler_read() or -1 on failure
+ */
+int mraa_sampler_add(mraa_sampler_context dev, const mraa_sampler_job_t* job);
+
+/**
+ * Start sampling, all jobs start at the same moment. Jobs due together run
+ * grouped by bus, so the reads on one bus go back to back.
+ *
+ * @param dev The sampler context
+ * @return Result of operation
+ */
+mraa_result_t mraa_sampler_start(mraa_sampler_context dev);
+
+/**
+ * Stop sampling, samples not drained yet stay readable
+ *
+ * @param dev The sampler context
+ * @return Result of operation, MRAA_ERROR_UNSPECIFIED if the sampler thread
+ * had already given up on a timer error
+ */
+mraa_result_t mraa_sampler_stop(mraa_sampler_context dev);
+
+/**
+ * Take buffered samples of a job, oldest first. Only one thread should drain
+ * a given job.
+ *
+ * @param dev The sampler context
+ * @param job_id Id returned by mraa_sampler_add()
+ * @param samples Array to copy the samples to
+ * @param max_samples Size of samples
+ * @return number of samples copied or -1 on failure
+ */
+int mraa_sampler_read(mraa_sampler_context dev, int job_id, mraa_sampler_sample_t* samples, int max_samples);
+
+/**
+ * Get the counters of a job, including missed deadlines
+ *
+ * @param dev The sampler context
+ * @param job_id Id returned by mraa_sampler_add()
+ * @param stats Filled in with the current counters
+ * @return Result of operation, MRAA_ERROR_UNSPECIFIED once the sampler thread
+ * gave up on a timer error (stats are still filled in), stop it to recover
+ */
+mraa_result_t mraa_sampler_get_stats(mraa_sampler_context dev, int job_id, mraa_sampler_stats_t* stats);
+
+/**
+ * Stop the sampler and free it
+ *
+ * @param dev The sampler context
+ * @return Result of operation
+ */
+mraa_result_t mraa_sampler_close(mraa_sampler_context dev);
+
+#ifdef __cplusplus
+}
+#endif
@@ -61,6 +61,52 @@ typedef enum {
                            output data (change) on falling edge */
 } mraa_spi_mode_t;
 
+/**
+ * Order the bytes of the 16 bit words of the word functions go out in
+ */
+typedef enum {
+    MRAA_SPI_WORD_NATIVE = 0,    /**< as the hardware does it, the default */
+    MRAA_SPI_WORD_MSB_FIRST = 1, /**< most significant byte first, big endian */
+    MRAA_SPI_WORD_LSB_FIRST = 2  /**< least significant byte first, little endian */
+} mraa_spi_word_order_t;
+
+/** Most segments mraa_spi_transfer_multi() takes in one call */
+#define MRAA_SPI_TRANSFER_MAX_SEGMENTS 64
+
+/**
+ * A segment of a multi segment spi transaction, see mraa_spi_transfer_multi()
+ */
+typedef struct {
+    const uint8_t* tx_buf;  /**< bytes to send, NULL to send zeros */
+    uint8_t* rx_buf;        /**< buffer for the received bytes, may be NULL */
+    uint32_t len;           /**< bytes in this segment */
+    uint32_t speed_hz;      /**< clock for this segment, 0 for the context's frequency */
+    uint8_t bits_per_word;  /**< word size for this segment, 0 for the context's setting */
+    uint8_t cs_change;      /**< deselect the chip after this segment (before the next one, if any) */
+    uint16_t delay_usecs;   /**< wait after this segment before the next one or deselecting */
+} mraa_spi_segment_t;
+
+/**
+ * What the streaming reader of mraa_spi_stream_start() sends
+ */
+typedef struct {
+    const uint8_t* tx_template;    /**< bytes sent by every transfer, e.g. an adc conversion command */
+    uint16_t transfer_len;         /**< bytes in tx_template */
+    uint16_t transfers_per_buffer; /**< transfers per buffer, at most MRAA_SPI_TRANSFER_MAX_SEGMENTS */
+    uint16_t num_buffers;          /**< buffers in the ring, at least 2 */
+    int rt_priority;               /**< SCHED_RR priority of the reader thread, 0 to leave it alone */
+} mraa_spi_stream_config_t;
+
+/**
+ * A filled buffer handed out by mraa_spi_stream_get()
+ */
+typedef struct {
+    uint8_t* data;          /**< received bytes, transfer after transfer */
+    int length;             /**< transfers_per_buffer * transfer_len */
+    uint64_t timestamp_ns;  /**< CLOCK_MONOTONIC time the first transfer started */
+    unsigned long sequence; /**< buffer number, a gap means the ring overran */
+} mraa_spi_stream_buffer_t;
+
 /**
  * Opaque pointer definition to the internal struct _spi
  */
@@ -125,7 +171,7 @@ int mraa_spi_write_word(mraa_spi_context dev, uint16_t data);
  *
  * @param dev The Spi context
  * @param data to send
- * @param length elements within buffer, Max 4096
+ * @param length elements within buffer
  * @return Data received on the miso line, same length as passed in
  */
 uint8_t* mraa_spi_write_buf(mraa_spi_context dev, uint8_t* data, int length);
@@ -136,19 +182,20 @@ uint8_t* mraa_spi_write_buf(mraa_spi_context dev, uint8_t* data, int length);
  *
  * @param dev The Spi context
  * @param data to send
- * @param length elements (in bytes) within buffer, Max 4096
+ * @param length elements (in bytes) within buffer
  * @return Data received on the miso line, same length as passed in
  */
 uint16_t* mraa_spi_write_buf_word(mraa_spi_context dev, uint16_t* data, int length);
 
 /**
  * Transfer Buffer of bytes to the SPI device. Both send and recv buffers
- * are passed in
+ * are passed in. Buffers larger than the spidev bufsiz module parameter
+ * are sent in several messages with chip select held in between.
  *
  * @param dev The Spi context
  * @param data to send
  * @param rxbuf buffer to recv data back, may be NULL
- * @param length elements within buffer, Max 4096
+ * @param length elements within buffer
  * @return Result of operation
  */
 mraa_result_t mraa_spi_transfer_buf(mraa_spi_context dev, uint8_t* data, uint8_t* rxbuf, int length);
@@ -160,13 +207,85 @@ mraa_result_t mraa_spi_transfer_buf(mraa_spi_context dev, uint8_t* data, uint8_t
  * @param dev The Spi context
  * @param data to send
  * @param rxbuf buffer to recv data back, may be NULL
- * @param length elements (in bytes) within buffer, Max 4096
+ * @param length elements (in bytes) within buffer
  * @return Result of operation
  */
 mraa_result_t mraa_spi_transfer_buf_word(mraa_spi_context dev, uint16_t* data, uint16_t* rxbuf, int length);
 
 /**
- * Change the SPI lsb mode
+ * Run several segments as one transaction, with chip select held across all
+ * of them unless a segment asks for cs_change. On spidev this is a single
+ * SPI_IOC_MESSAGE ioctl, other backends run the segments one by one. The
+ * segments together may not be longer than the spidev bufsiz module
+ * parameter, they are not split like mraa_spi_transfer_buf() does.
+ *
+ * @param dev The Spi context
+ * @param segments Segments to run in order, rx_buf buffers are filled in
+ * @param num_segments Number of segments, at most MRAA_SPI_TRANSFER_MAX_SEGMENTS
+ * @return Result of operation, MRAA_ERROR_INVALID_PARAMETER if the segments
+ * exceed bufsiz
+ */
+mraa_result_t mraa_spi_transfer_multi(mraa_spi_context dev, mraa_spi_segment_t* segments, int num_segments);
+
+/**
+ * Start reading continuously. A dedicated thread repeats the transfer of
+ * the template back to back, one mraa_spi_transfer_multi() per buffer with
+ * chip select toggled between transfers, and fills a ring of preallocated
+ * buffers. When all buffers are taken the reader keeps clocking but throws
+ * the data away and counts an overrun. The context must not be used for
+ * anything else until mraa_spi_stream_stop(). A buffer,
+ * transfers_per_buffer * transfer_len bytes, has to fit in the spidev
+ * bufsiz module parameter.
+ *
+ * @param dev The Spi context
+ * @param config What to send, copied
+ * @return Result of operation, MRAA_ERROR_INVALID_PARAMETER if a buffer
+ * exceeds bufsiz
+ */
+mraa_result_t mraa_spi_stream_start(mraa_spi_context dev, const mraa_spi_stream_config_t* config);
+
+/**
+ * Get the oldest filled buffer not handed out yet. The data stays valid and
+ * is not overwritten until the buffer is given back with
+ * mraa_spi_stream_release(), several buffers may be held at once.
+ *
+ * @param dev The Spi context
+ * @param buffer Filled in with the buffer
+ * @param timeout_ms How long to wait for one, -1 to wait forever
+ * @return Result of operation, MRAA_ERROR_NO_DATA_AVAILABLE on timeout
+ */
+mraa_result_t mraa_spi_stream_get(mraa_spi_context dev, mraa_spi_stream_buffer_t* buffer, int timeout_ms);
+
+/**
+ * Give the oldest buffer taken with mraa_spi_stream_get() back to the reader
+ *
+ * @param dev The Spi context
+ * @return Result of operation
+ */
+mraa_result_t mraa_spi_stream_release(mraa_spi_context dev);
+
+/**
+ * Get the number of buffers the reader had to throw away because the ring
+ * was full
+ *
+ * @param dev The Spi context
+ * @return overruns since mraa_spi_stream_start()
+ */
+unsigned long mraa_spi_stream_overruns(mraa_spi_context dev);
+
+/**
+ * Stop the streaming reader and free its buffers, buffers taken with
+ * mraa_spi_stream_get() are invalid afterwards. Done by mraa_spi_stop() too.
+ *
+ * @param dev The Spi context
+ * @return Result of operation
+ */
+mraa_result_t mraa_spi_stream_stop(mraa_spi_context dev);
+
+/**
+ * Change the SPI lsb mode. If the controller can't send lsb first, the
+ * bits of the write and transfer_buf functions are reversed in software,
+ * transfer_multi and streaming stay msb first then.
  *
  * @param dev The Spi context
  * @param lsb Use least significant bit transmission. 0 for msbi
@@ -174,6 +293,18 @@ mraa_result_t mraa_spi_transfer_buf_word(mraa_spi_context dev, uint16_t* data, u
  */
 mraa_result_t mraa_spi_lsbmode(mraa_spi_context dev, mraa_boolean_t lsb);
 
+/**
+ * Set the byte order of the words of mraa_spi_write_word(),
+ * mraa_spi_write_buf_word() and mraa_spi_transfer_buf_word(). Words are
+ * given and returned in host order, the bytes are swapped in software when
+ * the wire order would differ. Received words are converted back.
+ *
+ * @param dev The Spi context
+ * @param order Byte order on the wire
+ * @return Result of operation
+ */
+mraa_result_t mraa_spi_word_order(mraa_spi_context dev, mraa_spi_word_order_t order);
+
 /**
  * Set bits per mode on transaction, defaults at 8
  *
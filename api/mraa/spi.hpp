@@ -45,6 +45,20 @@ typedef enum {
                       output data (change) on falling edge */
 } Spi_Mode;
 
+/**
+ * Byte order of the words of the word functions, see mraa_spi_word_order_t
+ */
+typedef enum {
+    SPI_WORD_NATIVE = 0,    /**< as the hardware does it, the default */
+    SPI_WORD_MSB_FIRST = 1, /**< most significant byte first, big endian */
+    SPI_WORD_LSB_FIRST = 2  /**< least significant byte first, little endian */
+} Spi_WordOrder;
+
+/**
+ * A segment of Spi::transferMulti(), see mraa_spi_segment_t
+ */
+typedef mraa_spi_segment_t SpiSegment;
+
 
 /**
 * @brief API to Serial Peripheral Interface
@@ -219,6 +233,20 @@ class Spi
     }
 #endif
 
+    /**
+     * Run several segments as one transaction, chip select stays asserted
+     * between them unless a segment sets cs_change.
+     *
+     * @param segments Segments to run in order, rx_buf buffers are filled in
+     * @param numSegments Number of segments, at most MRAA_SPI_TRANSFER_MAX_SEGMENTS
+     * @return Result of operation
+     */
+    Result
+    transferMulti(SpiSegment* segments, int numSegments)
+    {
+        return (Result) mraa_spi_transfer_multi(m_spi, segments, numSegments);
+    }
+
     /**
      * Change the SPI lsb mode
      *
@@ -231,6 +259,19 @@ class Spi
         return (Result) mraa_spi_lsbmode(m_spi, (mraa_boolean_t) lsb);
     }
 
+    /**
+     * Set the byte order words of writeWord() and transfer_word() go out in,
+     * swapped in software where needed
+     *
+     * @param order Byte order on the wire
+     * @return Result of operation
+     */
+    Result
+    wordOrder(Spi_WordOrder order)
+    {
+        return (Result) mraa_spi_word_order(m_spi, (mraa_spi_word_order_t) order);
+    }
+
     /**
      * Set bits per mode on transaction, default is 8
      *
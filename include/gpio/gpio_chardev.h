@@ -43,6 +43,36 @@ void _mraa_close_gpio_event_handles(mraa_gpio_context dev);
 void _mraa_close_gpio_desc(mraa_gpio_context dev);
 int _mraa_gpiod_ioctl(int fd, unsigned long gpio_request, void* data);
 
+/* Number of kernel events fetched per read() on a line event fd. */
+#define MRAA_GPIOD_EVENT_READ_BATCH 16
+
+/* Multiple gpio support. */
+typedef struct _gpio_group* mraa_gpiod_group_t;
+
+/**
+ * A file descriptor edge events of a context are read from. With the v1 uAPI
+ * there is one per line, with v2 one per gpio group (chip).
+ */
+typedef struct {
+    int fd;
+    int line_idx; /**< index of the first line covered by fd into dev->events */
+    mraa_gpiod_group_t group;
+} mraa_gpiod_event_source;
+
+int _mraa_gpio_chardev_event_sources(mraa_gpio_context dev, mraa_gpiod_event_source sources[]);
+int _mraa_gpio_chardev_read_events(mraa_gpio_context dev, mraa_gpiod_group_t group, int line_idx, int fd);
+void _mraa_gpio_event_ring_push(mraa_gpio_event_ring* ring, mraa_timestamp_t timestamp, unsigned int id,
+                                unsigned int seqno, unsigned int line_seqno);
+int _mraa_gpio_event_rings_pop(mraa_gpio_context dev, mraa_gpio_edge_event* buf, int* lines, int max);
+
+mraa_boolean_t _mraa_gpiod_v2_capable();
+int _mraa_gpiod_request_lines(mraa_gpio_context dev, mraa_gpiod_group_t group, unsigned flags);
+
+/* Single line fast path, one ioctl on the cached handle of a one line group. */
+int _mraa_gpiod_set_line_value(mraa_gpiod_group_t group, int value);
+int _mraa_gpiod_get_line_value(mraa_gpiod_group_t group);
+int _mraa_gpiod_set_line_values_masked(mraa_gpiod_group_t group, unsigned long long mask, unsigned long long bits);
+
 mraa_gpiod_chip_info* mraa_get_chip_info_by_path(const char* path);
 mraa_gpiod_chip_info* mraa_get_chip_info_by_name(const char* name);
 mraa_gpiod_chip_info* mraa_get_chip_info_by_label(const char* label);
@@ -65,10 +95,6 @@ mraa_boolean_t mraa_is_gpio_line_open_source(mraa_gpiod_line_info *linfo);
 
 int mraa_get_number_of_gpio_chips();
 
-/* Multiple gpio support. */
-typedef struct _gpio_group* mraa_gpiod_group_t;
-
-
 #ifdef __cplusplus
 }
 #endif
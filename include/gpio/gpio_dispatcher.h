@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "mraa_internal.h"
+
+/* Upper bound for the number of shared isr event loops. */
+#define MRAA_GPIO_DISPATCH_MAX_THREADS 16
+
+/**
+ * Check whether newly registered isrs should go through the shared dispatcher.
+ *
+ * @return mraa_boolean_t true if mraa_gpio_isr_dispatcher() enabled it
+ */
+mraa_boolean_t mraa_gpio_dispatcher_enabled();
+
+/**
+ * Hand over the (already edge configured) event sources of a gpio context to
+ * one of the shared event loops. dev->isr and dev->isr_args must be set.
+ *
+ * @param dev The Gpio context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_dispatcher_register(mraa_gpio_context dev);
+
+/**
+ * Remove a gpio context from its event loop. Once this returns the isr of the
+ * context is guaranteed not to be running, unless called from within any
+ * dispatched isr: waiting there could deadlock two loops on each other.
+ *
+ * @param dev The Gpio context
+ * @return Result of operation
+ */
+mraa_result_t mraa_gpio_dispatcher_unregister(mraa_gpio_context dev);
+
+/**
+ * Stop and free the shared event loops, dropping whatever is still registered
+ * on them. Used by mraa_deinit(), must not be called from a dispatched isr.
+ */
+void mraa_gpio_dispatcher_shutdown();
+
+mraa_timestamp_t _mraa_gpio_get_timestamp_sysfs();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mraa_internal.h"
+
+/* An edge as read from the kernel, kept by the filter until it is delivered. */
+typedef struct {
+    uint64_t timestamp_ns;      /**< timestamp compared by the filter */
+    mraa_timestamp_t timestamp; /**< timestamp as stored in dev->events */
+    int level;                  /**< level after the edge (0 or 1), -1 if unknown */
+    unsigned int id;            /**< kernel event id, chardev only */
+    unsigned int seqno;         /**< kernel sequence numbers, uAPI v2 only */
+    unsigned int line_seqno;
+} mraa_gpio_filter_edge;
+
+/**
+ * Run an edge through the software glitch filter of a context. Without a
+ * filter the edge is recorded in dev->events (and the event rings) right
+ * away, otherwise it is held until its pin stayed at the new level for the
+ * hold time, and dropped if the pin goes back before that.
+ *
+ * @param dev The Gpio context
+ * @param line_idx Index of the pin in the context
+ * @param edge The edge
+ */
+void _mraa_gpio_filter_edge(mraa_gpio_context dev, int line_idx, const mraa_gpio_filter_edge* edge);
+
+/**
+ * Record the held edges whose hold time ran out. The caller resets
+ * dev->events beforehand, same as before reading the kernel events.
+ *
+ * @param dev The Gpio context
+ * @param now CLOCK_MONOTONIC time in nanoseconds, see _mraa_gpio_filter_now()
+ * @return Number of edges recorded
+ */
+int _mraa_gpio_filter_expire(mraa_gpio_context dev, uint64_t now);
+
+/**
+ * Get the CLOCK_MONOTONIC time the next held edge of a context is due.
+ *
+ * @param dev The Gpio context
+ * @return Deadline in nanoseconds, 0 if no edge is held
+ */
+uint64_t _mraa_gpio_filter_deadline(mraa_gpio_context dev);
+
+/**
+ * @return Current CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t _mraa_gpio_filter_now();
+
+/**
+ * Check whether any edge of the last wakeup made it through the filter.
+ *
+ * @param dev The Gpio context
+ * @return mraa_boolean_t true if the isr should be called
+ */
+mraa_boolean_t _mraa_gpio_filter_pending(mraa_gpio_context dev);
+
+/**
+ * Release the filter state of a context, called once its isr is gone.
+ *
+ * @param dev The Gpio context
+ */
+void _mraa_gpio_filter_free(mraa_gpio_context dev);
+
+#ifdef __cplusplus
+}
+#endif
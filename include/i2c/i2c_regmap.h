@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mraa_internal.h"
+
+/**
+ * Forget cached values of registers written past the register cache, called
+ * by the plain i2c write functions.
+ *
+ * @param dev The i2c context
+ * @param reg First register written
+ * @param length Number of registers written
+ */
+void _mraa_i2c_regmap_written(mraa_i2c_context dev, uint8_t reg, int length);
+
+/**
+ * Release the register cache of a context, called when it is stopped.
+ *
+ * @param dev The i2c context
+ */
+void _mraa_i2c_regmap_free(mraa_i2c_context dev);
+
+/**
+ * Tell whether mraa_i2c_write() can write several registers in one
+ * transaction, adapters limited to SMBus byte data writes can't.
+ *
+ * @param dev The i2c context
+ * @return 1 if register blocks can be written, 0 otherwise
+ */
+mraa_boolean_t _mraa_i2c_can_write_block(mraa_i2c_context dev);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <uv.h>
+
+namespace mraa
+{
+
+/**
+ * Hands events from an mraa thread over to the node event loop.
+ *
+ * push() is called from one producer thread (an isr or iio event thread) and
+ * only touches a lock free ring and uv_async_send(). Sends that arrive before
+ * the loop got around to the previous one are coalesced by libuv, so a burst
+ * of events costs a single wakeup, after which everything queued is delivered
+ * on the loop thread. open() and close() must be called on the loop thread.
+ */
+template <typename T, unsigned int Size = 256> class UvChannel
+{
+  public:
+    /** Called on the loop thread with the events of one wakeup, in order. */
+    typedef void (*Deliver)(void* owner, const T* events, unsigned int count);
+
+    UvChannel() : m_async(NULL), m_deliver(NULL), m_owner(NULL), m_head(0), m_tail(0), m_dropped(0)
+    {
+    }
+
+    ~UvChannel()
+    {
+        close();
+    }
+
+    bool
+    open(Deliver deliver, void* owner)
+    {
+        if (m_async != NULL) {
+            return false;
+        }
+
+        m_async = new uv_async_t;
+        m_async->data = this;
+        if (uv_async_init(uv_default_loop(), m_async, drain) != 0) {
+            delete m_async;
+            m_async = NULL;
+            return false;
+        }
+
+        m_deliver = deliver;
+        m_owner = owner;
+        m_head = m_tail = 0;
+        return true;
+    }
+
+    /** The producer must be stopped already. Undelivered events are dropped. */
+    void
+    close()
+    {
+        if (m_async == NULL) {
+            return;
+        }
+
+        /* libuv frees nothing itself and still needs the handle until the
+         * close callback, which may run after this channel is gone. */
+        m_async->data = NULL;
+        uv_close((uv_handle_t*) m_async, closed);
+        m_async = NULL;
+    }
+
+    /** Queue an event and wake the loop, returns false if the queue was full. */
+    bool
+    push(const T& event)
+    {
+        unsigned int head = m_head;
+
+        if (head - __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE) >= Size) {
+            __atomic_fetch_add(&m_dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+
+        m_events[head % Size] = event;
+        __atomic_store_n(&m_head, head + 1, __ATOMIC_RELEASE);
+
+        uv_async_t* async = __atomic_load_n(&m_async, __ATOMIC_ACQUIRE);
+        if (async != NULL) {
+            uv_async_send(async);
+        }
+        return true;
+    }
+
+    /** Number of events dropped because the loop did not keep up. */
+    unsigned long
+    dropped() const
+    {
+        return __atomic_load_n(&m_dropped, __ATOMIC_RELAXED);
+    }
+
+  private:
+#if UV_VERSION_MAJOR >= 1
+    static void
+    drain(uv_async_t* handle)
+#else
+    static void
+    drain(uv_async_t* handle, int status)
+#endif
+    {
+        UvChannel* self = (UvChannel*) handle->data;
+        if (self == NULL) {
+            return;
+        }
+
+        unsigned int head = __atomic_load_n(&self->m_head, __ATOMIC_ACQUIRE);
+        unsigned int tail = self->m_tail;
+
+        /* Copy out before delivering, the callback may close the channel. */
+        while (tail != head) {
+            T batch[Size];
+            unsigned int count = 0;
+
+            while (tail != head && count < Size) {
+                batch[count++] = self->m_events[tail % Size];
+                tail++;
+            }
+            __atomic_store_n(&self->m_tail, tail, __ATOMIC_RELEASE);
+
+            Deliver deliver = self->m_deliver;
+            void* owner = self->m_owner;
+            deliver(owner, batch, count);
+
+            if (handle->data == NULL) {
+                return;
+            }
+        }
+    }
+
+    static void
+    closed(uv_handle_t* handle)
+    {
+        delete (uv_async_t*) handle;
+    }
+
+    uv_async_t* m_async;
+    Deliver m_deliver;
+    void* m_owner;
+    unsigned int m_head;
+    unsigned int m_tail;
+    unsigned long m_dropped;
+    T m_events[Size];
+
+    UvChannel(const UvChannel&);
+    UvChannel& operator=(const UvChannel&);
+};
+}
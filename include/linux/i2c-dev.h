@@ -78,6 +78,7 @@ struct i2c_msg {
 #define I2C_FUNC_I2C 0x00000001
 #define I2C_FUNC_10BIT_ADDR 0x00000002
 #define I2C_FUNC_PROTOCOL_MANGLING 0x00000004
+#define I2C_FUNC_NOSTART 0x00000010
 #define I2C_FUNC_SMBUS_PEC 0x00000008
 #define I2C_FUNC_SMBUS_BLOCK_PROC_CALL 0x00008000
 #define I2C_FUNC_SMBUS_QUICK 0x00010000
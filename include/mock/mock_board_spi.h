@@ -68,6 +68,9 @@ mraa_mock_spi_transfer_buf_replace(mraa_spi_context dev, uint8_t* data, uint8_t*
 mraa_result_t
 mraa_mock_spi_transfer_buf_word_replace(mraa_spi_context dev, uint16_t* data, uint16_t* rxbuf, int length);
 
+mraa_result_t
+mraa_mock_spi_transfer_multi_replace(mraa_spi_context dev, mraa_spi_segment_t* segments, int num_segments);
+
 #ifdef __cplusplus
 }
 #endif
@@ -76,6 +76,7 @@ typedef struct {
     mraa_result_t (*i2c_write_byte_replace) (mraa_i2c_context dev, uint8_t data);
     mraa_result_t (*i2c_write_byte_data_replace) (mraa_i2c_context dev, const uint8_t data, const uint8_t command);
     mraa_result_t (*i2c_write_word_data_replace) (mraa_i2c_context dev, const uint16_t data, const uint8_t command);
+    mraa_result_t (*i2c_transfer_replace) (mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int num_msgs);
     mraa_result_t (*i2c_stop_replace) (mraa_i2c_context dev);
 
     mraa_result_t (*aio_init_internal_replace) (mraa_aio_context dev, int pin);
@@ -106,6 +107,7 @@ typedef struct {
     mraa_result_t (*spi_frequency_replace) (mraa_spi_context dev, int hz);
     mraa_result_t (*spi_transfer_buf_replace) (mraa_spi_context dev, uint8_t* data, uint8_t* rxbuf, int length);
     mraa_result_t (*spi_transfer_buf_word_replace) (mraa_spi_context dev, uint16_t* data, uint16_t* rxbuf, int length);
+    mraa_result_t (*spi_transfer_multi_replace) (mraa_spi_context dev, mraa_spi_segment_t* segments, int num_segments);
     int (*spi_write_replace) (mraa_spi_context dev, uint8_t data);
     int (*spi_write_word_replace) (mraa_spi_context dev, uint16_t data);
     mraa_result_t (*spi_stop_replace) (mraa_spi_context dev);
@@ -51,6 +51,39 @@ extern mraa_lang_func_t* lang_func;
  */
 mraa_result_t mraa_setup_mux_mapped(mraa_pin_t meta);
 
+/**
+ * Check whether a raw gpio is used by any mux program of the platform.
+ *
+ * @param pin raw gpio number
+ * @return mraa_boolean_t true if the gpio is a mux
+ */
+mraa_boolean_t mraa_is_mux_pin(int pin);
+
+/**
+ * Collect the raw gpios used by mux programs of the platform, so
+ * mraa_is_mux_pin() doesn't scan every pin on each gpio init. Called once the
+ * platform is set up.
+ */
+void mraa_mux_pins_build();
+
+/**
+ * Free the set built by mraa_mux_pins_build().
+ */
+void mraa_mux_pins_free();
+
+/**
+ * Forget the cached state of a mux gpio, so the next mux program touching it
+ * is applied again. Used when the gpio is changed outside of the mux setup.
+ *
+ * @param pin raw gpio number
+ */
+void mraa_mux_cache_invalidate(int pin);
+
+/**
+ * Close all mux gpios kept open by mraa_setup_mux_mapped() and drop their state.
+ */
+void mraa_mux_cache_clear();
+
 /**
  * runtime detect running x86 platform
  *
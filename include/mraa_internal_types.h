@@ -34,6 +34,7 @@
 #include "common.h"
 #include "mraa.h"
 #include "mraa_adv_func.h"
+#include "linux/gpio.h"
 
 // Bionic does not implement pthread cancellation API
 #ifndef __BIONIC__
@@ -126,8 +127,30 @@ struct _gpio_group {
 
     /* Event specific fields. */
     int *event_handles;
+    /* GPIO_V2_LINE_FLAG_EDGE_* requested on gpiod_handle, uAPI v2 only. */
+    unsigned long long event_flags;
+
+    /* Prebuilt ioctl arguments of the single line fast path. */
+    struct gpiohandle_data line_data;
+    struct gpio_v2_line_values line_values;
 };
 
+/* Number of edge events queued per chardev line, must be a power of two. */
+#define MRAA_GPIO_EVENT_RING_SIZE 256
+
+/**
+ * Single producer (isr side), single consumer queue of edge events for a line
+ */
+typedef struct {
+    /*@{*/
+    int pin_id; /**< pin id reported with every event of the line */
+    unsigned int head; /**< next slot to fill, only written by the producer */
+    unsigned int tail; /**< next slot to read, only written by the consumer */
+    unsigned long overflow; /**< events dropped while the ring was full */
+    mraa_gpio_edge_event events[MRAA_GPIO_EVENT_RING_SIZE];
+    /*@}*/
+} mraa_gpio_event_ring;
+
 /**
  * A structure representing a gpio pin.
  */
@@ -147,6 +170,9 @@ struct _gpio {
     mraa_boolean_t owner; /**< If this context originally exported the pin */
     mraa_result_t (*mmap_write) (mraa_gpio_context dev, int value);
     int (*mmap_read) (mraa_gpio_context dev);
+    /* Optional, write/read a whole 32 pin register bank (dev->pin / 32) at once. */
+    mraa_result_t (*mmap_write_bank) (mraa_gpio_context dev, unsigned int bank, uint32_t set, uint32_t clear);
+    uint32_t (*mmap_read_bank) (mraa_gpio_context dev, unsigned int bank);
     mraa_adv_func_t* advance_func; /**< override function table */
 #if defined(MOCKPLAT)
     mraa_gpio_dir_t mock_dir; /**< mock direction of the pin */
@@ -158,11 +184,24 @@ struct _gpio {
 #endif
 
     struct _gpio_group *gpio_group;
+    struct _gpio_group *gpio_line_group; /**< set when the context holds a single chardev line */
     unsigned int num_chips;
     int *pin_to_gpio_table;
     unsigned int num_pins;
     mraa_gpio_events_t events;
+    mraa_gpio_event_ring *event_rings; /**< per line edge event queues, chardev only */
+    pthread_mutex_t event_rings_lock; /**< serializes readers of event_rings, valid while they exist */
     int *provided_pins;
+    struct _gpio_dispatch_reg *dispatch_reg; /**< registration with the shared isr dispatcher, if any */
+    unsigned int debounce_period_us; /**< kernel debounce of edge events, uAPI v2 only */
+    mraa_gpio_event_clock_t event_clock; /**< clock used for edge event timestamps */
+    struct _gpio_capture *capture; /**< pulse capture state, if running */
+    struct _gpio_filter *filter; /**< software glitch filter applied before the isr, if any */
+    void (*isr_release)(struct _gpio *dev); /**< called by mraa_gpio_isr_exit() once the isr can no longer run */
+    mraa_boolean_t isr_internal; /**< isr is a C function, even with a language binding loaded */
+    mraa_boolean_t mux_pin; /**< raw gpio is also used as a mux, changes invalidate the mux cache */
+    int *multi_value_fps; /**< sysfs multi pin head only: value fds of all pins in order, NULL if they need the full path */
+    int *multi_pins; /**< sysfs multi pin head only: os pin numbers matching multi_value_fps */
 
     struct _gpio *next;
 };
@@ -185,6 +224,9 @@ struct _i2c {
     unsigned long funcs; /**< /dev/i2c-* device capabilities as per https://www.kernel.org/doc/Documentation/i2c/functionality */
     void *handle; /**< generic handle for non-standard drivers that don't use file descriptors  */
     mraa_adv_func_t* advance_func; /**< override function table */
+    struct _i2c_regmap *regmap; /**< register cache, if one was declared */
+    struct _i2c_bus *bus; /**< fd and bound slave address shared by all contexts on the bus */
+    struct _i2c_sched *sched; /**< bus worker this context submitted to, if any */
 #if defined(MOCKPLAT)
     uint8_t mock_dev_addr; /**< address of the mock I2C device */
     uint8_t mock_dev_data_len; /**< mock device data register block length in bytes */
@@ -203,11 +245,20 @@ struct _i2c {
 struct _spi {
     /*@{*/
     int devfd;          /**< File descriptor to SPI Device */
+    int busnum;         /**< the bus number of the /dev/spidev* device */
     uint32_t mode;      /**< Spi mode see spidev.h */
     int clock;          /**< clock to run transactions at */
     mraa_boolean_t lsb; /**< least significant bit mode */
+    mraa_boolean_t soft_lsb; /**< lsb mode done in software, the controller can't */
+    mraa_spi_word_order_t word_order; /**< byte order of the words of the word functions */
     unsigned int bpw;   /**< Bits per word */
+    int bufsiz;         /**< largest spidev message, longer transfers are split */
     mraa_adv_func_t* advance_func; /**< override function table */
+    struct _spi_stream *stream; /**< streaming reader, if started */
+#if defined(MOCKPLAT)
+    uint8_t* mock_last_tx; /**< copy of the last buffer sent with transfer_buf */
+    int mock_last_tx_len; /**< bytes in mock_last_tx */
+#endif
     /*@}*/
 #ifdef PERIPHERALMAN
     ASpiDevice *bspi;
@@ -272,6 +323,9 @@ struct _iio {
     void (* isr_event)(struct iio_event_data* data, void* args); /**< the event interrupt service request */
     int chan_num;
     pthread_t thread_id; /**< the isr handler thread id */
+#ifndef HAVE_PTHREAD_CANCEL
+    int isr_control_pipe[2]; /**< a pipe used to interrupt the isr handler from polling fp/fp_event */
+#endif
     mraa_iio_channel* channels;
     int event_num;
     mraa_iio_event* events;
@@ -24,4 +24,43 @@
 
 #pragma once
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "gpio.h"
+
 void mraa_python_isr(void (*isr)(void*), void* isr_args);
+
+/**
+ * Collect edges in a native ring buffer and hand them to pyfunc as a list of
+ * (pin, timestamp, edge) tuples, with one GIL acquisition per list. pyfunc is
+ * called once max_events edges are pending or max_latency_us after the first
+ * pending one, whatever comes first. With pyfunc None the edges are only
+ * buffered for mraa_python_read_events(). Ended by mraa_gpio_isr_exit().
+ *
+ * @param dev The Gpio context
+ * @param mode The edge mode to set
+ * @param pyfunc Python callable or None
+ * @param max_events Number of edges that trigger a call, at least 1
+ * @param max_latency_us Longest time an edge waits for its call
+ * @return Result of operation
+ */
+mraa_result_t mraa_python_isr_batch(mraa_gpio_context dev,
+                                    mraa_gpio_edge_t mode,
+                                    PyObject* pyfunc,
+                                    unsigned int max_events,
+                                    unsigned int max_latency_us);
+
+/**
+ * Take up to max buffered edges of a batched isr, called with the GIL held.
+ *
+ * @param dev The Gpio context
+ * @param max Most edges to return
+ * @return New list of (pin, timestamp, edge) tuples, NULL with an exception set on error
+ */
+PyObject* mraa_python_read_events(mraa_gpio_context dev, int max);
+
+#ifdef __cplusplus
+}
+#endif
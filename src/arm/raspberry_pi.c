@@ -374,6 +374,24 @@ mraa_raspberry_pi_mmap_unsetup()
     return MRAA_SUCCESS;
 }
 
+static mraa_result_t
+mraa_raspberry_pi_mmap_write_bank(mraa_gpio_context dev, unsigned int bank, uint32_t set, uint32_t clear)
+{
+    if (set) {
+        *(volatile uint32_t*) (mmap_reg + BCM283X_GPSET0 + bank * 4) = set;
+    }
+    if (clear) {
+        *(volatile uint32_t*) (mmap_reg + BCM283X_GPCLR0 + bank * 4) = clear;
+    }
+    return MRAA_SUCCESS;
+}
+
+static uint32_t
+mraa_raspberry_pi_mmap_read_bank(mraa_gpio_context dev, unsigned int bank)
+{
+    return *(volatile uint32_t*) (mmap_reg + BCM2835_GPLEV0 + bank * 4);
+}
+
 int
 mraa_raspberry_pi_mmap_read(mraa_gpio_context dev)
 {
@@ -399,6 +417,8 @@ mraa_raspberry_pi_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
+        dev->mmap_write_bank = NULL;
+        dev->mmap_read_bank = NULL;
         mmap_count--;
         if (mmap_count == 0) {
             return mraa_raspberry_pi_mmap_unsetup();
@@ -431,6 +451,8 @@ mraa_raspberry_pi_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
     }
     dev->mmap_write = &mraa_raspberry_pi_mmap_write;
     dev->mmap_read = &mraa_raspberry_pi_mmap_read;
+    dev->mmap_write_bank = &mraa_raspberry_pi_mmap_write_bank;
+    dev->mmap_read_bank = &mraa_raspberry_pi_mmap_read_bank;
     mmap_count++;
 
     return MRAA_SUCCESS;
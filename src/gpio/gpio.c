@@ -26,6 +26,9 @@
 #include "linux/gpio.h"
 #include "mraa_internal.h"
 #include "gpio/gpio_chardev.h"
+#include "gpio/gpio_dispatcher.h"
+#include "gpio/gpio_capture.h"
+#include "gpio/gpio_filter.h"
 
 #include <dirent.h>
 #include <errno.h>
@@ -34,16 +37,22 @@
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 
 #define SYSFS_CLASS_GPIO "/sys/class/gpio"
 #define MAX_SIZE 64
 #define POLL_TIMEOUT
+/* How long mraa_gpio_init_bulk() waits for udev to set up exported gpios. */
+#define MRAA_GPIO_EXPORT_TIMEOUT_MS 2000
+#define MRAA_GPIO_EXPORT_RETRY_MS 10
 
 static mraa_result_t
 _mraa_gpio_get_valfp(mraa_gpio_context dev)
@@ -91,6 +100,7 @@ mraa_gpio_init_internal(mraa_adv_func_t* func_table, int pin)
 
     dev->advance_func = func_table;
     dev->pin = pin;
+    dev->mux_pin = mraa_is_mux_pin(pin);
 
     if (IS_FUNC_DEFINED(dev, gpio_init_internal_replace)) {
         status = dev->advance_func->gpio_init_internal_replace(dev, pin);
@@ -162,6 +172,51 @@ init_internal_cleanup:
     return dev;
 }
 
+static mraa_result_t
+mraa_gpio_setup_pin(mraa_board_t* board, int pin)
+{
+    if (pin < 0 || pin >= board->phy_pin_count) {
+        syslog(LOG_ERR, "gpio: init: pin %i beyond platform pin count (%i)",
+               pin, board->phy_pin_count);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+    if (board->pins[pin].capabilities.gpio != 1) {
+        syslog(LOG_ERR, "gpio: init: pin %i not capable of gpio", pin);
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+    if (board->pins[pin].gpio.mux_total > 0) {
+        if (mraa_setup_mux_mapped(board->pins[pin].gpio) != MRAA_SUCCESS) {
+            syslog(LOG_ERR, "gpio%i: init: unable to setup muxes", pin);
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+    }
+
+    return MRAA_SUCCESS;
+}
+
+static mraa_gpio_context
+mraa_gpio_init_pin(mraa_board_t* board, int pin)
+{
+    mraa_gpio_context r = mraa_gpio_init_internal(board->adv_func, board->pins[pin].gpio.pinmap);
+
+    if (r == NULL) {
+        return NULL;
+    }
+
+    if (r->phy_pin == -1)
+        r->phy_pin = pin;
+
+    if (IS_FUNC_DEFINED(r, gpio_init_post)) {
+        mraa_result_t ret = r->advance_func->gpio_init_post(r);
+        if (ret != MRAA_SUCCESS) {
+            free(r);
+            return NULL;
+        }
+    }
+
+    return r;
+}
+
 mraa_gpio_context
 mraa_gpio_init(int pin)
 {
@@ -197,40 +252,11 @@ mraa_gpio_init(int pin)
         return mraa_gpio_init_multi(pins, 1);
     }
 
-    if (pin < 0 || pin >= board->phy_pin_count) {
-        syslog(LOG_ERR, "gpio: init: pin %i beyond platform pin count (%i)",
-               pin, board->phy_pin_count);
+    if (mraa_gpio_setup_pin(board, pin) != MRAA_SUCCESS) {
         return NULL;
     }
-    if (board->pins[pin].capabilities.gpio != 1) {
-        syslog(LOG_ERR, "gpio: init: pin %i not capable of gpio", pin);
-        return NULL;
-    }
-    if (board->pins[pin].gpio.mux_total > 0) {
-        if (mraa_setup_mux_mapped(board->pins[pin].gpio) != MRAA_SUCCESS) {
-            syslog(LOG_ERR, "gpio%i: init: unable to setup muxes", pin);
-            return NULL;
-        }
-    }
-
-    mraa_gpio_context r = mraa_gpio_init_internal(board->adv_func, board->pins[pin].gpio.pinmap);
-
-    if (r == NULL) {
-        return NULL;
-    }
-
-    if (r->phy_pin == -1)
-        r->phy_pin = pin;
-
-    if (IS_FUNC_DEFINED(r, gpio_init_post)) {
-        mraa_result_t ret = r->advance_func->gpio_init_post(r);
-        if (ret != MRAA_SUCCESS) {
-            free(r);
-            return NULL;
-        }
-    }
 
-    return r;
+    return mraa_gpio_init_pin(board, pin);
 }
 
 mraa_gpio_context
@@ -393,12 +419,90 @@ mraa_gpio_chardev_init(int pins[], int num_pins)
 
     memcpy(dev->provided_pins, pins, dev->num_pins * sizeof(int));
 
+    /* Single pins skip the group bookkeeping on read/write. */
+    if (num_pins == 1) {
+        dev->gpio_line_group = &gpio_group[dev->pin_to_gpio_table[0]];
+        dev->gpio_line_group->line_values.mask = 1;
+    }
+
     /* Initialize events array. */
     dev->events = NULL;
 
     return dev;
 }
 
+/*
+ * Give the head of a sysfs multi pin context its own flat arrays of value fds
+ * and pin numbers, so read_multi/write_multi don't go through mraa_gpio_read()
+ * and mraa_gpio_write() for every pin. Pins with read/write hooks, mmap access
+ * or mux duty keep the full per pin path, as does a list with missing pins.
+ */
+static void
+_mraa_gpio_multi_setup_sysfs(mraa_gpio_context head)
+{
+    mraa_gpio_context it;
+    unsigned int count = 0;
+
+    for (it = head; it != NULL; it = it->next) {
+        if (IS_FUNC_DEFINED(it, gpio_read_replace) || IS_FUNC_DEFINED(it, gpio_write_replace) ||
+            IS_FUNC_DEFINED(it, gpio_write_pre) || IS_FUNC_DEFINED(it, gpio_write_post) ||
+            it->mmap_read != NULL || it->mmap_write != NULL || it->mux_pin ||
+            mraa_is_sub_platform_id(it->pin)) {
+            return;
+        }
+        count++;
+    }
+
+    if (count != head->num_pins) {
+        return;
+    }
+
+    int* fps = malloc(count * sizeof(int));
+    int* pins = malloc(count * sizeof(int));
+    if (fps == NULL || pins == NULL) {
+        free(fps);
+        free(pins);
+        return;
+    }
+
+    unsigned int i = 0;
+    for (it = head; it != NULL; it = it->next, i++) {
+        char bu[MAX_SIZE];
+        snprintf(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/value", it->pin);
+        fps[i] = open(bu, O_RDWR);
+        if (fps[i] == -1) {
+            syslog(LOG_DEBUG, "gpio%i: init_multi: no direct 'value' access, using the per pin path",
+                   it->pin);
+            while (i > 0) {
+                close(fps[--i]);
+            }
+            free(fps);
+            free(pins);
+            return;
+        }
+        pins[i] = it->pin;
+    }
+
+    head->multi_value_fps = fps;
+    head->multi_pins = pins;
+}
+
+static void
+_mraa_gpio_multi_free_sysfs(mraa_gpio_context head)
+{
+    if (head->multi_value_fps == NULL) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < head->num_pins; i++) {
+        close(head->multi_value_fps[i]);
+    }
+    free(head->multi_value_fps);
+    free(head->multi_pins);
+    head->multi_value_fps = NULL;
+    head->multi_pins = NULL;
+}
+
 mraa_gpio_context
 mraa_gpio_init_multi(int pins[], int num_pins)
 {
@@ -435,6 +539,7 @@ mraa_gpio_init_multi(int pins[], int num_pins)
 
     if (head != NULL) {
         head->num_pins = num_pins;
+        _mraa_gpio_multi_setup_sysfs(head);
     }
 
     return head;
@@ -446,6 +551,219 @@ mraa_gpio_init_raw(int pin)
     return mraa_gpio_init_internal(plat == NULL ? NULL : plat->adv_func, pin);
 }
 
+/*
+ * Wait until the 'value' node of every context without one open can be
+ * opened, i.e. udev is done with the freshly exported gpios. Permission
+ * changes are picked up through inotify, nodes that do not exist yet (sysfs
+ * does not notify on kernel side creation) are retried on a short tick.
+ */
+static mraa_result_t
+mraa_gpio_wait_value_nodes(mraa_gpio_context devs[], mraa_boolean_t wait[], int num_pins)
+{
+    char bu[MAX_SIZE];
+    struct timespec start, now;
+    int pending, unwatched, i;
+    int* watches;
+    int notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    watches = malloc(num_pins * sizeof(int));
+    if (watches == NULL) {
+        syslog(LOG_CRIT, "gpio: init_bulk: Failed to allocate memory for watches");
+        if (notify_fd != -1)
+            close(notify_fd);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    for (i = 0; i < num_pins; i++) {
+        watches[i] = -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        pending = unwatched = 0;
+        for (i = 0; i < num_pins; i++) {
+            if (!wait[i] || devs[i]->value_fp != -1) {
+                continue;
+            }
+            snprintf(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/value", devs[i]->pin);
+            devs[i]->value_fp = open(bu, O_RDWR);
+            if (devs[i]->value_fp != -1) {
+                continue;
+            }
+            if (errno != ENOENT && errno != EACCES && errno != EPERM) {
+                syslog(LOG_ERR, "gpio%i: init_bulk: Failed to open 'value': %s", devs[i]->pin,
+                       strerror(errno));
+                free(watches);
+                if (notify_fd != -1)
+                    close(notify_fd);
+                return MRAA_ERROR_INVALID_RESOURCE;
+            }
+            if (notify_fd != -1 && watches[i] == -1) {
+                watches[i] = inotify_add_watch(notify_fd, bu, IN_ATTRIB);
+            }
+            if (watches[i] == -1) {
+                unwatched++;
+            }
+            pending++;
+        }
+
+        if (pending == 0) {
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (elapsed_ms >= MRAA_GPIO_EXPORT_TIMEOUT_MS) {
+            syslog(LOG_ERR, "gpio: init_bulk: %d 'value' nodes not accessible after %d ms", pending,
+                   MRAA_GPIO_EXPORT_TIMEOUT_MS);
+            free(watches);
+            if (notify_fd != -1)
+                close(notify_fd);
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+
+        if (notify_fd != -1) {
+            struct pollfd pfd = { .fd = notify_fd, .events = POLLIN };
+            char events[sizeof(struct inotify_event) + NAME_MAX + 1];
+            int timeout = unwatched ? MRAA_GPIO_EXPORT_RETRY_MS : MRAA_GPIO_EXPORT_TIMEOUT_MS - elapsed_ms;
+            if (poll(&pfd, 1, timeout) > 0) {
+                while (read(notify_fd, events, sizeof(events)) > 0)
+                    ;
+            }
+        } else {
+            usleep(MRAA_GPIO_EXPORT_RETRY_MS * 1000);
+        }
+    }
+
+    free(watches);
+    if (notify_fd != -1)
+        close(notify_fd);
+
+    return MRAA_SUCCESS;
+}
+
+mraa_gpio_context*
+mraa_gpio_init_bulk(int pins[], int num_pins)
+{
+    char bu[MAX_SIZE];
+    int i, length, export = -1;
+    mraa_boolean_t* exported = NULL;
+    mraa_boolean_t* deferred = NULL;
+    mraa_gpio_context* devs;
+
+    if (plat == NULL) {
+        syslog(LOG_ERR, "gpio: init_bulk: platform not initialised");
+        return NULL;
+    }
+
+    if (pins == NULL || num_pins <= 0) {
+        syslog(LOG_ERR, "gpio: init_bulk: no pins given");
+        return NULL;
+    }
+
+    devs = calloc(num_pins, sizeof(mraa_gpio_context));
+    exported = calloc(num_pins, sizeof(mraa_boolean_t));
+    deferred = calloc(num_pins, sizeof(mraa_boolean_t));
+    if (devs == NULL || exported == NULL || deferred == NULL) {
+        syslog(LOG_CRIT, "gpio: init_bulk: Failed to allocate memory for contexts");
+        goto init_bulk_fail;
+    }
+
+    /* Platforms that hook into the export itself, chardev platforms and sub
+     * platform pins go through the regular init one by one. */
+    mraa_boolean_t plain_sysfs = !plat->chardev_capable &&
+                                 (plat->adv_func == NULL || (plat->adv_func->gpio_init_internal_replace == NULL &&
+                                                             plat->adv_func->gpio_init_pre == NULL));
+
+    for (i = 0; i < num_pins; i++) {
+        if (!plain_sysfs || mraa_is_sub_platform_id(pins[i])) {
+            devs[i] = mraa_gpio_init(pins[i]);
+            if (devs[i] == NULL) {
+                goto init_bulk_fail;
+            }
+            continue;
+        }
+
+        if (mraa_gpio_setup_pin(plat, pins[i]) != MRAA_SUCCESS) {
+            goto init_bulk_fail;
+        }
+        deferred[i] = 1;
+
+        /* Write all the exports in one go, the nodes are waited for below. */
+        snprintf(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/", plat->pins[pins[i]].gpio.pinmap);
+        struct stat dir;
+        if (stat(bu, &dir) == 0 && S_ISDIR(dir.st_mode)) {
+            continue;
+        }
+        if (export == -1) {
+            export = open(SYSFS_CLASS_GPIO "/export", O_WRONLY);
+            if (export == -1) {
+                syslog(LOG_ERR, "gpio: init_bulk: Failed to open 'export' for writing: %s",
+                       strerror(errno));
+                goto init_bulk_fail;
+            }
+        }
+        length = snprintf(bu, sizeof(bu), "%d", plat->pins[pins[i]].gpio.pinmap);
+        if (write(export, bu, length * sizeof(char)) == -1) {
+            syslog(LOG_ERR, "gpio%i: init_bulk: Failed to write to 'export': %s",
+                   plat->pins[pins[i]].gpio.pinmap, strerror(errno));
+            goto init_bulk_fail;
+        }
+        exported[i] = 1;
+    }
+
+    if (export != -1) {
+        close(export);
+        export = -1;
+    }
+
+    for (i = 0; i < num_pins; i++) {
+        if (devs[i] != NULL) {
+            continue;
+        }
+        devs[i] = mraa_gpio_init_pin(plat, pins[i]);
+        if (devs[i] == NULL) {
+            goto init_bulk_fail;
+        }
+        /* The node already existed when the context was set up. */
+        devs[i]->owner = exported[i];
+        exported[i] = 0;
+    }
+
+    if (plain_sysfs && mraa_gpio_wait_value_nodes(devs, deferred, num_pins) != MRAA_SUCCESS) {
+        goto init_bulk_fail;
+    }
+
+    free(exported);
+    free(deferred);
+    return devs;
+
+init_bulk_fail:
+    if (export != -1) {
+        close(export);
+    }
+    if (devs != NULL) {
+        for (i = 0; i < num_pins; i++) {
+            if (devs[i] != NULL) {
+                mraa_gpio_close(devs[i]);
+            } else if (exported != NULL && exported[i]) {
+                int unexport = open(SYSFS_CLASS_GPIO "/unexport", O_WRONLY);
+                if (unexport != -1) {
+                    length = snprintf(bu, sizeof(bu), "%d", plat->pins[pins[i]].gpio.pinmap);
+                    if (write(unexport, bu, length * sizeof(char)) == -1) {
+                        syslog(LOG_ERR, "gpio%i: init_bulk: Failed to unexport: %s",
+                               plat->pins[pins[i]].gpio.pinmap, strerror(errno));
+                    }
+                    close(unexport);
+                }
+            }
+        }
+        free(devs);
+    }
+    free(exported);
+    free(deferred);
+    return NULL;
+}
+
 mraa_timestamp_t
 _mraa_gpio_get_timestamp_sysfs()
 {
@@ -455,17 +773,37 @@ _mraa_gpio_get_timestamp_sysfs()
     return (time.tv_sec * 1e6 + time.tv_usec);
 }
 
+/* poll() timeout until the next edge held by the glitch filter is due, -1 if none. */
+static int
+mraa_gpio_filter_timeout(mraa_gpio_context dev)
+{
+    uint64_t deadline = _mraa_gpio_filter_deadline(dev);
+    uint64_t now;
+
+    if (deadline == 0) {
+        return -1;
+    }
+
+    now = _mraa_gpio_filter_now();
+    if (deadline <= now) {
+        return 0;
+    }
+
+    /* Rounded up, the edge has to be due once poll() returns. */
+    return (deadline - now + 999999) / 1000000;
+}
+
 static mraa_result_t
-mraa_gpio_wait_interrupt(int fds[],
+mraa_gpio_wait_interrupt(mraa_gpio_context dev,
+                         int fds[],
                          int num_fds
 #ifndef HAVE_PTHREAD_CANCEL
                          ,
                          int control_fd
 #endif
-                        ,
-                         mraa_gpio_events_t events
 )
 {
+    mraa_gpio_events_t events = dev->events;
     unsigned char c;
 #ifdef HAVE_PTHREAD_CANCEL
     struct pollfd pfd[num_fds];
@@ -487,61 +825,73 @@ mraa_gpio_wait_interrupt(int fds[],
         pfd[i].events = POLLPRI;
 
         // do an initial read to clear interrupt
-        lseek(fds[i], 0, SEEK_SET);
-        read(fds[i], &c, 1);
+        pread(fds[i], &c, 1, 0);
     }
 
+    int timeout = mraa_gpio_filter_timeout(dev);
+
 #ifdef HAVE_PTHREAD_CANCEL
-    // Wait for it forever or until pthread_cancel
-    // poll is a cancelable point like sleep()
-    poll(pfd, num_fds, -1);
+    // Wait for it forever (or the next edge held by the glitch filter) or
+    // until pthread_cancel, poll is a cancelable point like sleep()
+    poll(pfd, num_fds, timeout);
 #else
     // setup poll on the controling fd
     pfd[num_fds].fd = control_fd;
     pfd[num_fds].events = 0; //  POLLHUP, POLLERR, and POLLNVAL
 
     // Wait for it forever or until control fd is closed
-    poll(pfd, num_fds + 1, -1);
+    poll(pfd, num_fds + 1, timeout);
 #endif
 
+    for (int i = 0; i < num_fds; ++i) {
+        events[i].id = -1;
+    }
+    _mraa_gpio_filter_expire(dev, _mraa_gpio_filter_now());
+
     for (int i = 0; i < num_fds; ++i) {
         if (pfd[i].revents & POLLPRI) {
-            read(fds[i], &c, 1);
-            events[i].id = i;
-            events[i].timestamp = _mraa_gpio_get_timestamp_sysfs();
-        } else
-            events[i].id = -1;
+            mraa_timestamp_t timestamp = _mraa_gpio_get_timestamp_sysfs();
+            int level = -1;
+
+            // the value read also clears the interrupt
+            if (pread(fds[i], &c, 1, 0) == 1 && (c == '0' || c == '1')) {
+                level = c - '0';
+            }
+
+            mraa_gpio_filter_edge edge = { timestamp * 1000, timestamp, level, 0, 0, 0 };
+            _mraa_gpio_filter_edge(dev, i, &edge);
+        }
     }
 
     return MRAA_SUCCESS;
 }
 
 static mraa_result_t
-mraa_gpio_chardev_wait_interrupt(int fds[], int num_fds, mraa_gpio_events_t events)
+mraa_gpio_chardev_wait_interrupt(mraa_gpio_context dev, mraa_gpiod_event_source sources[], int num_sources)
 {
-    struct pollfd pfd[num_fds];
-    struct gpioevent_data event_data;
+    struct pollfd pfd[num_sources];
 
-    if (!fds) {
+    if (!sources) {
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    for (int i = 0; i < num_fds; ++i) {
-        pfd[i].fd = fds[i];
+    for (int i = 0; i < num_sources; ++i) {
+        pfd[i].fd = sources[i].fd;
         pfd[i].events = POLLIN;
-
-        lseek(fds[i], 0, SEEK_SET);
     }
 
-    poll(pfd, num_fds, -1);
+    poll(pfd, num_sources, mraa_gpio_filter_timeout(dev));
 
-    for (int i = 0; i < num_fds; ++i) {
+    for (int i = 0; i < dev->num_pins; ++i) {
+        dev->events[i].id = -1;
+    }
+    _mraa_gpio_filter_expire(dev, _mraa_gpio_filter_now());
+
+    for (int i = 0; i < num_sources; ++i) {
+        /* Drain everything queued so bursts cost one wakeup. */
         if (pfd[i].revents & POLLIN) {
-            read(fds[i], &event_data, sizeof(event_data));
-            events[i].id = i;
-            events[i].timestamp = event_data.timestamp;
-        } else
-            events[i].id = -1;
+            _mraa_gpio_chardev_read_events(dev, sources[i].group, sources[i].line_idx, sources[i].fd);
+        }
     }
 
     return MRAA_SUCCESS;
@@ -609,17 +959,21 @@ mraa_gpio_interrupt_handler(void* arg)
         return NULL;
     }
 
+    mraa_gpiod_event_source* sources = NULL;
+
     /* Is this pin on a subplatform? Do nothing... */
     if (mraa_is_sub_platform_id(dev->pin)) {}
     /* Is the platform chardev_capable? */
     else if (plat->chardev_capable) {
-        mraa_gpiod_group_t gpio_group;
-
-        for_each_gpio_group(gpio_group, dev) {
-            for (int i = 0; i < gpio_group->num_gpio_lines; ++i) {
-                fps[idx++] = gpio_group->event_handles[i];
-            }
+        sources = malloc(dev->num_pins * sizeof(mraa_gpiod_event_source));
+        if (!sources) {
+            syslog(LOG_ERR, "mraa_gpio_interrupt_handler_multiple() malloc error");
+            free(fps);
+            return NULL;
         }
+
+        /* The event fds stay owned by the gpio groups. */
+        idx = _mraa_gpio_chardev_event_sources(dev, sources);
     }
     /* Else, attempt fs access */
     else {
@@ -665,24 +1019,28 @@ mraa_gpio_interrupt_handler(void* arg)
             ret = dev->advance_func->gpio_wait_interrupt_replace(dev);
         } else {
             if (plat->chardev_capable) {
-                ret = mraa_gpio_chardev_wait_interrupt(fps, idx, dev->events);
+                ret = mraa_gpio_chardev_wait_interrupt(dev, sources, idx);
             } else {
-                ret = mraa_gpio_wait_interrupt(fps, idx
+                ret = mraa_gpio_wait_interrupt(dev, fps, idx
 #ifndef HAVE_PTHREAD_CANCEL
                                                 ,
                                                 dev->isr_control_pipe[0]
 #endif
-                                                ,
-                                                dev->events
                 );
             }
         }
 
+        if (ret == MRAA_SUCCESS && !dev->isr_thread_terminating &&
+            !IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace) && !_mraa_gpio_filter_pending(dev)) {
+            /* Every edge of this wakeup was a glitch. */
+            continue;
+        }
+
         if (ret == MRAA_SUCCESS && !dev->isr_thread_terminating) {
 #ifdef HAVE_PTHREAD_CANCEL
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 #endif
-            if (lang_func->python_isr != NULL) {
+            if (lang_func->python_isr != NULL && !dev->isr_internal) {
                 lang_func->python_isr(dev->isr, dev->isr_args);
             } else {
                 dev->isr(dev->isr_args);
@@ -695,7 +1053,12 @@ mraa_gpio_interrupt_handler(void* arg)
 #ifdef HAVE_PTHREAD_CANCEL
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 #endif
-            mraa_gpio_close_event_handles_sysfs(fps, dev->num_pins);
+            if (sources != NULL) {
+                free(sources);
+                free(fps);
+            } else {
+                mraa_gpio_close_event_handles_sysfs(fps, dev->num_pins);
+            }
 
             if (lang_func->java_detach_thread != NULL && lang_func->java_delete_global_ref != NULL) {
                 if (dev->isr == lang_func->java_isr_callback) {
@@ -709,6 +1072,50 @@ mraa_gpio_interrupt_handler(void* arg)
     }
 }
 
+static mraa_result_t mraa_gpio_chardev_alloc_event_rings(mraa_gpio_context dev);
+
+/* One request per gpio group carries values and edge events of all its lines. */
+static mraa_result_t
+mraa_gpio_chardev_edge_mode_v2(mraa_gpio_context dev, mraa_gpio_edge_t mode)
+{
+    unsigned long long event_flags;
+    mraa_gpiod_group_t gpio_group;
+
+    switch (mode) {
+        case MRAA_GPIO_EDGE_BOTH:
+            event_flags = GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+            break;
+        case MRAA_GPIO_EDGE_RISING:
+            event_flags = GPIO_V2_LINE_FLAG_EDGE_RISING;
+            break;
+        case MRAA_GPIO_EDGE_FALLING:
+            event_flags = GPIO_V2_LINE_FLAG_EDGE_FALLING;
+            break;
+        case MRAA_GPIO_EDGE_NONE:
+            event_flags = 0;
+            break;
+        default:
+            return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
+    }
+
+    for_each_gpio_group(gpio_group, dev) {
+        gpio_group->event_flags = event_flags;
+
+        unsigned flags = GPIOHANDLE_REQUEST_INPUT | (gpio_group->flags & GPIOHANDLE_REQUEST_ACTIVE_LOW);
+        if (_mraa_gpiod_request_lines(dev, gpio_group, flags) < 0) {
+            syslog(LOG_ERR, "error requesting edge events for gpio chip %u", gpio_group->gpio_chip);
+            gpio_group->event_flags = 0;
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+    }
+
+    if (mode == MRAA_GPIO_EDGE_NONE) {
+        return MRAA_SUCCESS;
+    }
+
+    return mraa_gpio_chardev_alloc_event_rings(dev);
+}
+
 mraa_result_t
 mraa_gpio_chardev_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode)
 {
@@ -727,6 +1134,10 @@ mraa_gpio_chardev_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode)
 
     struct gpioevent_request req;
 
+    if (_mraa_gpiod_v2_capable()) {
+        return mraa_gpio_chardev_edge_mode_v2(dev, mode);
+    }
+
     switch (mode) {
         case MRAA_GPIO_EDGE_BOTH:
             req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
@@ -766,10 +1177,39 @@ mraa_gpio_chardev_edge_mode(mraa_gpio_context dev, mraa_gpio_edge_t mode)
                 return MRAA_ERROR_INVALID_RESOURCE;
             }
 
+            /* Let readers drain the kernel queue without blocking. */
+            fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+
             gpio_group->event_handles[i] = req.fd;
         }
     }
 
+    return mraa_gpio_chardev_alloc_event_rings(dev);
+}
+
+static mraa_result_t
+mraa_gpio_chardev_alloc_event_rings(mraa_gpio_context dev)
+{
+    mraa_gpiod_group_t gpio_group;
+
+    if (dev->event_rings == NULL) {
+        int idx = 0;
+
+        dev->event_rings = calloc(dev->num_pins, sizeof(mraa_gpio_event_ring));
+        if (dev->event_rings == NULL) {
+            syslog(LOG_ERR, "mraa_gpio_chardev_edge_mode(): malloc error!");
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+        /* Lives as long as the rings, shared by the v1 and v2 backends. */
+        pthread_mutex_init(&dev->event_rings_lock, NULL);
+
+        for_each_gpio_group(gpio_group, dev) {
+            for (int i = 0; i < gpio_group->num_gpio_lines; ++i) {
+                dev->event_rings[idx++].pin_id = dev->provided_pins[gpio_group->gpio_group_to_pins_table[i]];
+            }
+        }
+    }
+
     return MRAA_SUCCESS;
 }
 
@@ -865,7 +1305,7 @@ mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t mode, void (*fptr)(void*),
     }
 
     // we only allow one isr per mraa_gpio_context
-    if (dev->thread_id != 0) {
+    if (dev->thread_id != 0 || dev->dispatch_reg != NULL) {
         return MRAA_ERROR_NO_RESOURCES;
     }
 
@@ -890,6 +1330,16 @@ mraa_gpio_isr(mraa_gpio_context dev, mraa_gpio_edge_t mode, void (*fptr)(void*),
 
     dev->isr_args = args;
 
+    /* Platforms replacing the wait loop keep their own thread. */
+    if (mraa_gpio_dispatcher_enabled() && !mraa_is_sub_platform_id(dev->pin) &&
+        !IS_FUNC_DEFINED(dev, gpio_interrupt_handler_init_replace) &&
+        !IS_FUNC_DEFINED(dev, gpio_wait_interrupt_replace)) {
+        if (mraa_gpio_dispatcher_register(dev) == MRAA_SUCCESS) {
+            return MRAA_SUCCESS;
+        }
+        syslog(LOG_NOTICE, "gpio%i: isr: dispatcher unavailable, using a dedicated thread", dev->pin);
+    }
+
     pthread_create(&dev->thread_id, NULL, mraa_gpio_interrupt_handler, (void*) dev);
 
     return MRAA_SUCCESS;
@@ -909,12 +1359,17 @@ mraa_gpio_isr_exit(mraa_gpio_context dev)
     }
 
     // wasting our time, there is no isr to exit from
-    if (dev->thread_id == 0) {
+    if (dev->thread_id == 0 && dev->dispatch_reg == NULL) {
         return ret;
     }
     // mark the beginning of the thread termination process for interested parties
     dev->isr_thread_terminating = 1;
 
+    // the dispatcher must forget our fds before they get closed below
+    if (dev->dispatch_reg != NULL) {
+        ret = mraa_gpio_dispatcher_unregister(dev);
+    }
+
     // stop isr being useful
     if (plat && (plat->chardev_capable))
         _mraa_close_gpio_event_handles(dev);
@@ -946,6 +1401,157 @@ mraa_gpio_isr_exit(mraa_gpio_context dev)
       dev->events = NULL;
     }
 
+    if (dev->event_rings) {
+        pthread_mutex_destroy(&dev->event_rings_lock);
+        free(dev->event_rings);
+        dev->event_rings = NULL;
+    }
+
+    _mraa_gpio_capture_free(dev);
+    if (dev->isr_release != NULL) {
+        void (*release)(mraa_gpio_context) = dev->isr_release;
+        dev->isr_release = NULL;
+        release(dev);
+    }
+    dev->isr_internal = 0;
+
+    return ret;
+}
+
+int
+mraa_gpio_read_events(mraa_gpio_context dev, mraa_gpio_edge_event* buf, int max)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: read_events: context is invalid");
+        return -1;
+    }
+
+    if (buf == NULL || max < 0) {
+        syslog(LOG_ERR, "gpio: read_events: invalid buffer");
+        return -1;
+    }
+
+    if (!plat->chardev_capable || dev->event_rings == NULL) {
+        syslog(LOG_ERR, "gpio: read_events: no edge mode set on a chardev context");
+        return -1;
+    }
+
+    /* The capture isr pops the same rings, the edges would be split between the two. */
+    if (_mraa_gpio_capture_running(dev)) {
+        syslog(LOG_ERR, "gpio: read_events: a capture consumes the events of this context");
+        return -1;
+    }
+
+    /* The rings have a single consumer, callers from several threads (or a
+     * batched isr and the application) take turns. */
+    pthread_mutex_lock(&dev->event_rings_lock);
+
+    /* Nobody else reads the event fds, fetch what the kernel has queued. */
+    if (dev->thread_id == 0 && dev->dispatch_reg == NULL) {
+        mraa_gpiod_event_source sources[dev->num_pins];
+        int num_sources = _mraa_gpio_chardev_event_sources(dev, sources);
+
+        _mraa_gpio_filter_expire(dev, _mraa_gpio_filter_now());
+
+        for (int i = 0; i < num_sources; ++i) {
+            _mraa_gpio_chardev_read_events(dev, sources[i].group, sources[i].line_idx, sources[i].fd);
+        }
+    }
+
+    int count = _mraa_gpio_event_rings_pop(dev, buf, NULL, max);
+
+    pthread_mutex_unlock(&dev->event_rings_lock);
+
+    return count;
+}
+
+unsigned long
+mraa_gpio_get_events_overflow(mraa_gpio_context dev)
+{
+    unsigned long overflow = 0;
+
+    if (dev == NULL || dev->event_rings == NULL) {
+        return 0;
+    }
+
+    for (int i = 0; i < dev->num_pins; ++i) {
+        overflow += __atomic_load_n(&dev->event_rings[i].overflow, __ATOMIC_RELAXED);
+    }
+
+    return overflow;
+}
+
+/* Push debounce and event clock changes to lines that are already requested. */
+static mraa_result_t
+mraa_gpio_chardev_reconfigure(mraa_gpio_context dev)
+{
+    mraa_gpiod_group_t gpio_iter;
+
+    for_each_gpio_group(gpio_iter, dev) {
+        if (gpio_iter->gpiod_handle > 0 && _mraa_gpiod_request_lines(dev, gpio_iter, gpio_iter->flags) < 0) {
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+    }
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_debounce(mraa_gpio_context dev, unsigned int period_us)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: debounce: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (!plat->chardev_capable || !_mraa_gpiod_v2_capable()) {
+        syslog(LOG_ERR, "gpio: debounce: needs the GPIO v2 chardev interface");
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    unsigned int previous = dev->debounce_period_us;
+    dev->debounce_period_us = period_us;
+
+    mraa_result_t ret = mraa_gpio_chardev_reconfigure(dev);
+    if (ret != MRAA_SUCCESS) {
+        dev->debounce_period_us = previous;
+        mraa_gpio_chardev_reconfigure(dev);
+    }
+
+    return ret;
+}
+
+mraa_result_t
+mraa_gpio_event_clock(mraa_gpio_context dev, mraa_gpio_event_clock_t clock)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: event_clock: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (clock != MRAA_GPIO_EVENT_CLOCK_MONOTONIC && clock != MRAA_GPIO_EVENT_CLOCK_REALTIME &&
+        clock != MRAA_GPIO_EVENT_CLOCK_HTE) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (!plat->chardev_capable || !_mraa_gpiod_v2_capable()) {
+        if (clock == MRAA_GPIO_EVENT_CLOCK_MONOTONIC) {
+            return MRAA_SUCCESS;
+        }
+        syslog(LOG_ERR, "gpio: event_clock: needs the GPIO v2 chardev interface");
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    mraa_gpio_event_clock_t previous = dev->event_clock;
+    dev->event_clock = clock;
+
+    mraa_result_t ret = mraa_gpio_chardev_reconfigure(dev);
+    if (ret != MRAA_SUCCESS) {
+        /* Most likely no hardware timestamping, keep the old clock working. */
+        dev->event_clock = previous;
+        mraa_gpio_chardev_reconfigure(dev);
+    }
+
     return ret;
 }
 
@@ -957,6 +1563,9 @@ mraa_gpio_mode(mraa_gpio_context dev, mraa_gpio_mode_t mode)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    if (dev->mux_pin)
+        mraa_mux_cache_invalidate(dev->pin);
+
     if (IS_FUNC_DEFINED(dev, gpio_mode_replace))
         return dev->advance_func->gpio_mode_replace(dev, mode);
 
@@ -968,11 +1577,8 @@ mraa_gpio_mode(mraa_gpio_context dev, mraa_gpio_mode_t mode)
 
     if (plat->chardev_capable) {
         unsigned flags = 0;
-        int line_handle;
         mraa_gpiod_group_t gpio_iter;
 
-        _mraa_close_gpio_desc(dev);
-
         /* We save flag values from the first valid line. */
         for_each_gpio_group(gpio_iter, dev) {
             mraa_gpiod_line_info* linfo = mraa_get_line_info_by_chip_number(gpio_iter->gpio_chip, gpio_iter->gpio_lines[0]);
@@ -1003,13 +1609,10 @@ mraa_gpio_mode(mraa_gpio_context dev, mraa_gpio_mode_t mode)
         }
 
         for_each_gpio_group(gpio_iter, dev) {
-            line_handle = mraa_get_lines_handle(gpio_iter->dev_fd, gpio_iter->gpio_lines, gpio_iter->num_gpio_lines, flags, 0);
-            if (line_handle <= 0) {
+            if (_mraa_gpiod_request_lines(dev, gpio_iter, flags) < 0) {
                 syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting line handle");
                 return MRAA_ERROR_INVALID_RESOURCE;
             }
-
-            gpio_iter->gpiod_handle = line_handle;
         }
     } else {
 
@@ -1064,7 +1667,6 @@ mraa_gpio_mode(mraa_gpio_context dev, mraa_gpio_mode_t mode)
 mraa_result_t
 mraa_gpio_chardev_dir(mraa_gpio_context dev, mraa_gpio_dir_t dir)
 {
-    int line_handle;
     unsigned flags = 0;
     mraa_gpiod_group_t gpio_iter;
 
@@ -1095,19 +1697,10 @@ mraa_gpio_chardev_dir(mraa_gpio_context dev, mraa_gpio_dir_t dir)
     }
 
     for_each_gpio_group(gpio_iter, dev) {
-        if (gpio_iter->gpiod_handle != -1) {
-            close(gpio_iter->gpiod_handle);
-            gpio_iter->gpiod_handle = -1;
-        }
-
-        line_handle = mraa_get_lines_handle(gpio_iter->dev_fd, gpio_iter->gpio_lines,
-                                            gpio_iter->num_gpio_lines, flags, 0);
-        if (line_handle <= 0) {
+        if (_mraa_gpiod_request_lines(dev, gpio_iter, flags) < 0) {
             syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting line handle");
             return MRAA_ERROR_INVALID_RESOURCE;
         }
-
-        gpio_iter->gpiod_handle = line_handle;
     }
 
     return MRAA_SUCCESS;
@@ -1121,6 +1714,9 @@ mraa_gpio_dir(mraa_gpio_context dev, mraa_gpio_dir_t dir)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    if (dev->mux_pin)
+        mraa_mux_cache_invalidate(dev->pin);
+
     if (IS_FUNC_DEFINED(dev, gpio_dir_replace)) {
             return dev->advance_func->gpio_dir_replace(dev, dir);
     }
@@ -1289,12 +1885,22 @@ mraa_gpio_read(mraa_gpio_context dev)
     }
 
     if (plat->chardev_capable) {
+        mraa_gpiod_group_t gpio_iter = dev->gpio_line_group;
         int output_values[1] = { 0 };
 
-        if (mraa_gpio_read_multi(dev, output_values) != MRAA_SUCCESS)
+        if (gpio_iter == NULL) {
+            if (mraa_gpio_read_multi(dev, output_values) != MRAA_SUCCESS)
                 return -1;
 
-        return output_values[0];
+            return output_values[0];
+        }
+
+        if (gpio_iter->gpiod_handle <= 0 && _mraa_gpiod_request_lines(dev, gpio_iter, GPIOHANDLE_REQUEST_INPUT) < 0) {
+            syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting gpio line handle");
+            return -1;
+        }
+
+        return _mraa_gpiod_get_line_value(gpio_iter);
     }
 
     if (dev->mmap_read != NULL) {
@@ -1305,19 +1911,16 @@ mraa_gpio_read(mraa_gpio_context dev)
         if (_mraa_gpio_get_valfp(dev) != MRAA_SUCCESS) {
             return -1;
         }
-    } else {
-        // if value_fp is new this is pointless
-        lseek(dev->value_fp, 0, SEEK_SET);
     }
+    // positional read, the file offset of value_fp is never moved
     char bu[2];
-    if (read(dev->value_fp, bu, 2 * sizeof(char)) != 2) {
+    if (pread(dev->value_fp, bu, 2 * sizeof(char), 0) != 2) {
         syslog(LOG_ERR, "gpio%i: read: Failed to read a sensible value from sysfs: %s",
                 dev->pin, strerror(errno));
         return -1;
     }
-    lseek(dev->value_fp, 0, SEEK_SET);
 
-    return (int) strtol(bu, NULL, 10);
+    return bu[0] == '1';
 }
 
 mraa_result_t
@@ -1338,9 +1941,7 @@ mraa_gpio_read_multi(mraa_gpio_context dev, int output_values[])
             unsigned flags = GPIOHANDLE_REQUEST_INPUT;
 
             if (gpio_iter->gpiod_handle <= 0) {
-                gpio_iter->gpiod_handle = mraa_get_lines_handle(gpio_iter->dev_fd, gpio_iter->gpio_lines,
-                                                                 gpio_iter->num_gpio_lines, flags, 0);
-                if (gpio_iter->gpiod_handle <= 0) {
+                if (_mraa_gpiod_request_lines(dev, gpio_iter, flags) < 0) {
                     syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting gpio line handle");
                     return MRAA_ERROR_INVALID_HANDLE;
                 }
@@ -1359,6 +1960,18 @@ mraa_gpio_read_multi(mraa_gpio_context dev, int output_values[])
                 output_values[gpio_iter->gpio_group_to_pins_table[j]] = gpio_iter->rw_values[j];
             }
         }
+    } else if (dev->multi_value_fps != NULL && dev->mmap_read == NULL) {
+        const int* fps = dev->multi_value_fps;
+        char bu[2];
+
+        for (unsigned int i = 0; i < dev->num_pins; i++) {
+            if (pread(fps[i], bu, 2 * sizeof(char), 0) != 2) {
+                syslog(LOG_ERR, "gpio%i: read_multiple: Failed to read a sensible value from sysfs: %s",
+                       dev->multi_pins[i], strerror(errno));
+                return MRAA_ERROR_INVALID_RESOURCE;
+            }
+            output_values[i] = bu[0] == '1';
+        }
     } else {
         mraa_gpio_context it = dev;
         int i = 0;
@@ -1387,6 +2000,9 @@ mraa_gpio_write(mraa_gpio_context dev, int value)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    if (dev->mux_pin)
+        mraa_mux_cache_invalidate(dev->pin);
+
     if (IS_FUNC_DEFINED(dev, gpio_write_pre)) {
         mraa_result_t pre_ret = (dev->advance_func->gpio_write_pre(dev, value));
         if (pre_ret != MRAA_SUCCESS)
@@ -1398,9 +2014,24 @@ mraa_gpio_write(mraa_gpio_context dev, int value)
     }
 
     if (plat->chardev_capable) {
+        mraa_gpiod_group_t gpio_iter = dev->gpio_line_group;
         int input_values[1] = { value };
 
-        return mraa_gpio_write_multi(dev, input_values);
+        if (gpio_iter == NULL) {
+            return mraa_gpio_write_multi(dev, input_values);
+        }
+
+        if (gpio_iter->gpiod_handle <= 0 && _mraa_gpiod_request_lines(dev, gpio_iter, GPIOHANDLE_REQUEST_OUTPUT) < 0) {
+            syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting gpio line handle");
+            return MRAA_ERROR_INVALID_HANDLE;
+        }
+
+        if (_mraa_gpiod_set_line_value(gpio_iter, value) < 0) {
+            syslog(LOG_ERR, "[GPIOD_INTERFACE]: error writing gpio");
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+
+        return MRAA_SUCCESS;
     }
 
     if (dev->mmap_write != NULL) {
@@ -1413,14 +2044,8 @@ mraa_gpio_write(mraa_gpio_context dev, int value)
         }
     }
 
-    if (lseek(dev->value_fp, 0, SEEK_SET) == -1) {
-        syslog(LOG_ERR, "gpio%i: write: Failed to lseek 'value': %s", dev->pin, strerror(errno));
-        return MRAA_ERROR_UNSPECIFIED;
-    }
-
-    char bu[MAX_SIZE];
-    int length = snprintf(bu, sizeof(bu), "%d", value);
-    if (write(dev->value_fp, bu, length * sizeof(char)) == -1) {
+    // sysfs treats any non zero value as high
+    if (pwrite(dev->value_fp, value ? "1" : "0", sizeof(char), 0) == -1) {
         syslog(LOG_ERR, "gpio%i: write: Failed to write to 'value': %s", dev->pin, strerror(errno));
         return MRAA_ERROR_UNSPECIFIED;
     }
@@ -1443,28 +2068,17 @@ mraa_gpio_write_multi(mraa_gpio_context dev, int input_values[])
     if (plat->chardev_capable) {
         mraa_gpiod_group_t gpio_iter;
 
-        int* counters = calloc(dev->num_chips, sizeof(int));
-        if (counters == NULL) {
-            syslog(LOG_ERR, "mraa_gpio_write_multi() malloc error");
-            return MRAA_ERROR_NO_RESOURCES;
-        }
-
-        for (int i = 0; i < dev->num_pins; ++i) {
-            int chip_id = dev->pin_to_gpio_table[i];
-            gpio_iter = &dev->gpio_group[chip_id];
-            gpio_iter->rw_values[counters[chip_id]] = input_values[i];
-            counters[chip_id]++;
-        }
-        free(counters);
-
         for_each_gpio_group(gpio_iter, dev) {
             int status;
             unsigned flags = GPIOHANDLE_REQUEST_OUTPUT;
 
+            /* Gather values in line order through the reverse mapping table. */
+            for (int j = 0; j < gpio_iter->num_gpio_lines; ++j) {
+                gpio_iter->rw_values[j] = input_values[gpio_iter->gpio_group_to_pins_table[j]];
+            }
+
             if (gpio_iter->gpiod_handle <= 0) {
-                gpio_iter->gpiod_handle = mraa_get_lines_handle(gpio_iter->dev_fd, gpio_iter->gpio_lines,
-                                                                gpio_iter->num_gpio_lines, flags, 0);
-                if (gpio_iter->gpiod_handle <= 0) {
+                if (_mraa_gpiod_request_lines(dev, gpio_iter, flags) < 0) {
                     syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting gpio line handle");
                     return MRAA_ERROR_INVALID_HANDLE;
                 }
@@ -1477,6 +2091,16 @@ mraa_gpio_write_multi(mraa_gpio_context dev, int input_values[])
                 return MRAA_ERROR_INVALID_RESOURCE;
             }
         }
+    } else if (dev->multi_value_fps != NULL && dev->mmap_write == NULL) {
+        const int* fps = dev->multi_value_fps;
+
+        for (unsigned int i = 0; i < dev->num_pins; i++) {
+            if (pwrite(fps[i], input_values[i] ? "1" : "0", sizeof(char), 0) == -1) {
+                syslog(LOG_ERR, "gpio%i: write_multiple: Failed to write to 'value': %s",
+                       dev->multi_pins[i], strerror(errno));
+                return MRAA_ERROR_UNSPECIFIED;
+            }
+        }
     } else {
         mraa_gpio_context it = dev;
         int i = 0;
@@ -1495,6 +2119,182 @@ mraa_gpio_write_multi(mraa_gpio_context dev, int input_values[])
     return MRAA_SUCCESS;
 }
 
+/* Enough for the largest mmap capable boards, pins past this go one by one. */
+#define MRAA_GPIO_MMAP_MAX_BANKS 8
+
+mraa_result_t
+mraa_gpio_write_mask(mraa_gpio_context dev, uint32_t mask, uint32_t values)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: write_mask: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (plat->chardev_capable) {
+        mraa_gpiod_group_t gpio_iter;
+
+        for_each_gpio_group(gpio_iter, dev) {
+            unsigned long long line_mask = 0, line_bits = 0;
+
+            for (int j = 0; j < gpio_iter->num_gpio_lines; ++j) {
+                unsigned int pin_idx = gpio_iter->gpio_group_to_pins_table[j];
+
+                if (pin_idx < 32 && (mask & (1u << pin_idx))) {
+                    line_mask |= 1ULL << j;
+                    if (values & (1u << pin_idx)) {
+                        line_bits |= 1ULL << j;
+                    }
+                }
+            }
+
+            if (line_mask == 0) {
+                continue;
+            }
+
+            if (gpio_iter->gpiod_handle <= 0 &&
+                _mraa_gpiod_request_lines(dev, gpio_iter, GPIOHANDLE_REQUEST_OUTPUT) < 0) {
+                syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting gpio line handle");
+                return MRAA_ERROR_INVALID_HANDLE;
+            }
+
+            if (_mraa_gpiod_set_line_values_masked(gpio_iter, line_mask, line_bits) < 0) {
+                syslog(LOG_ERR, "[GPIOD_INTERFACE]: error writing gpio");
+                return MRAA_ERROR_INVALID_RESOURCE;
+            }
+        }
+
+        return MRAA_SUCCESS;
+    }
+
+    uint32_t set[MRAA_GPIO_MMAP_MAX_BANKS] = { 0 };
+    uint32_t clear[MRAA_GPIO_MMAP_MAX_BANKS] = { 0 };
+    mraa_gpio_context it = dev;
+    mraa_result_t status;
+
+    /* Sort mmap'ed pins into per bank set/clear words, write everything else now. */
+    for (int i = 0; it != NULL && i < 32; ++i, it = it->next) {
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+
+        int value = (values >> i) & 1;
+        unsigned int bank = it->pin / 32;
+
+        if (it->mmap_write_bank != NULL && bank < MRAA_GPIO_MMAP_MAX_BANKS) {
+            if (value) {
+                set[bank] |= 1u << (it->pin % 32);
+            } else {
+                clear[bank] |= 1u << (it->pin % 32);
+            }
+            continue;
+        }
+
+        status = mraa_gpio_write(it, value);
+        if (status != MRAA_SUCCESS) {
+            return status;
+        }
+    }
+
+    /* All mmap'ed pins of a context live on the same platform, one writer does. */
+    for (it = dev; it != NULL && it->mmap_write_bank == NULL; it = it->next)
+        ;
+
+    for (unsigned int bank = 0; it != NULL && bank < MRAA_GPIO_MMAP_MAX_BANKS; ++bank) {
+        if (set[bank] || clear[bank]) {
+            status = it->mmap_write_bank(it, bank, set[bank], clear[bank]);
+            if (status != MRAA_SUCCESS) {
+                return status;
+            }
+        }
+    }
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_read_mask(mraa_gpio_context dev, uint32_t mask, uint32_t* values)
+{
+    if (dev == NULL || values == NULL) {
+        syslog(LOG_ERR, "gpio: read_mask: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    *values = 0;
+
+    if (plat->chardev_capable) {
+        mraa_gpiod_group_t gpio_iter;
+
+        for_each_gpio_group(gpio_iter, dev) {
+            mraa_boolean_t wanted = 0;
+
+            for (int j = 0; j < gpio_iter->num_gpio_lines; ++j) {
+                unsigned int pin_idx = gpio_iter->gpio_group_to_pins_table[j];
+                if (pin_idx < 32 && (mask & (1u << pin_idx))) {
+                    wanted = 1;
+                }
+            }
+
+            if (!wanted) {
+                continue;
+            }
+
+            if (gpio_iter->gpiod_handle <= 0 &&
+                _mraa_gpiod_request_lines(dev, gpio_iter, GPIOHANDLE_REQUEST_INPUT) < 0) {
+                syslog(LOG_ERR, "[GPIOD_INTERFACE]: error getting gpio line handle");
+                return MRAA_ERROR_INVALID_HANDLE;
+            }
+
+            if (mraa_get_line_values(gpio_iter->gpiod_handle, gpio_iter->num_gpio_lines, gpio_iter->rw_values) < 0) {
+                syslog(LOG_ERR, "[GPIOD_INTERFACE]: error reading gpio");
+                return MRAA_ERROR_INVALID_RESOURCE;
+            }
+
+            for (int j = 0; j < gpio_iter->num_gpio_lines; ++j) {
+                unsigned int pin_idx = gpio_iter->gpio_group_to_pins_table[j];
+                if (pin_idx < 32 && gpio_iter->rw_values[j]) {
+                    *values |= 1u << pin_idx;
+                }
+            }
+        }
+
+        *values &= mask;
+        return MRAA_SUCCESS;
+    }
+
+    uint32_t level[MRAA_GPIO_MMAP_MAX_BANKS];
+    uint32_t loaded = 0;
+    mraa_gpio_context it = dev;
+
+    /* One load per bank, every pin of that bank is sampled at the same time. */
+    for (int i = 0; it != NULL && i < 32; ++i, it = it->next) {
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+
+        unsigned int bank = it->pin / 32;
+        int value;
+
+        if (it->mmap_read_bank != NULL && bank < MRAA_GPIO_MMAP_MAX_BANKS) {
+            if (!(loaded & (1u << bank))) {
+                level[bank] = it->mmap_read_bank(it, bank);
+                loaded |= 1u << bank;
+            }
+            value = (level[bank] >> (it->pin % 32)) & 1;
+        } else {
+            value = mraa_gpio_read(it);
+            if (value == -1) {
+                return MRAA_ERROR_INVALID_RESOURCE;
+            }
+        }
+
+        if (value) {
+            *values |= 1u << i;
+        }
+    }
+
+    return MRAA_SUCCESS;
+}
+
 static mraa_result_t
 mraa_gpio_unexport_force(mraa_gpio_context dev)
 {
@@ -1572,13 +2372,15 @@ mraa_gpio_close(mraa_gpio_context dev)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    /* Free any ISRs, the isr may still be writing events until it is gone. */
+    mraa_gpio_isr_exit(dev);
+    _mraa_gpio_filter_free(dev);
+
     if (dev->events) {
         free(dev->events);
+        dev->events = NULL;
     }
 
-    /* Free any ISRs */
-    mraa_gpio_isr_exit(dev);
-
     if (plat && plat->chardev_capable) {
         _mraa_free_gpio_groups(dev);
 
@@ -1586,6 +2388,8 @@ mraa_gpio_close(mraa_gpio_context dev)
     } else {
         mraa_gpio_context it = dev, tmp;
 
+        _mraa_gpio_multi_free_sysfs(dev);
+
         while (it) {
             tmp = it->next;
             if (_mraa_gpio_close_internal(it) != MRAA_SUCCESS) {
@@ -1621,7 +2425,14 @@ mraa_gpio_use_mmaped(mraa_gpio_context dev, mraa_boolean_t mmap_en)
     }
 
     if (IS_FUNC_DEFINED(dev, gpio_mmap_setup)) {
-        return dev->advance_func->gpio_mmap_setup(dev, mmap_en);
+        mraa_result_t ret = MRAA_SUCCESS;
+
+        /* Map every pin of a multi pin context, write_mask needs them all. */
+        for (mraa_gpio_context it = dev; it != NULL && ret == MRAA_SUCCESS; it = it->next) {
+            ret = dev->advance_func->gpio_mmap_setup(it, mmap_en);
+        }
+
+        return ret;
     }
 
     syslog(LOG_ERR, "gpio%i: use_mmaped: mmap not implemented on this platform", dev->pin);
@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_capture.h"
+#include "gpio/gpio_chardev.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CAPTURE_DRAIN_BATCH 64
+
+/* Guards dev->capture of all contexts, so capture_read() can't race a stop
+ * freeing the state. The isr doesn't need it, it is gone before the free. */
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    unsigned int count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+} mraa_gpio_capture_acc;
+
+/* Running state and current window of one pin. */
+typedef struct {
+    mraa_timestamp_t last_rising;
+    mraa_timestamp_t last_falling;
+    unsigned int edges;
+    mraa_gpio_capture_acc period;
+    mraa_gpio_capture_acc high;
+    mraa_gpio_capture_acc low;
+} mraa_gpio_capture_line;
+
+struct _gpio_capture {
+    pthread_mutex_t lock;
+    mraa_gpio_edge_t edges;
+    uint64_t window_ns;
+    mraa_timestamp_t window_start;
+    mraa_gpio_capture_line* lines;
+    /* Newest event seen and CLOCK_MONOTONIC when it was drained, to tell the
+     * time on the clock of the events (v1, v2 or HTE) in capture_read(). */
+    mraa_timestamp_t last_event_ts;
+    uint64_t last_event_mono;
+    /* Stats of the last completed window, window_ns != 0 only. */
+    mraa_gpio_capture_stats* done;
+    mraa_boolean_t have_done;
+};
+
+static void
+mraa_gpio_capture_add(mraa_gpio_capture_acc* acc, uint64_t value)
+{
+    if (acc->count == 0 || value < acc->min) {
+        acc->min = value;
+    }
+    if (value > acc->max) {
+        acc->max = value;
+    }
+    acc->sum += value;
+    acc->count++;
+}
+
+static void
+mraa_gpio_capture_summarize(mraa_gpio_context dev, struct _gpio_capture* cap, mraa_gpio_capture_stats* stats)
+{
+    for (int i = 0; i < dev->num_pins; ++i) {
+        mraa_gpio_capture_line* line = &cap->lines[i];
+        mraa_gpio_capture_stats* st = &stats[i];
+
+        memset(st, 0, sizeof(*st));
+        st->id = dev->provided_pins[i];
+        st->edges = line->edges;
+
+        st->periods = line->period.count;
+        if (line->period.count) {
+            st->period_min_ns = line->period.min;
+            st->period_max_ns = line->period.max;
+            st->period_mean_ns = line->period.sum / line->period.count;
+            st->frequency_hz = 1e9 * line->period.count / (double) line->period.sum;
+        }
+
+        st->pulses = line->high.count;
+        if (line->high.count) {
+            st->width_min_ns = line->high.min;
+            st->width_max_ns = line->high.max;
+            st->width_mean_ns = line->high.sum / line->high.count;
+        }
+
+        if (line->high.sum + line->low.sum) {
+            st->duty_cycle = line->high.sum / (double) (line->high.sum + line->low.sum);
+        }
+
+        /* Keep the last edge times, pulses may straddle two windows. */
+        line->edges = 0;
+        memset(&line->period, 0, sizeof(line->period));
+        memset(&line->high, 0, sizeof(line->high));
+        memset(&line->low, 0, sizeof(line->low));
+    }
+}
+
+/* Close every window that ended before ts, lock held. */
+static void
+mraa_gpio_capture_roll(mraa_gpio_context dev, struct _gpio_capture* cap, mraa_timestamp_t ts)
+{
+    if (cap->window_ns == 0) {
+        return;
+    }
+
+    if (cap->window_start == 0) {
+        cap->window_start = ts;
+        return;
+    }
+
+    if (ts < cap->window_start + cap->window_ns) {
+        return;
+    }
+
+    mraa_gpio_capture_summarize(dev, cap, cap->done);
+    cap->have_done = 1;
+
+    /* Idle windows in between have nothing worth reporting. */
+    cap->window_start += ((ts - cap->window_start) / cap->window_ns) * cap->window_ns;
+}
+
+static void
+mraa_gpio_capture_edge(struct _gpio_capture* cap, mraa_gpio_capture_line* line, const mraa_gpio_edge_event* event)
+{
+    mraa_boolean_t rising = event->edge == MRAA_GPIO_EDGE_RISING;
+    /* Periods are measured between rising edges, unless only falling ones come in. */
+    mraa_boolean_t reference = rising || cap->edges == MRAA_GPIO_EDGE_FALLING;
+    mraa_timestamp_t previous = rising ? line->last_rising : line->last_falling;
+
+    line->edges++;
+
+    if (reference && previous != 0 && event->timestamp > previous) {
+        mraa_gpio_capture_add(&line->period, event->timestamp - previous);
+    }
+
+    if (rising) {
+        if (line->last_falling != 0 && line->last_falling > line->last_rising) {
+            mraa_gpio_capture_add(&line->low, event->timestamp - line->last_falling);
+        }
+        line->last_rising = event->timestamp;
+    } else {
+        if (line->last_rising != 0 && line->last_rising > line->last_falling) {
+            mraa_gpio_capture_add(&line->high, event->timestamp - line->last_rising);
+        }
+        line->last_falling = event->timestamp;
+    }
+}
+
+static uint64_t
+mraa_gpio_capture_mono()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+mraa_gpio_capture_isr(void* arg)
+{
+    mraa_gpio_context dev = (mraa_gpio_context) arg;
+    struct _gpio_capture* cap = dev->capture;
+    mraa_gpio_edge_event buf[CAPTURE_DRAIN_BATCH];
+    int lines[CAPTURE_DRAIN_BATCH];
+    int num;
+
+    if (cap == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&cap->lock);
+    pthread_mutex_lock(&dev->event_rings_lock);
+    /* Oldest first across all lines, or one line could close a window on the
+     * older edges still queued for another. */
+    while ((num = _mraa_gpio_event_rings_pop(dev, buf, lines, CAPTURE_DRAIN_BATCH)) > 0) {
+        for (int j = 0; j < num; ++j) {
+            mraa_gpio_capture_roll(dev, cap, buf[j].timestamp);
+            mraa_gpio_capture_edge(cap, &cap->lines[lines[j]], &buf[j]);
+        }
+        if (buf[num - 1].timestamp > cap->last_event_ts) {
+            cap->last_event_ts = buf[num - 1].timestamp;
+            cap->last_event_mono = mraa_gpio_capture_mono();
+        }
+    }
+    pthread_mutex_unlock(&dev->event_rings_lock);
+    pthread_mutex_unlock(&cap->lock);
+}
+
+void
+_mraa_gpio_capture_free(mraa_gpio_context dev)
+{
+    pthread_mutex_lock(&capture_lock);
+    struct _gpio_capture* cap = dev->capture;
+    dev->capture = NULL;
+    pthread_mutex_unlock(&capture_lock);
+
+    if (cap == NULL) {
+        return;
+    }
+
+    pthread_mutex_destroy(&cap->lock);
+    free(cap->lines);
+    free(cap->done);
+    free(cap);
+}
+
+mraa_boolean_t
+_mraa_gpio_capture_running(mraa_gpio_context dev)
+{
+    pthread_mutex_lock(&capture_lock);
+    mraa_boolean_t running = dev->capture != NULL;
+    pthread_mutex_unlock(&capture_lock);
+
+    return running;
+}
+
+mraa_result_t
+mraa_gpio_capture_start(mraa_gpio_context dev, mraa_gpio_edge_t edges, unsigned int window_ms)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: capture_start: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (!plat->chardev_capable) {
+        syslog(LOG_ERR, "gpio: capture_start: needs kernel edge timestamps (chardev interface)");
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    if (edges == MRAA_GPIO_EDGE_NONE) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (dev->capture != NULL || dev->thread_id != 0 || dev->dispatch_reg != NULL) {
+        syslog(LOG_ERR, "gpio: capture_start: context already has an isr");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    struct _gpio_capture* cap = calloc(1, sizeof(struct _gpio_capture));
+    if (cap == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    cap->lines = calloc(dev->num_pins, sizeof(mraa_gpio_capture_line));
+    cap->done = calloc(dev->num_pins, sizeof(mraa_gpio_capture_stats));
+    if (cap->lines == NULL || cap->done == NULL) {
+        free(cap->lines);
+        free(cap->done);
+        free(cap);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    pthread_mutex_init(&cap->lock, NULL);
+    cap->edges = edges;
+    cap->window_ns = (uint64_t) window_ms * 1000000ULL;
+    pthread_mutex_lock(&capture_lock);
+    dev->capture = cap;
+    pthread_mutex_unlock(&capture_lock);
+
+    /* A C callback, even when a language binding is loaded. */
+    dev->isr_internal = 1;
+    mraa_result_t ret = mraa_gpio_isr(dev, edges, mraa_gpio_capture_isr, dev);
+    if (ret != MRAA_SUCCESS) {
+        dev->isr_internal = 0;
+        _mraa_gpio_capture_free(dev);
+    }
+
+    return ret;
+}
+
+mraa_result_t
+mraa_gpio_capture_read(mraa_gpio_context dev, mraa_gpio_capture_stats stats[])
+{
+    if (dev == NULL || stats == NULL) {
+        syslog(LOG_ERR, "gpio: capture_read: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    pthread_mutex_lock(&capture_lock);
+
+    struct _gpio_capture* cap = dev->capture;
+    if (cap == NULL) {
+        pthread_mutex_unlock(&capture_lock);
+        syslog(LOG_ERR, "gpio: capture_read: no capture running");
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    pthread_mutex_lock(&cap->lock);
+
+    if (cap->window_ns == 0) {
+        mraa_gpio_capture_summarize(dev, cap, stats);
+    } else {
+        /* A signal that stopped still has to close its window. The event
+         * clock isn't known for sure (v1 and HTE pick their own), so carry it
+         * forward from the newest event. Draining lags the edge, the estimate
+         * errs on the early side and never closes a window too soon. */
+        if (cap->last_event_ts != 0) {
+            mraa_gpio_capture_roll(dev, cap, cap->last_event_ts + (mraa_gpio_capture_mono() - cap->last_event_mono));
+        }
+
+        if (cap->have_done) {
+            memcpy(stats, cap->done, dev->num_pins * sizeof(mraa_gpio_capture_stats));
+        } else {
+            memset(stats, 0, dev->num_pins * sizeof(mraa_gpio_capture_stats));
+            for (int i = 0; i < dev->num_pins; ++i) {
+                stats[i].id = dev->provided_pins[i];
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&cap->lock);
+    pthread_mutex_unlock(&capture_lock);
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_gpio_capture_stop(mraa_gpio_context dev)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (!_mraa_gpio_capture_running(dev)) {
+        return MRAA_SUCCESS;
+    }
+
+    /* Tearing down the isr frees the capture state as well. */
+    return mraa_gpio_isr_exit(dev);
+}
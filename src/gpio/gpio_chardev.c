@@ -25,6 +25,7 @@
 #include "linux/gpio.h"
 #include "mraa_internal.h"
 #include "gpio/gpio_chardev.h"
+#include "gpio/gpio_filter.h"
 
 #include <dirent.h>
 #include <errno.h>
@@ -94,10 +95,157 @@ _mraa_free_gpio_groups(mraa_gpio_context dev)
         free(dev->provided_pins);
     }
 
-    /* Finally, delete event array. */
+    /* Finally, delete event array and queues. */
     if (dev->events) {
         free(dev->events);
     }
+
+    if (dev->event_rings) {
+        pthread_mutex_destroy(&dev->event_rings_lock);
+        free(dev->event_rings);
+    }
+}
+
+/* GPIO v2 uAPI availability: -1 not probed yet, 0 unsupported, 1 supported. */
+static int gpiod_v2_state = -1;
+
+static void
+_mraa_gpiod_probe_v2(int chip_fd)
+{
+    struct gpio_v2_line_info info;
+
+    if (gpiod_v2_state != -1) {
+        return;
+    }
+
+    memset(&info, 0, sizeof(info));
+    if (ioctl(chip_fd, GPIO_V2_GET_LINEINFO_IOCTL, &info) == 0) {
+        gpiod_v2_state = 1;
+    } else if (errno == ENOTTY || errno == EINVAL) {
+        /* Pre 5.10 kernel, stay on the v1 uAPI. */
+        gpiod_v2_state = 0;
+    }
+}
+
+mraa_boolean_t
+_mraa_gpiod_v2_capable()
+{
+    return gpiod_v2_state == 1;
+}
+
+static unsigned long long
+_mraa_gpiod_v2_mask(unsigned int num_lines)
+{
+    return num_lines >= 64 ? ~0ULL : (1ULL << num_lines) - 1;
+}
+
+static unsigned long long
+_mraa_gpiod_v2_line_flags(unsigned flags)
+{
+    unsigned long long v2_flags = 0;
+
+    /* v2 rejects conflicting directions, output wins like it did with v1. */
+    if (flags & GPIOHANDLE_REQUEST_OUTPUT) {
+        v2_flags |= GPIO_V2_LINE_FLAG_OUTPUT;
+
+        if (flags & GPIOHANDLE_REQUEST_OPEN_DRAIN) {
+            v2_flags |= GPIO_V2_LINE_FLAG_OPEN_DRAIN;
+        } else if (flags & GPIOHANDLE_REQUEST_OPEN_SOURCE) {
+            v2_flags |= GPIO_V2_LINE_FLAG_OPEN_SOURCE;
+        }
+    } else if (flags & GPIOHANDLE_REQUEST_INPUT) {
+        v2_flags |= GPIO_V2_LINE_FLAG_INPUT;
+    }
+
+    if (flags & GPIOHANDLE_REQUEST_ACTIVE_LOW) {
+        v2_flags |= GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+    }
+
+    return v2_flags;
+}
+
+static void
+_mraa_gpiod_v2_fill_config(mraa_gpio_context dev, mraa_gpiod_group_t group, unsigned flags, struct gpio_v2_line_config* config)
+{
+    memset(config, 0, sizeof(*config));
+    config->flags = _mraa_gpiod_v2_line_flags(flags);
+
+    /* Edge detection and debouncing only exist for inputs. */
+    if (!(config->flags & GPIO_V2_LINE_FLAG_INPUT)) {
+        return;
+    }
+
+    if (group->event_flags) {
+        config->flags |= group->event_flags;
+
+        if (dev->event_clock == MRAA_GPIO_EVENT_CLOCK_REALTIME) {
+            config->flags |= GPIO_V2_LINE_FLAG_EVENT_CLOCK_REALTIME;
+        } else if (dev->event_clock == MRAA_GPIO_EVENT_CLOCK_HTE) {
+            config->flags |= GPIO_V2_LINE_FLAG_EVENT_CLOCK_HTE;
+        }
+    }
+
+    if (dev->debounce_period_us) {
+        struct gpio_v2_line_config_attribute* attr = &config->attrs[config->num_attrs++];
+
+        attr->attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+        attr->attr.debounce_period_us = dev->debounce_period_us;
+        attr->mask = _mraa_gpiod_v2_mask(group->num_gpio_lines);
+    }
+}
+
+int
+_mraa_gpiod_request_lines(mraa_gpio_context dev, mraa_gpiod_group_t group, unsigned flags)
+{
+    if (!_mraa_gpiod_v2_capable()) {
+        if (group->gpiod_handle != -1) {
+            close(group->gpiod_handle);
+            group->gpiod_handle = -1;
+        }
+
+        int line_handle = mraa_get_lines_handle(group->dev_fd, group->gpio_lines, group->num_gpio_lines, flags, 0);
+        if (line_handle <= 0) {
+            return -1;
+        }
+
+        group->gpiod_handle = line_handle;
+        group->flags = flags;
+        return 0;
+    }
+
+    struct gpio_v2_line_config config;
+    _mraa_gpiod_v2_fill_config(dev, group, flags, &config);
+
+    /* Reconfigure in place, this keeps the request and its queued events alive. */
+    if (group->gpiod_handle > 0) {
+        if (_mraa_gpiod_ioctl(group->gpiod_handle, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) < 0) {
+            return -1;
+        }
+    } else {
+        struct gpio_v2_line_request req;
+
+        memset(&req, 0, sizeof(req));
+        memcpy(req.offsets, group->gpio_lines, group->num_gpio_lines * sizeof(req.offsets[0]));
+        strncpy(req.consumer, "mraa", sizeof(req.consumer) - 1);
+        req.config = config;
+        req.num_lines = group->num_gpio_lines;
+
+        if (_mraa_gpiod_ioctl(group->dev_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+            return -1;
+        }
+
+        if (req.fd <= 0) {
+            syslog(LOG_ERR, "[GPIOD_INTERFACE]: invalid file descriptor");
+            return -1;
+        }
+
+        /* The same fd delivers edge events, let readers drain it without blocking. */
+        fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+        group->gpiod_handle = req.fd;
+    }
+
+    group->flags = flags;
+    return 0;
 }
 
 void
@@ -106,6 +254,14 @@ _mraa_close_gpio_event_handles(mraa_gpio_context dev)
     mraa_gpiod_group_t gpio_iter;
 
     for_each_gpio_group(gpio_iter, dev) {
+        /* With v2 edge detection is part of the line request, only turn it off. */
+        if (gpio_iter->event_flags) {
+            gpio_iter->event_flags = 0;
+            if (gpio_iter->gpiod_handle > 0) {
+                _mraa_gpiod_request_lines(dev, gpio_iter, gpio_iter->flags);
+            }
+        }
+
         if (gpio_iter->event_handles != NULL) {
             for (int j = 0; j < gpio_iter->num_gpio_lines; ++j) {
                 close(gpio_iter->event_handles[j]);
@@ -132,6 +288,176 @@ _mraa_close_gpio_desc(mraa_gpio_context dev)
     }
 }
 
+void
+_mraa_gpio_event_ring_push(mraa_gpio_event_ring* ring, mraa_timestamp_t timestamp, unsigned int id,
+                           unsigned int seqno, unsigned int line_seqno)
+{
+    unsigned int head = ring->head;
+    unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    /* Full, keep the older events the consumer has not seen yet. */
+    if (head - tail >= MRAA_GPIO_EVENT_RING_SIZE) {
+        __atomic_store_n(&ring->overflow, ring->overflow + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    mraa_gpio_edge_event* event = &ring->events[head & (MRAA_GPIO_EVENT_RING_SIZE - 1)];
+    event->id = ring->pin_id;
+    event->timestamp = timestamp;
+    /* v1 and v2 share the rising = 1, falling = 2 event ids. */
+    event->edge = id == GPIOEVENT_EVENT_RISING_EDGE ? MRAA_GPIO_EDGE_RISING : MRAA_GPIO_EDGE_FALLING;
+    event->seqno = seqno;
+    event->line_seqno = line_seqno;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+int
+_mraa_gpio_chardev_event_sources(mraa_gpio_context dev, mraa_gpiod_event_source sources[])
+{
+    mraa_gpiod_group_t gpio_iter;
+    int num = 0;
+    int idx = 0;
+
+    for_each_gpio_group(gpio_iter, dev) {
+        if (gpio_iter->event_flags && gpio_iter->gpiod_handle > 0) {
+            sources[num].fd = gpio_iter->gpiod_handle;
+            sources[num].line_idx = idx;
+            sources[num].group = gpio_iter;
+            num++;
+        } else if (gpio_iter->event_handles != NULL) {
+            for (int i = 0; i < gpio_iter->num_gpio_lines; ++i) {
+                sources[num].fd = gpio_iter->event_handles[i];
+                sources[num].line_idx = idx + i;
+                sources[num].group = gpio_iter;
+                num++;
+            }
+        }
+
+        idx += gpio_iter->num_gpio_lines;
+    }
+
+    return num;
+}
+
+static int
+_mraa_gpio_chardev_read_events_v2(mraa_gpio_context dev, mraa_gpiod_group_t group, int line_idx, int fd)
+{
+    struct gpio_v2_line_event data[MRAA_GPIOD_EVENT_READ_BATCH];
+    int total = 0;
+
+    for (;;) {
+        ssize_t len = read(fd, data, sizeof(data));
+        if (len < (ssize_t) sizeof(data[0])) {
+            break;
+        }
+
+        int num = len / sizeof(data[0]);
+        for (int i = 0; i < num; ++i) {
+            int idx = -1;
+
+            /* The request covers the whole group, map the offset back to its line. */
+            for (int j = 0; j < group->num_gpio_lines; ++j) {
+                if (group->gpio_lines[j] == data[i].offset) {
+                    idx = line_idx + j;
+                    break;
+                }
+            }
+
+            if (idx < 0) {
+                continue;
+            }
+
+            mraa_gpio_filter_edge edge = { data[i].timestamp_ns, data[i].timestamp_ns,
+                                           data[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE, data[i].id,
+                                           data[i].seqno, data[i].line_seqno };
+            _mraa_gpio_filter_edge(dev, idx, &edge);
+        }
+
+        total += num;
+        if (num < MRAA_GPIOD_EVENT_READ_BATCH) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+int
+_mraa_gpio_chardev_read_events(mraa_gpio_context dev, mraa_gpiod_group_t group, int line_idx, int fd)
+{
+    struct gpioevent_data data[MRAA_GPIOD_EVENT_READ_BATCH];
+    int total = 0;
+
+    if (group != NULL && group->event_flags) {
+        return _mraa_gpio_chardev_read_events_v2(dev, group, line_idx, fd);
+    }
+
+    /* Event fds are non blocking, read until the kernel queue is empty. */
+    for (;;) {
+        ssize_t len = read(fd, data, sizeof(data));
+        if (len < (ssize_t) sizeof(data[0])) {
+            break;
+        }
+
+        int num = len / sizeof(data[0]);
+        for (int i = 0; i < num; ++i) {
+            mraa_gpio_filter_edge edge = { data[i].timestamp, data[i].timestamp,
+                                           data[i].id == GPIOEVENT_EVENT_RISING_EDGE, data[i].id, 0, 0 };
+            _mraa_gpio_filter_edge(dev, line_idx, &edge);
+        }
+
+        total += num;
+        if (num < MRAA_GPIOD_EVENT_READ_BATCH) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+/* lines, if given, receives the line index of every event. */
+int
+_mraa_gpio_event_rings_pop(mraa_gpio_context dev, mraa_gpio_edge_event* buf, int* lines, int max)
+{
+    int count = 0;
+
+    /* Lines are each in order, merge them by timestamp. */
+    while (count < max) {
+        mraa_gpio_event_ring* oldest = NULL;
+        mraa_gpio_edge_event* oldest_event = NULL;
+        int oldest_line = -1;
+
+        for (int i = 0; i < dev->num_pins; ++i) {
+            mraa_gpio_event_ring* ring = &dev->event_rings[i];
+            unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+            if (head == ring->tail) {
+                continue;
+            }
+
+            mraa_gpio_edge_event* event = &ring->events[ring->tail & (MRAA_GPIO_EVENT_RING_SIZE - 1)];
+            if (oldest == NULL || event->timestamp < oldest_event->timestamp) {
+                oldest = ring;
+                oldest_event = event;
+                oldest_line = i;
+            }
+        }
+
+        if (oldest == NULL) {
+            break;
+        }
+
+        if (lines != NULL) {
+            lines[count] = oldest_line;
+        }
+        buf[count++] = *oldest_event;
+        __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+    }
+
+    return count;
+}
+
 int
 _mraa_gpiod_ioctl(int fd, unsigned long gpio_request, void* data)
 {
@@ -204,6 +530,8 @@ mraa_get_chip_info_by_path(const char* path)
         return NULL;
     }
 
+    _mraa_gpiod_probe_v2(cinfo->chip_fd);
+
     return cinfo;
 }
 
@@ -271,6 +599,36 @@ mraa_get_line_info_from_descriptor(int chip_fd, unsigned line_number)
         return NULL;
     }
 
+    if (_mraa_gpiod_v2_capable()) {
+        struct gpio_v2_line_info info;
+
+        /* Kernels may be built without the v1 uAPI, translate the v2 info. */
+        memset(&info, 0, sizeof(info));
+        info.offset = line_number;
+        status = _mraa_gpiod_ioctl(chip_fd, GPIO_V2_GET_LINEINFO_IOCTL, &info);
+        if (status < 0) {
+            free(linfo);
+            return NULL;
+        }
+
+        memset(linfo, 0, sizeof(*linfo));
+        linfo->line_offset = info.offset;
+        memcpy(linfo->name, info.name, sizeof(linfo->name));
+        memcpy(linfo->consumer, info.consumer, sizeof(linfo->consumer));
+        if (info.flags & GPIO_V2_LINE_FLAG_USED)
+            linfo->flags |= GPIOLINE_FLAG_KERNEL;
+        if (info.flags & GPIO_V2_LINE_FLAG_OUTPUT)
+            linfo->flags |= GPIOLINE_FLAG_IS_OUT;
+        if (info.flags & GPIO_V2_LINE_FLAG_ACTIVE_LOW)
+            linfo->flags |= GPIOLINE_FLAG_ACTIVE_LOW;
+        if (info.flags & GPIO_V2_LINE_FLAG_OPEN_DRAIN)
+            linfo->flags |= GPIOLINE_FLAG_OPEN_DRAIN;
+        if (info.flags & GPIO_V2_LINE_FLAG_OPEN_SOURCE)
+            linfo->flags |= GPIOLINE_FLAG_OPEN_SOURCE;
+
+        return linfo;
+    }
+
     linfo->line_offset = line_number;
     status = _mraa_gpiod_ioctl(chip_fd, GPIO_GET_LINEINFO_IOCTL, linfo);
     if (status < 0) {
@@ -341,12 +699,93 @@ mraa_get_line_info_by_chip_label(const char* chip_label, unsigned line_number)
     return linfo;
 }
 
+int
+_mraa_gpiod_set_line_value(mraa_gpiod_group_t group, int value)
+{
+    int status;
+
+    if (_mraa_gpiod_v2_capable()) {
+        group->line_values.bits = value ? 1 : 0;
+        status = ioctl(group->gpiod_handle, GPIO_V2_LINE_SET_VALUES_IOCTL, &group->line_values);
+    } else {
+        group->line_data.values[0] = value ? 1 : 0;
+        status = ioctl(group->gpiod_handle, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &group->line_data);
+    }
+
+    if (status < 0) {
+        syslog(LOG_ERR, "[GPIOD_INTERFACE]: ioctl() error %s", strerror(errno));
+    }
+
+    return status;
+}
+
+int
+_mraa_gpiod_get_line_value(mraa_gpiod_group_t group)
+{
+    int status;
+
+    if (_mraa_gpiod_v2_capable()) {
+        status = ioctl(group->gpiod_handle, GPIO_V2_LINE_GET_VALUES_IOCTL, &group->line_values);
+        if (status == 0) {
+            return group->line_values.bits & 1;
+        }
+    } else {
+        status = ioctl(group->gpiod_handle, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &group->line_data);
+        if (status == 0) {
+            return group->line_data.values[0];
+        }
+    }
+
+    syslog(LOG_ERR, "[GPIOD_INTERFACE]: ioctl() error %s", strerror(errno));
+    return -1;
+}
+
+int
+_mraa_gpiod_set_line_values_masked(mraa_gpiod_group_t group, unsigned long long mask, unsigned long long bits)
+{
+    if (_mraa_gpiod_v2_capable()) {
+        struct gpio_v2_line_values values = { bits & mask, mask };
+
+        return _mraa_gpiod_ioctl(group->gpiod_handle, GPIO_V2_LINE_SET_VALUES_IOCTL, &values);
+    }
+
+    /* v1 always sets every line of the request, keep the unmasked ones. */
+    if (mraa_get_line_values(group->gpiod_handle, group->num_gpio_lines, group->rw_values) < 0) {
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < group->num_gpio_lines; ++i) {
+        if (mask & (1ULL << i)) {
+            group->rw_values[i] = (bits >> i) & 1;
+        }
+    }
+
+    return mraa_set_line_values(group->gpiod_handle, group->num_gpio_lines, group->rw_values);
+}
+
 int
 mraa_set_line_values(int line_handle, unsigned int num_lines, unsigned char input_values[])
 {
     int status;
     struct gpiohandle_data __hdata;
 
+    if (_mraa_gpiod_v2_capable()) {
+        struct gpio_v2_line_values values = { 0, _mraa_gpiod_v2_mask(num_lines) };
+
+        for (unsigned int i = 0; i < num_lines; ++i) {
+            if (input_values[i]) {
+                values.bits |= 1ULL << i;
+            }
+        }
+
+        status = _mraa_gpiod_ioctl(line_handle, GPIO_V2_LINE_SET_VALUES_IOCTL, &values);
+        if (status < 0) {
+            syslog(LOG_ERR, "[GPIOD_INTERFACE]: ioctl() fail");
+        }
+
+        return status;
+    }
+
     memcpy(__hdata.values, input_values, num_lines * sizeof(unsigned char));
 
     status = _mraa_gpiod_ioctl(line_handle, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &__hdata);
@@ -363,6 +802,22 @@ mraa_get_line_values(int line_handle, unsigned int num_lines, unsigned char outp
     int status;
     struct gpiohandle_data __hdata;
 
+    if (_mraa_gpiod_v2_capable()) {
+        struct gpio_v2_line_values values = { 0, _mraa_gpiod_v2_mask(num_lines) };
+
+        status = _mraa_gpiod_ioctl(line_handle, GPIO_V2_LINE_GET_VALUES_IOCTL, &values);
+        if (status < 0) {
+            syslog(LOG_ERR, "[GPIOD_INTERFACE]: ioctl() fail");
+            return status;
+        }
+
+        for (unsigned int i = 0; i < num_lines; ++i) {
+            output_values[i] = (values.bits >> i) & 1;
+        }
+
+        return status;
+    }
+
     status = _mraa_gpiod_ioctl(line_handle, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &__hdata);
     if (status < 0) {
         syslog(LOG_ERR, "[GPIOD_INTERFACE]: ioctl() fail");
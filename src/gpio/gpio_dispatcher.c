@@ -0,0 +1,706 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "gpio.h"
+#include "linux/gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_chardev.h"
+#include "gpio/gpio_dispatcher.h"
+#include "gpio/gpio_filter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define SYSFS_CLASS_GPIO "/sys/class/gpio"
+#define MAX_SIZE 64
+#define MAX_EPOLL_EVENTS 32
+
+struct _gpio_dispatch_loop;
+
+/* One watched file descriptor, handed to epoll as event data. */
+struct _gpio_dispatch_slot {
+    struct _gpio_dispatch_reg* reg;
+    int index; /**< index into dev->events, of the first line for chardev */
+    int fd;
+    mraa_gpiod_group_t group; /**< chardev only */
+};
+
+/* All the event sources of one gpio context. */
+struct _gpio_dispatch_reg {
+    mraa_gpio_context dev;
+    struct _gpio_dispatch_loop* loop;
+    int num_fds;
+    mraa_boolean_t chardev;
+    mraa_boolean_t removed;
+    mraa_boolean_t queued;
+    struct _gpio_dispatch_slot* slots;
+    struct _gpio_dispatch_reg* next; /**< registrations of the loop */
+    struct _gpio_dispatch_reg* next_pending;
+    struct _gpio_dispatch_reg* next_garbage;
+};
+
+typedef struct _gpio_dispatch_loop {
+    int epoll_fd;
+    int wake_fd;
+    int timer_fd; /**< fires when an edge held by a glitch filter is due */
+    pthread_t thread_id;
+    /* Guards the registrations of the loop. Never held while an isr runs, so
+     * isrs may register and unregister contexts on any loop. */
+    pthread_mutex_t lock;
+    /* Signalled whenever the isr of current returns. */
+    pthread_cond_t idle;
+    struct _gpio_dispatch_reg* current; /**< registration whose isr is running */
+    unsigned int waiters;               /**< unregistering threads waiting on idle */
+    struct _gpio_dispatch_reg* regs;
+    unsigned int num_regs;
+    mraa_boolean_t stopping;
+    mraa_boolean_t java_attached;
+    /* Removed registrations, freed once the loop is done with its current batch. */
+    struct _gpio_dispatch_reg* garbage;
+} mraa_gpio_dispatch_loop;
+
+static pthread_mutex_t dispatch_lock = PTHREAD_MUTEX_INITIALIZER;
+static mraa_gpio_dispatch_loop* dispatch_loops = NULL;
+static unsigned int dispatch_num_loops = 0;
+static unsigned int dispatch_requested = 0;
+static unsigned int dispatch_active_regs = 0;
+
+static void
+mraa_gpio_dispatch_free_reg(struct _gpio_dispatch_reg* reg)
+{
+    free(reg->slots);
+    free(reg);
+}
+
+static void
+mraa_gpio_dispatch_collect_garbage(mraa_gpio_dispatch_loop* loop)
+{
+    struct _gpio_dispatch_reg* reg = loop->garbage;
+
+    while (reg) {
+        struct _gpio_dispatch_reg* next = reg->next_garbage;
+        mraa_gpio_dispatch_free_reg(reg);
+        reg = next;
+    }
+    loop->garbage = NULL;
+}
+
+static void
+mraa_gpio_dispatch_wake(mraa_gpio_dispatch_loop* loop)
+{
+    uint64_t one = 1;
+
+    if (write(loop->wake_fd, &one, sizeof(one)) != sizeof(one)) {
+        syslog(LOG_ERR, "gpio: dispatcher: failed to wake event loop: %s", strerror(errno));
+    }
+}
+
+static void
+mraa_gpio_dispatch_read_event(struct _gpio_dispatch_slot* slot)
+{
+    mraa_gpio_context dev = slot->reg->dev;
+    unsigned char c;
+
+    if (slot->reg->chardev) {
+        /* Queues every pending edge and records the latest one. */
+        _mraa_gpio_chardev_read_events(dev, slot->group, slot->index, slot->fd);
+        return;
+    }
+
+    mraa_timestamp_t timestamp = _mraa_gpio_get_timestamp_sysfs();
+    int level = -1;
+
+    if (pread(slot->fd, &c, 1, 0) == 1 && (c == '0' || c == '1')) {
+        level = c - '0';
+    }
+
+    mraa_gpio_filter_edge edge = { timestamp * 1000, timestamp, level, 0, 0, 0 };
+    _mraa_gpio_filter_edge(dev, slot->index, &edge);
+}
+
+/* Add a registration to the isrs of this batch, clearing its last events. */
+static void
+mraa_gpio_dispatch_queue(struct _gpio_dispatch_reg* reg, struct _gpio_dispatch_reg** pending)
+{
+    if (reg->queued) {
+        return;
+    }
+
+    if (reg->dev->events != NULL) {
+        for (int j = 0; j < reg->dev->num_pins; ++j) {
+            reg->dev->events[j].id = -1;
+        }
+    }
+    reg->queued = 1;
+    reg->next_pending = *pending;
+    *pending = reg;
+}
+
+/* Deliver the filtered edges that are due and re-arm the timer for the next. */
+static void
+mraa_gpio_dispatch_expire(mraa_gpio_dispatch_loop* loop, struct _gpio_dispatch_reg** pending)
+{
+    uint64_t now = _mraa_gpio_filter_now();
+
+    for (struct _gpio_dispatch_reg* reg = loop->regs; reg != NULL; reg = reg->next) {
+        uint64_t deadline = _mraa_gpio_filter_deadline(reg->dev);
+
+        if (deadline != 0 && deadline <= now) {
+            mraa_gpio_dispatch_queue(reg, pending);
+            _mraa_gpio_filter_expire(reg->dev, now);
+        }
+    }
+}
+
+static void
+mraa_gpio_dispatch_arm_timer(mraa_gpio_dispatch_loop* loop)
+{
+    struct itimerspec its;
+    uint64_t next = 0;
+
+    for (struct _gpio_dispatch_reg* reg = loop->regs; reg != NULL; reg = reg->next) {
+        uint64_t deadline = _mraa_gpio_filter_deadline(reg->dev);
+
+        if (deadline != 0 && (next == 0 || deadline < next)) {
+            next = deadline;
+        }
+    }
+
+    /* An all zero value disarms the timer. */
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = next / 1000000000ULL;
+    its.it_value.tv_nsec = next % 1000000000ULL;
+    timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void
+mraa_gpio_dispatch_call_isr(mraa_gpio_dispatch_loop* loop, void (*isr)(void*), void* isr_args, mraa_boolean_t isr_internal)
+{
+    if (lang_func->java_attach_thread != NULL && isr == lang_func->java_isr_callback) {
+        if (!loop->java_attached) {
+            if (lang_func->java_attach_thread() != MRAA_SUCCESS) {
+                syslog(LOG_ERR, "gpio: dispatcher: failed to attach event loop to the JVM");
+                return;
+            }
+            loop->java_attached = 1;
+        }
+    }
+
+    if (lang_func->python_isr != NULL && !isr_internal) {
+        lang_func->python_isr(isr, isr_args);
+    } else {
+        isr(isr_args);
+    }
+}
+
+static void*
+mraa_gpio_dispatch_loop_run(void* arg)
+{
+    mraa_gpio_dispatch_loop* loop = (mraa_gpio_dispatch_loop*) arg;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    for (;;) {
+        int num = epoll_wait(loop->epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+        if (num < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            syslog(LOG_ERR, "gpio: dispatcher: epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        pthread_mutex_lock(&loop->lock);
+
+        /* Collect everything that fired for a context before calling its isr
+         * once, same as the per context thread does after a poll(). */
+        struct _gpio_dispatch_reg* pending = NULL;
+        for (int i = 0; i < num; ++i) {
+            if (events[i].data.ptr == NULL) {
+                uint64_t count;
+                read(loop->wake_fd, &count, sizeof(count));
+                continue;
+            }
+
+            if (events[i].data.ptr == loop) {
+                uint64_t count;
+                read(loop->timer_fd, &count, sizeof(count));
+                continue;
+            }
+
+            struct _gpio_dispatch_slot* slot = (struct _gpio_dispatch_slot*) events[i].data.ptr;
+            struct _gpio_dispatch_reg* reg = slot->reg;
+            if (reg->removed) {
+                continue;
+            }
+
+            mraa_gpio_dispatch_queue(reg, &pending);
+            mraa_gpio_dispatch_read_event(slot);
+        }
+
+        mraa_gpio_dispatch_expire(loop, &pending);
+
+        /* Registrations removed from now on stay allocated until the batch is
+         * done, the pending list still points at them. Whatever the isr needs
+         * from the context is copied while the lock is held, so a context
+         * closed by another thread or isr is never touched afterwards. */
+        while (pending) {
+            struct _gpio_dispatch_reg* reg = pending;
+            pending = reg->next_pending;
+            reg->next_pending = NULL;
+            reg->queued = 0;
+
+            /* An earlier isr in this batch may have removed this context,
+             * or the glitch filter dropped all of its edges. */
+            if (reg->removed || !_mraa_gpio_filter_pending(reg->dev)) {
+                continue;
+            }
+
+            void (*isr)(void*) = reg->dev->isr;
+            void* isr_args = reg->dev->isr_args;
+            mraa_boolean_t isr_internal = reg->dev->isr_internal;
+
+            loop->current = reg;
+            pthread_mutex_unlock(&loop->lock);
+
+            mraa_gpio_dispatch_call_isr(loop, isr, isr_args, isr_internal);
+
+            pthread_mutex_lock(&loop->lock);
+            loop->current = NULL;
+            pthread_cond_broadcast(&loop->idle);
+        }
+
+        mraa_gpio_dispatch_collect_garbage(loop);
+        mraa_gpio_dispatch_arm_timer(loop);
+        mraa_boolean_t stopping = loop->stopping;
+
+        pthread_mutex_unlock(&loop->lock);
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    if (loop->java_attached && lang_func->java_detach_thread != NULL) {
+        lang_func->java_detach_thread();
+    }
+
+    return NULL;
+}
+
+/* Take a registration off its loop, the caller holds loop->lock. */
+static void
+mraa_gpio_dispatch_remove_reg(mraa_gpio_dispatch_loop* loop, struct _gpio_dispatch_reg* reg)
+{
+    struct _gpio_dispatch_reg** it;
+
+    for (int i = 0; i < reg->num_fds; ++i) {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, reg->slots[i].fd, NULL);
+        /* Chardev event handles are owned, and closed, by the gpio groups. */
+        if (!reg->chardev) {
+            close(reg->slots[i].fd);
+        }
+    }
+
+    for (it = &loop->regs; *it != NULL && *it != reg; it = &(*it)->next)
+        ;
+    if (*it != NULL) {
+        *it = reg->next;
+    }
+
+    reg->removed = 1;
+    reg->dev->dispatch_reg = NULL;
+    reg->next_garbage = loop->garbage;
+    loop->garbage = reg;
+    loop->num_regs--;
+}
+
+/* The loops can't be stopped from one of their own isrs, they'd join themselves. */
+static mraa_boolean_t
+mraa_gpio_dispatch_in_loop()
+{
+    for (unsigned int i = 0; i < dispatch_num_loops; ++i) {
+        if (pthread_equal(pthread_self(), dispatch_loops[i].thread_id)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void
+mraa_gpio_dispatch_stop_loops()
+{
+    for (unsigned int i = 0; i < dispatch_num_loops; ++i) {
+        mraa_gpio_dispatch_loop* loop = &dispatch_loops[i];
+
+        pthread_mutex_lock(&loop->lock);
+        while (loop->regs != NULL) {
+            mraa_gpio_dispatch_remove_reg(loop, loop->regs);
+        }
+        loop->stopping = 1;
+        pthread_mutex_unlock(&loop->lock);
+        mraa_gpio_dispatch_wake(loop);
+        pthread_join(loop->thread_id, NULL);
+
+        /* An unregister may still be waiting for an isr of this loop. */
+        pthread_mutex_lock(&loop->lock);
+        while (loop->waiters > 0) {
+            pthread_cond_wait(&loop->idle, &loop->lock);
+        }
+        pthread_mutex_unlock(&loop->lock);
+
+        mraa_gpio_dispatch_collect_garbage(loop);
+        close(loop->epoll_fd);
+        close(loop->wake_fd);
+        close(loop->timer_fd);
+        pthread_cond_destroy(&loop->idle);
+        pthread_mutex_destroy(&loop->lock);
+    }
+
+    free(dispatch_loops);
+    dispatch_loops = NULL;
+    dispatch_num_loops = 0;
+}
+
+static mraa_result_t
+mraa_gpio_dispatch_start_loops()
+{
+    dispatch_loops = calloc(dispatch_requested, sizeof(mraa_gpio_dispatch_loop));
+    if (dispatch_loops == NULL) {
+        syslog(LOG_CRIT, "gpio: dispatcher: Failed to allocate memory for event loops");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    for (unsigned int i = 0; i < dispatch_requested; ++i) {
+        mraa_gpio_dispatch_loop* loop = &dispatch_loops[i];
+        struct epoll_event ev;
+
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd == -1) {
+            syslog(LOG_ERR, "gpio: dispatcher: epoll_create1 failed: %s", strerror(errno));
+            mraa_gpio_dispatch_stop_loops();
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+
+        loop->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (loop->wake_fd == -1) {
+            syslog(LOG_ERR, "gpio: dispatcher: eventfd failed: %s", strerror(errno));
+            close(loop->epoll_fd);
+            mraa_gpio_dispatch_stop_loops();
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+
+        loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (loop->timer_fd == -1) {
+            syslog(LOG_ERR, "gpio: dispatcher: timerfd_create failed: %s", strerror(errno));
+            close(loop->epoll_fd);
+            close(loop->wake_fd);
+            mraa_gpio_dispatch_stop_loops();
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev);
+        /* Told apart from the slots by pointing at the loop itself. */
+        ev.data.ptr = loop;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->timer_fd, &ev);
+
+        pthread_mutex_init(&loop->lock, NULL);
+        pthread_cond_init(&loop->idle, NULL);
+
+        if (pthread_create(&loop->thread_id, NULL, mraa_gpio_dispatch_loop_run, loop) != 0) {
+            syslog(LOG_ERR, "gpio: dispatcher: failed to start event loop thread");
+            close(loop->epoll_fd);
+            close(loop->wake_fd);
+            close(loop->timer_fd);
+            pthread_cond_destroy(&loop->idle);
+            pthread_mutex_destroy(&loop->lock);
+            mraa_gpio_dispatch_stop_loops();
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+
+        dispatch_num_loops++;
+    }
+
+    return MRAA_SUCCESS;
+}
+
+mraa_boolean_t
+mraa_gpio_dispatcher_enabled()
+{
+    mraa_boolean_t enabled;
+
+    pthread_mutex_lock(&dispatch_lock);
+    enabled = dispatch_requested > 0;
+    pthread_mutex_unlock(&dispatch_lock);
+
+    return enabled;
+}
+
+mraa_result_t
+mraa_gpio_isr_dispatcher(unsigned int num_threads)
+{
+    if (num_threads > MRAA_GPIO_DISPATCH_MAX_THREADS) {
+        syslog(LOG_ERR, "gpio: dispatcher: %u threads requested, maximum is %d", num_threads,
+               MRAA_GPIO_DISPATCH_MAX_THREADS);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&dispatch_lock);
+
+    if (mraa_gpio_dispatch_in_loop()) {
+        pthread_mutex_unlock(&dispatch_lock);
+        syslog(LOG_ERR, "gpio: dispatcher: cannot reconfigure from within a dispatched isr");
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    if (dispatch_active_regs > 0) {
+        pthread_mutex_unlock(&dispatch_lock);
+        syslog(LOG_ERR, "gpio: dispatcher: cannot reconfigure while %u isr(s) are registered",
+               dispatch_active_regs);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    /* Loops are (re)started lazily on the next registration. */
+    mraa_gpio_dispatch_stop_loops();
+    dispatch_requested = num_threads;
+
+    pthread_mutex_unlock(&dispatch_lock);
+
+    return MRAA_SUCCESS;
+}
+
+void
+mraa_gpio_dispatcher_shutdown()
+{
+    pthread_mutex_lock(&dispatch_lock);
+
+    if (mraa_gpio_dispatch_in_loop()) {
+        pthread_mutex_unlock(&dispatch_lock);
+        syslog(LOG_ERR, "gpio: dispatcher: cannot shut down from within a dispatched isr");
+        return;
+    }
+
+    if (dispatch_active_regs > 0) {
+        syslog(LOG_NOTICE, "gpio: dispatcher: dropping %u registered isr(s)", dispatch_active_regs);
+    }
+    mraa_gpio_dispatch_stop_loops();
+    dispatch_requested = 0;
+    dispatch_active_regs = 0;
+
+    pthread_mutex_unlock(&dispatch_lock);
+}
+
+static int
+mraa_gpio_dispatch_collect_fds(mraa_gpio_context dev, struct _gpio_dispatch_reg* reg)
+{
+    int idx = 0;
+
+    if (plat->chardev_capable) {
+        mraa_gpiod_event_source sources[dev->num_pins];
+        int num_sources = _mraa_gpio_chardev_event_sources(dev, sources);
+
+        for (idx = 0; idx < num_sources; ++idx) {
+            reg->slots[idx].fd = sources[idx].fd;
+            reg->slots[idx].index = sources[idx].line_idx;
+            reg->slots[idx].group = sources[idx].group;
+            reg->slots[idx].reg = reg;
+        }
+
+        return num_sources > 0 ? num_sources : -1;
+    }
+
+    for (mraa_gpio_context it = dev; it; it = it->next) {
+        char bu[MAX_SIZE];
+        unsigned char c;
+
+        snprintf(bu, MAX_SIZE, SYSFS_CLASS_GPIO "/gpio%d/value", it->pin);
+        int fd = open(bu, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            syslog(LOG_ERR, "gpio%i: dispatcher: failed to open 'value' : %s", it->pin, strerror(errno));
+            for (int i = 0; i < idx; ++i) {
+                close(reg->slots[i].fd);
+            }
+            return -1;
+        }
+
+        // do an initial read to clear interrupt
+        read(fd, &c, 1);
+
+        reg->slots[idx].fd = fd;
+        reg->slots[idx].index = idx;
+        reg->slots[idx].reg = reg;
+        idx++;
+    }
+
+    return idx;
+}
+
+mraa_result_t
+mraa_gpio_dispatcher_register(mraa_gpio_context dev)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    if (dev == NULL || dev->isr == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _gpio_dispatch_reg* reg = calloc(1, sizeof(struct _gpio_dispatch_reg));
+    if (reg == NULL) {
+        syslog(LOG_CRIT, "gpio: dispatcher: Failed to allocate memory for registration");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    reg->slots = calloc(dev->num_pins, sizeof(struct _gpio_dispatch_slot));
+    if (reg->slots == NULL) {
+        syslog(LOG_CRIT, "gpio: dispatcher: Failed to allocate memory for registration");
+        free(reg);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    reg->dev = dev;
+    reg->chardev = plat->chardev_capable;
+    reg->num_fds = mraa_gpio_dispatch_collect_fds(dev, reg);
+    if (reg->num_fds <= 0) {
+        mraa_gpio_dispatch_free_reg(reg);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    pthread_mutex_lock(&dispatch_lock);
+
+    if (dispatch_requested == 0) {
+        ret = MRAA_ERROR_INVALID_RESOURCE;
+        goto register_cleanup;
+    }
+
+    if (dispatch_num_loops == 0) {
+        ret = mraa_gpio_dispatch_start_loops();
+        if (ret != MRAA_SUCCESS) {
+            goto register_cleanup;
+        }
+    }
+
+    /* All sources of one context share a loop so its isr is never reentered. */
+    mraa_gpio_dispatch_loop* loop = &dispatch_loops[0];
+    for (unsigned int i = 1; i < dispatch_num_loops; ++i) {
+        if (dispatch_loops[i].num_regs < loop->num_regs) {
+            loop = &dispatch_loops[i];
+        }
+    }
+    reg->loop = loop;
+
+    pthread_mutex_lock(&loop->lock);
+    for (int i = 0; i < reg->num_fds; ++i) {
+        struct epoll_event ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = reg->chardev ? EPOLLIN : (EPOLLPRI | EPOLLERR);
+        ev.data.ptr = &reg->slots[i];
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, reg->slots[i].fd, &ev) != 0) {
+            syslog(LOG_ERR, "gpio: dispatcher: epoll_ctl failed: %s", strerror(errno));
+            for (int j = 0; j < i; ++j) {
+                epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, reg->slots[j].fd, NULL);
+            }
+            pthread_mutex_unlock(&loop->lock);
+            ret = MRAA_ERROR_INVALID_RESOURCE;
+            goto register_cleanup;
+        }
+    }
+    reg->next = loop->regs;
+    loop->regs = reg;
+    loop->num_regs++;
+    pthread_mutex_unlock(&loop->lock);
+
+    dispatch_active_regs++;
+    dev->dispatch_reg = reg;
+
+register_cleanup:
+    pthread_mutex_unlock(&dispatch_lock);
+
+    if (ret != MRAA_SUCCESS) {
+        if (!reg->chardev) {
+            for (int i = 0; i < reg->num_fds; ++i) {
+                close(reg->slots[i].fd);
+            }
+        }
+        mraa_gpio_dispatch_free_reg(reg);
+    }
+
+    return ret;
+}
+
+mraa_result_t
+mraa_gpio_dispatcher_unregister(mraa_gpio_context dev)
+{
+    if (dev == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    /* A shutdown clears dispatch_reg and frees the loops under dispatch_lock. */
+    pthread_mutex_lock(&dispatch_lock);
+    struct _gpio_dispatch_reg* reg = dev->dispatch_reg;
+    if (reg == NULL) {
+        pthread_mutex_unlock(&dispatch_lock);
+        return MRAA_SUCCESS;
+    }
+
+    mraa_gpio_dispatch_loop* loop = reg->loop;
+    mraa_boolean_t in_loop = mraa_gpio_dispatch_in_loop();
+
+    pthread_mutex_lock(&loop->lock);
+    mraa_gpio_dispatch_remove_reg(loop, reg);
+    dispatch_active_regs--;
+    /* Isrs may unregister other contexts, so dispatch_lock isn't held while
+     * waiting. The waiter count keeps a shutdown from freeing the loop. */
+    loop->waiters++;
+    pthread_mutex_unlock(&dispatch_lock);
+
+    /* Wait for an isr of the context that is in flight, unless we are called
+     * from a dispatched isr: that may be the very isr, or a loop waiting on
+     * ours. Nothing of the context is used by the loop once its isr started. */
+    if (!in_loop) {
+        while (loop->current == reg) {
+            pthread_cond_wait(&loop->idle, &loop->lock);
+        }
+    }
+    loop->waiters--;
+    pthread_cond_broadcast(&loop->idle);
+    /* Let the loop release the registration now rather than on its next event. */
+    mraa_gpio_dispatch_wake(loop);
+    pthread_mutex_unlock(&loop->lock);
+
+    if (lang_func->java_delete_global_ref != NULL && dev->isr == lang_func->java_isr_callback) {
+        lang_func->java_delete_global_ref(dev->isr_args);
+    }
+
+    return MRAA_SUCCESS;
+}
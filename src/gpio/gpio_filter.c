@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+#include "gpio/gpio_chardev.h"
+#include "gpio/gpio_filter.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Edge of one pin waiting for the level to settle. */
+typedef struct {
+    mraa_gpio_filter_edge edge;
+    mraa_boolean_t held;
+    uint64_t deadline_ns;   /**< on the clock of the edge timestamps */
+    uint64_t deadline_mono; /**< the same on CLOCK_MONOTONIC, for timers */
+} mraa_gpio_filter_line;
+
+/*
+ * Thresholds may be changed while the event thread reads them, they are
+ * plain atomics. The per line state is only touched by the event thread.
+ */
+struct _gpio_filter {
+    uint64_t stable_ns;
+    uint64_t rising_ns;
+    uint64_t falling_ns;
+    unsigned int num_lines;
+    mraa_gpio_filter_line lines[];
+};
+
+uint64_t
+_mraa_gpio_filter_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+mraa_gpio_filter_record(mraa_gpio_context dev, int line_idx, const mraa_gpio_filter_edge* edge)
+{
+    if (dev->event_rings) {
+        _mraa_gpio_event_ring_push(&dev->event_rings[line_idx], edge->timestamp, edge->id, edge->seqno,
+                                   edge->line_seqno);
+    }
+
+    if (dev->events) {
+        dev->events[line_idx].id = line_idx;
+        dev->events[line_idx].timestamp = edge->timestamp;
+    }
+}
+
+static uint64_t
+mraa_gpio_filter_threshold(struct _gpio_filter* filter, int level)
+{
+    uint64_t threshold = 0;
+
+    /* Hysteresis: the time the line has to stay at the new level. */
+    if (level == 1) {
+        threshold = __atomic_load_n(&filter->rising_ns, __ATOMIC_RELAXED);
+    } else if (level == 0) {
+        threshold = __atomic_load_n(&filter->falling_ns, __ATOMIC_RELAXED);
+    }
+    if (threshold == 0) {
+        threshold = __atomic_load_n(&filter->stable_ns, __ATOMIC_RELAXED);
+    }
+
+    return threshold;
+}
+
+void
+_mraa_gpio_filter_edge(mraa_gpio_context dev, int line_idx, const mraa_gpio_filter_edge* edge)
+{
+    struct _gpio_filter* filter = __atomic_load_n(&dev->filter, __ATOMIC_ACQUIRE);
+
+    if (filter == NULL || line_idx < 0 || (unsigned int) line_idx >= filter->num_lines) {
+        mraa_gpio_filter_record(dev, line_idx, edge);
+        return;
+    }
+
+    mraa_gpio_filter_line* line = &filter->lines[line_idx];
+
+    if (line->held) {
+        /* Stable for long enough, only the timer hadn't fired yet. A clock
+         * going backwards (sysfs timestamps are wall clock) counts as a glitch. */
+        if (edge->timestamp_ns >= line->deadline_ns) {
+            mraa_gpio_filter_record(dev, line_idx, &line->edge);
+            line->held = 0;
+        } else if (edge->level == -1 || edge->level != line->edge.level) {
+            /* Back to where it was before the held edge: both are a glitch. */
+            line->held = 0;
+            return;
+        }
+        /* Otherwise the opposite edge was missed (single edge mode or an
+         * overflow), the level has to settle again from here. */
+    }
+
+    uint64_t threshold = mraa_gpio_filter_threshold(filter, edge->level);
+    if (threshold == 0) {
+        mraa_gpio_filter_record(dev, line_idx, edge);
+        return;
+    }
+
+    /* Processing lags the edge, the monotonic deadline errs on the late side. */
+    line->edge = *edge;
+    line->deadline_ns = edge->timestamp_ns + threshold;
+    line->deadline_mono = _mraa_gpio_filter_now() + threshold;
+    line->held = 1;
+}
+
+int
+_mraa_gpio_filter_expire(mraa_gpio_context dev, uint64_t now)
+{
+    struct _gpio_filter* filter = __atomic_load_n(&dev->filter, __ATOMIC_ACQUIRE);
+    int delivered = 0;
+
+    if (filter == NULL) {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < filter->num_lines; ++i) {
+        mraa_gpio_filter_line* line = &filter->lines[i];
+
+        if (line->held && line->deadline_mono <= now) {
+            mraa_gpio_filter_record(dev, i, &line->edge);
+            line->held = 0;
+            delivered++;
+        }
+    }
+
+    return delivered;
+}
+
+uint64_t
+_mraa_gpio_filter_deadline(mraa_gpio_context dev)
+{
+    struct _gpio_filter* filter = __atomic_load_n(&dev->filter, __ATOMIC_ACQUIRE);
+    uint64_t deadline = 0;
+
+    if (filter == NULL) {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < filter->num_lines; ++i) {
+        mraa_gpio_filter_line* line = &filter->lines[i];
+
+        if (line->held && (deadline == 0 || line->deadline_mono < deadline)) {
+            deadline = line->deadline_mono;
+        }
+    }
+
+    return deadline;
+}
+
+mraa_boolean_t
+_mraa_gpio_filter_pending(mraa_gpio_context dev)
+{
+    if (dev->filter == NULL || dev->events == NULL) {
+        return 1;
+    }
+
+    for (unsigned int i = 0; i < dev->num_pins; ++i) {
+        if (dev->events[i].id != -1) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void
+_mraa_gpio_filter_free(mraa_gpio_context dev)
+{
+    free(dev->filter);
+    dev->filter = NULL;
+}
+
+mraa_result_t
+mraa_gpio_glitch_filter(mraa_gpio_context dev, unsigned int stable_us, unsigned int rising_us, unsigned int falling_us)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: glitch_filter: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _gpio_filter* filter = dev->filter;
+
+    if (filter == NULL) {
+        if (stable_us == 0 && rising_us == 0 && falling_us == 0) {
+            return MRAA_SUCCESS;
+        }
+
+        /* Stays allocated until close, an isr may be using it right now. */
+        filter = calloc(1, sizeof(struct _gpio_filter) + dev->num_pins * sizeof(mraa_gpio_filter_line));
+        if (filter == NULL) {
+            syslog(LOG_ERR, "gpio: glitch_filter: Failed to allocate memory for filter");
+            return MRAA_ERROR_NO_RESOURCES;
+        }
+        filter->num_lines = dev->num_pins;
+    }
+
+    __atomic_store_n(&filter->stable_ns, (uint64_t) stable_us * 1000, __ATOMIC_RELAXED);
+    __atomic_store_n(&filter->rising_ns, (uint64_t) rising_us * 1000, __ATOMIC_RELAXED);
+    __atomic_store_n(&filter->falling_ns, (uint64_t) falling_us * 1000, __ATOMIC_RELAXED);
+    __atomic_store_n(&dev->filter, filter, __ATOMIC_RELEASE);
+
+    return MRAA_SUCCESS;
+}
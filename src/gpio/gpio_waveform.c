@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "gpio.h"
+#include "mraa_internal.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Enough for the largest mmap capable boards, same limit as write_mask. */
+#define MAX_BANKS 8
+/* Margin left for spinning after a sleep, covers typical wake up latency. */
+#define WAVE_SPIN_NS 100000ULL
+
+/* One precomputed register store, several per step when pins span banks. */
+typedef struct {
+    uint64_t offset_ns;
+    unsigned int bank;
+    uint32_t set;
+    uint32_t clear;
+} mraa_gpio_wave_store;
+
+typedef struct {
+    mraa_gpio_context dev;
+    const mraa_gpio_wave_step* steps;
+    unsigned int num_steps;
+    /* NULL when the steps go through mraa_gpio_write_mask(). */
+    mraa_gpio_wave_store* stores;
+    unsigned int num_stores;
+    mraa_gpio_context bank_writer;
+    int priority;
+    mraa_result_t result;
+    mraa_gpio_wave_stats stats;
+} mraa_gpio_wave_player;
+
+static inline uint64_t
+mraa_gpio_wave_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Memory mapped gpio number behind bit i of the waveform masks, -1 if that pin
+ * can't be written through mmap. Chardev contexts hold all pins in one
+ * context, sysfs ones chain a context per pin.
+ */
+static int
+mraa_gpio_wave_mmap_gpio(mraa_gpio_wave_player* player, int i)
+{
+    mraa_gpio_context dev = player->dev;
+
+    if (plat->chardev_capable) {
+        if (dev->mmap_write_bank == NULL || i >= dev->num_pins || dev->provided_pins == NULL) {
+            return -1;
+        }
+        player->bank_writer = dev;
+        return plat->pins[dev->provided_pins[i]].gpio.pinmap;
+    }
+
+    for (; dev != NULL && i > 0; dev = dev->next, --i)
+        ;
+    if (dev == NULL || dev->mmap_write_bank == NULL) {
+        return -1;
+    }
+    player->bank_writer = dev;
+    return dev->pin;
+}
+
+/*
+ * Turn the steps into bank set/clear words up front so the player only does
+ * stores. Fails (and the player falls back to write_mask) unless every pin
+ * used by the waveform is memory mapped.
+ */
+static mraa_result_t
+mraa_gpio_wave_compile(mraa_gpio_wave_player* player)
+{
+    int gpio[32];
+    uint32_t used = 0;
+
+    for (unsigned int s = 0; s < player->num_steps; ++s) {
+        used |= player->steps[s].mask;
+    }
+
+    for (int i = 0; i < 32; ++i) {
+        if (!(used & (1u << i))) {
+            continue;
+        }
+        gpio[i] = mraa_gpio_wave_mmap_gpio(player, i);
+        if (gpio[i] < 0 || gpio[i] / 32 >= MAX_BANKS) {
+            player->bank_writer = NULL;
+            return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+        }
+    }
+
+    if (player->bank_writer == NULL) {
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    player->stores = calloc(player->num_steps * MAX_BANKS, sizeof(mraa_gpio_wave_store));
+    if (player->stores == NULL) {
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    for (unsigned int s = 0; s < player->num_steps; ++s) {
+        const mraa_gpio_wave_step* step = &player->steps[s];
+        uint32_t set[MAX_BANKS] = { 0 };
+        uint32_t clear[MAX_BANKS] = { 0 };
+
+        for (int i = 0; i < 32; ++i) {
+            if (!(step->mask & (1u << i))) {
+                continue;
+            }
+            if (step->values & (1u << i)) {
+                set[gpio[i] / 32] |= 1u << (gpio[i] % 32);
+            } else {
+                clear[gpio[i] / 32] |= 1u << (gpio[i] % 32);
+            }
+        }
+
+        for (unsigned int bank = 0; bank < MAX_BANKS; ++bank) {
+            if (set[bank] || clear[bank]) {
+                mraa_gpio_wave_store* store = &player->stores[player->num_stores++];
+                store->offset_ns = step->offset_ns;
+                store->bank = bank;
+                store->set = set[bank];
+                store->clear = clear[bank];
+            }
+        }
+    }
+
+    return MRAA_SUCCESS;
+}
+
+/*
+ * Sleep until shortly before target, so a real time player doesn't starve the
+ * rest of the system during long gaps, then spin out the wake up jitter.
+ */
+static uint64_t
+mraa_gpio_wave_wait(uint64_t target)
+{
+    uint64_t now = mraa_gpio_wave_now();
+
+    if (now + WAVE_SPIN_NS < target) {
+        struct timespec ts;
+        uint64_t wake = target - WAVE_SPIN_NS;
+
+        ts.tv_sec = wake / 1000000000ULL;
+        ts.tv_nsec = wake % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+    }
+
+    while ((now = mraa_gpio_wave_now()) < target)
+        ;
+
+    return now;
+}
+
+static void
+mraa_gpio_wave_account(mraa_gpio_wave_player* player, uint64_t late_ns, uint64_t* total_late)
+{
+    if (late_ns > player->stats.max_late_ns) {
+        player->stats.max_late_ns = late_ns;
+    }
+    *total_late += late_ns;
+}
+
+static void*
+mraa_gpio_wave_thread(void* arg)
+{
+    mraa_gpio_wave_player* player = (mraa_gpio_wave_player*) arg;
+    uint64_t total_late = 0;
+    uint64_t start, now;
+    unsigned int count;
+
+    if (player->priority > 0 && mraa_set_priority(player->priority) != 0) {
+        syslog(LOG_WARNING, "gpio: waveform: could not raise priority: %s", strerror(errno));
+    }
+
+    start = mraa_gpio_wave_now();
+    now = start;
+
+    if (player->stores != NULL) {
+        mraa_gpio_context writer = player->bank_writer;
+
+        for (count = 0; count < player->num_stores; ++count) {
+            const mraa_gpio_wave_store* store = &player->stores[count];
+            uint64_t target = start + store->offset_ns;
+
+            now = mraa_gpio_wave_wait(target);
+
+            writer->mmap_write_bank(writer, store->bank, store->set, store->clear);
+            mraa_gpio_wave_account(player, now - target, &total_late);
+        }
+    } else {
+        for (count = 0; count < player->num_steps; ++count) {
+            const mraa_gpio_wave_step* step = &player->steps[count];
+            uint64_t target = start + step->offset_ns;
+
+            now = mraa_gpio_wave_wait(target);
+
+            player->result = mraa_gpio_write_mask(player->dev, step->mask, step->values);
+            if (player->result != MRAA_SUCCESS) {
+                break;
+            }
+            mraa_gpio_wave_account(player, now - target, &total_late);
+        }
+    }
+
+    player->stats.num_writes = count;
+    player->stats.mean_late_ns = count ? total_late / count : 0;
+    player->stats.duration_ns = mraa_gpio_wave_now() - start;
+
+    return NULL;
+}
+
+mraa_result_t
+mraa_gpio_play_waveform(mraa_gpio_context dev,
+                        const mraa_gpio_wave_step* steps,
+                        unsigned int num_steps,
+                        int priority,
+                        mraa_gpio_wave_stats* stats)
+{
+    mraa_gpio_wave_player player;
+    pthread_t thread;
+
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: waveform: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (steps == NULL || num_steps == 0) {
+        syslog(LOG_ERR, "gpio: waveform: no steps given");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    for (unsigned int s = 1; s < num_steps; ++s) {
+        if (steps[s].offset_ns < steps[s - 1].offset_ns) {
+            syslog(LOG_ERR, "gpio: waveform: step %u goes back in time", s);
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    memset(&player, 0, sizeof(player));
+    player.dev = dev;
+    player.steps = steps;
+    player.num_steps = num_steps;
+    player.priority = priority;
+    player.result = MRAA_SUCCESS;
+
+    /* Chardev (or sysfs) writes are used for anything not memory mapped. */
+    if (mraa_gpio_wave_compile(&player) == MRAA_ERROR_NO_RESOURCES) {
+        syslog(LOG_ERR, "gpio: waveform: malloc error");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    /* A dedicated thread keeps the caller's scheduling policy untouched. */
+    if (pthread_create(&thread, NULL, mraa_gpio_wave_thread, &player) != 0) {
+        free(player.stores);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    pthread_join(thread, NULL);
+    free(player.stores);
+
+    if (stats != NULL) {
+        *stats = player.stats;
+    }
+
+    return player.result;
+}
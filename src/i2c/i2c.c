@@ -27,6 +27,8 @@
 
 #include "i2c.h"
 #include "mraa_internal.h"
+#include "i2c/i2c_regmap.h"
+#include "i2c/i2c_sched.h"
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -41,6 +43,7 @@
 #include "linux/i2c-dev.h"
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 
 typedef union i2c_smbus_data_union {
     uint8_t byte;        ///< data byte
@@ -57,6 +60,27 @@ typedef struct i2c_smbus_ioctl_data_struct {
 } i2c_smbus_ioctl_data_t;
 
 
+/*
+ * All contexts on the same /dev/i2c-N share one fd. The slave address bound
+ * to it with I2C_SLAVE is remembered, so it is only changed when a context
+ * with another address uses the bus. lock keeps the address and the transfer
+ * that needs it together.
+ */
+struct _i2c_bus {
+    unsigned int busnum;
+    int fh;
+    int refs;
+    int addr; /**< bound slave address, -1 if unknown */
+    unsigned long funcs;
+    int (*read_bytes_data)(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length);
+    mraa_result_t (*write)(mraa_i2c_context dev, const uint8_t* data, int length);
+    pthread_mutex_t lock;
+    struct _i2c_bus* next;
+};
+
+static struct _i2c_bus* i2c_buses = NULL;
+static pthread_mutex_t i2c_buses_lock = PTHREAD_MUTEX_INITIALIZER;
+
 // static mraa_adv_func_t* func_table;
 
 int
@@ -72,6 +96,299 @@ mraa_i2c_smbus_access(int fh, uint8_t read_write, uint8_t command, int size, i2c
     return ioctl(fh, I2C_SMBUS, &args);
 }
 
+static void mraa_i2c_bus_select(struct _i2c_bus* bus);
+
+static mraa_result_t
+mraa_i2c_bus_get(mraa_i2c_context dev, unsigned int busnum)
+{
+    struct _i2c_bus* bus;
+    mraa_result_t status = MRAA_SUCCESS;
+
+    pthread_mutex_lock(&i2c_buses_lock);
+    for (bus = i2c_buses; bus != NULL && bus->busnum != busnum; bus = bus->next)
+        ;
+
+    if (bus == NULL) {
+        char filepath[32];
+        int fh;
+
+        snprintf(filepath, 32, "/dev/i2c-%u", busnum);
+        if ((fh = open(filepath, O_RDWR)) < 1) {
+            syslog(LOG_ERR, "i2c%i_init: Failed to open requested i2c port %s: %s", busnum, filepath, strerror(errno));
+            status = MRAA_ERROR_INVALID_RESOURCE;
+            goto bus_get_unlock;
+        }
+
+        bus = calloc(1, sizeof(struct _i2c_bus));
+        if (bus == NULL) {
+            syslog(LOG_CRIT, "i2c%i_init: Failed to allocate memory for bus", busnum);
+            close(fh);
+            status = MRAA_ERROR_NO_RESOURCES;
+            goto bus_get_unlock;
+        }
+
+        if (ioctl(fh, I2C_FUNCS, &bus->funcs) < 0) {
+            syslog(LOG_CRIT, "i2c%i_init: Failed to get I2C_FUNC map from device: %s", busnum, strerror(errno));
+            bus->funcs = 0;
+        }
+
+        bus->busnum = busnum;
+        bus->fh = fh;
+        bus->addr = -1;
+        mraa_i2c_bus_select(bus);
+        pthread_mutex_init(&bus->lock, NULL);
+        bus->next = i2c_buses;
+        i2c_buses = bus;
+    }
+
+    bus->refs++;
+    dev->bus = bus;
+    dev->fh = bus->fh;
+    dev->funcs = bus->funcs;
+
+bus_get_unlock:
+    pthread_mutex_unlock(&i2c_buses_lock);
+    return status;
+}
+
+static void
+mraa_i2c_bus_put(mraa_i2c_context dev)
+{
+    struct _i2c_bus** it;
+
+    pthread_mutex_lock(&i2c_buses_lock);
+    for (it = &i2c_buses; *it != NULL && *it != dev->bus; it = &(*it)->next)
+        ;
+
+    if (*it != NULL && --(*it)->refs == 0) {
+        struct _i2c_bus* bus = *it;
+        *it = bus->next;
+        close(bus->fh);
+        pthread_mutex_destroy(&bus->lock);
+        free(bus);
+    }
+    pthread_mutex_unlock(&i2c_buses_lock);
+
+    dev->bus = NULL;
+}
+
+/* Take the bus for a transfer to the context's slave, unlock with mraa_i2c_bus_release(). */
+static int
+mraa_i2c_bus_acquire(mraa_i2c_context dev)
+{
+    struct _i2c_bus* bus = dev->bus;
+
+    pthread_mutex_lock(&bus->lock);
+    if (bus->addr != dev->addr) {
+        if (ioctl(bus->fh, I2C_SLAVE_FORCE, dev->addr) < 0) {
+            int err = errno;
+            bus->addr = -1;
+            pthread_mutex_unlock(&bus->lock);
+            errno = err;
+            return -1;
+        }
+        bus->addr = dev->addr;
+    }
+
+    return 0;
+}
+
+static void
+mraa_i2c_bus_release(mraa_i2c_context dev)
+{
+    int err = errno;
+    pthread_mutex_unlock(&dev->bus->lock);
+    errno = err;
+}
+
+static int
+mraa_i2c_bus_smbus(mraa_i2c_context dev, uint8_t read_write, uint8_t command, int size, i2c_smbus_data_t* data)
+{
+    if (mraa_i2c_bus_acquire(dev) < 0) {
+        return -1;
+    }
+
+    int ret = mraa_i2c_smbus_access(dev->fh, read_write, command, size, data);
+    mraa_i2c_bus_release(dev);
+
+    return ret;
+}
+
+/*
+ * Register block access, one function per primitive an adapter may offer.
+ * All of them assume the device auto increments its register address, as a
+ * multi byte read or write of a register block always did.
+ */
+static int
+mraa_i2c_read_bytes_rdwr(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length)
+{
+    struct i2c_rdwr_ioctl_data d;
+    struct i2c_msg m[2];
+
+    m[0].addr = dev->addr;
+    m[0].flags = 0x00;
+    m[0].len = 1;
+    m[0].buf = (char*) &command;
+    m[1].addr = dev->addr;
+    m[1].flags = I2C_M_RD;
+    m[1].len = length;
+    m[1].buf = (char*) data;
+
+    d.msgs = m;
+    d.nmsgs = 2;
+
+    if (ioctl(dev->fh, I2C_RDWR, &d) < 0) {
+        return -1;
+    }
+    return length;
+}
+
+static int
+mraa_i2c_read_bytes_block(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length)
+{
+    i2c_smbus_data_t d;
+    int done = 0;
+
+    while (done < length) {
+        int chunk = length - done;
+        if (chunk > I2C_SMBUS_I2C_BLOCK_MAX) {
+            chunk = I2C_SMBUS_I2C_BLOCK_MAX;
+        }
+        d.block[0] = chunk;
+        if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_READ, command + done, I2C_SMBUS_I2C_BLOCK_DATA, &d) < 0) {
+            return -1;
+        }
+        memcpy(&data[done], &d.block[1], chunk);
+        done += chunk;
+    }
+    return length;
+}
+
+static int
+mraa_i2c_read_bytes_bytewise(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length)
+{
+    i2c_smbus_data_t d;
+
+    for (int i = 0; i < length; i++) {
+        if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_READ, command + i, I2C_SMBUS_BYTE_DATA, &d) < 0) {
+            return -1;
+        }
+        data[i] = d.byte;
+    }
+    return length;
+}
+
+static mraa_result_t
+mraa_i2c_write_rdwr(mraa_i2c_context dev, const uint8_t* data, int length)
+{
+    struct i2c_rdwr_ioctl_data d;
+    struct i2c_msg m;
+
+    m.addr = dev->addr;
+    m.flags = 0x00;
+    m.len = length;
+    m.buf = (char*) data;
+
+    d.msgs = &m;
+    d.nmsgs = 1;
+
+    return ioctl(dev->fh, I2C_RDWR, &d) < 0 ? MRAA_ERROR_UNSPECIFIED : MRAA_SUCCESS;
+}
+
+static mraa_result_t
+mraa_i2c_write_block(mraa_i2c_context dev, const uint8_t* data, int length)
+{
+    i2c_smbus_data_t d;
+    uint8_t command = data[0];
+    int done = 0;
+
+    data = &data[1];
+    length = length - 1;
+    if (length == 0) {
+        return mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE, NULL) < 0 ? MRAA_ERROR_UNSPECIFIED : MRAA_SUCCESS;
+    }
+
+    while (done < length) {
+        int chunk = length - done;
+        if (chunk > I2C_SMBUS_I2C_BLOCK_MAX) {
+            chunk = I2C_SMBUS_I2C_BLOCK_MAX;
+        }
+        d.block[0] = chunk;
+        memcpy(&d.block[1], &data[done], chunk);
+        if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, command + done, I2C_SMBUS_I2C_BLOCK_DATA, &d) < 0) {
+            return MRAA_ERROR_UNSPECIFIED;
+        }
+        done += chunk;
+    }
+    return MRAA_SUCCESS;
+}
+
+/*
+ * Longer writes are not split into byte writes, the device would see a stop
+ * between every register and may latch a half written value.
+ */
+static mraa_result_t
+mraa_i2c_write_byte_data_only(mraa_i2c_context dev, const uint8_t* data, int length)
+{
+    i2c_smbus_data_t d;
+    uint8_t command = data[0];
+
+    if (length == 1) {
+        return mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE, NULL) < 0 ? MRAA_ERROR_UNSPECIFIED : MRAA_SUCCESS;
+    }
+    if (length > 2) {
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    d.byte = data[1];
+    return mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &d) < 0 ? MRAA_ERROR_UNSPECIFIED : MRAA_SUCCESS;
+}
+
+/* Cheapest first, a bus uses the first entry its adapter has all funcs for */
+static const struct {
+    unsigned long funcs;
+    int (*fn)(mraa_i2c_context dev, uint8_t command, uint8_t* data, int length);
+} i2c_read_strategies[] = {
+    { I2C_FUNC_I2C, mraa_i2c_read_bytes_rdwr },
+    { I2C_FUNC_SMBUS_READ_I2C_BLOCK, mraa_i2c_read_bytes_block },
+    { I2C_FUNC_SMBUS_READ_BYTE_DATA, mraa_i2c_read_bytes_bytewise },
+};
+
+static const struct {
+    unsigned long funcs;
+    mraa_result_t (*fn)(mraa_i2c_context dev, const uint8_t* data, int length);
+} i2c_write_strategies[] = {
+    { I2C_FUNC_I2C, mraa_i2c_write_rdwr },
+    { I2C_FUNC_SMBUS_WRITE_I2C_BLOCK, mraa_i2c_write_block },
+    { I2C_FUNC_SMBUS_WRITE_BYTE_DATA, mraa_i2c_write_byte_data_only },
+};
+
+static void
+mraa_i2c_bus_select(struct _i2c_bus* bus)
+{
+    unsigned int i;
+
+    // funcs is 0 when the adapter could not be asked, keep what always worked
+    if (bus->funcs == 0) {
+        bus->read_bytes_data = mraa_i2c_read_bytes_rdwr;
+        bus->write = mraa_i2c_write_block;
+        return;
+    }
+
+    for (i = 0; i < sizeof(i2c_read_strategies) / sizeof(i2c_read_strategies[0]); i++) {
+        if ((bus->funcs & i2c_read_strategies[i].funcs) == i2c_read_strategies[i].funcs) {
+            bus->read_bytes_data = i2c_read_strategies[i].fn;
+            break;
+        }
+    }
+    for (i = 0; i < sizeof(i2c_write_strategies) / sizeof(i2c_write_strategies[0]); i++) {
+        if ((bus->funcs & i2c_write_strategies[i].funcs) == i2c_write_strategies[i].funcs) {
+            bus->write = i2c_write_strategies[i].fn;
+            break;
+        }
+    }
+}
+
 static mraa_i2c_context
 mraa_i2c_init_internal(mraa_adv_func_t* advance_func, unsigned int bus)
 {
@@ -100,18 +417,9 @@ mraa_i2c_init_internal(mraa_adv_func_t* advance_func, unsigned int bus)
         if (status != MRAA_SUCCESS)
             goto init_internal_cleanup;
     } else {
-        char filepath[32];
-        snprintf(filepath, 32, "/dev/i2c-%u", bus);
-        if ((dev->fh = open(filepath, O_RDWR)) < 1) {
-            syslog(LOG_ERR, "i2c%i_init: Failed to open requested i2c port %s: %s", bus, filepath, strerror(errno));
-            status = MRAA_ERROR_INVALID_RESOURCE;
+        status = mraa_i2c_bus_get(dev, bus);
+        if (status != MRAA_SUCCESS)
             goto init_internal_cleanup;
-        }
-
-        if (ioctl(dev->fh, I2C_FUNCS, &dev->funcs) < 0) {
-            syslog(LOG_CRIT, "i2c%i_init: Failed to get I2C_FUNC map from device: %s", bus, strerror(errno));
-            dev->funcs = 0;
-        }
     }
 
     if (IS_FUNC_DEFINED(dev, i2c_init_post)) {
@@ -125,8 +433,9 @@ init_internal_cleanup:
     if (status == MRAA_SUCCESS) {
         return dev;
     } else {
-        if (dev != NULL)
-            free(dev);
+        if (dev->bus != NULL)
+            mraa_i2c_bus_put(dev);
+        free(dev);
         return NULL;
    }
 }
@@ -220,8 +529,9 @@ mraa_i2c_read(mraa_i2c_context dev, uint8_t* data, int length)
     if (IS_FUNC_DEFINED(dev, i2c_read_replace)) {
         bytes_read = dev->advance_func->i2c_read_replace(dev, data, length);
     }
-    else {
+    else if (mraa_i2c_bus_acquire(dev) == 0) {
         bytes_read = read(dev->fh, data, length);
+        mraa_i2c_bus_release(dev);
     }
     if (bytes_read == length) {
         return length;
@@ -241,7 +551,7 @@ mraa_i2c_read_byte(mraa_i2c_context dev)
     if (IS_FUNC_DEFINED(dev, i2c_read_byte_replace))
         return dev->advance_func->i2c_read_byte_replace(dev);
     i2c_smbus_data_t d;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_READ, I2C_NOCMD, I2C_SMBUS_BYTE, &d) < 0) {
+    if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_READ, I2C_NOCMD, I2C_SMBUS_BYTE, &d) < 0) {
         syslog(LOG_ERR, "i2c%i: read_byte: Access error: %s", dev->busnum, strerror(errno));
         return -1;
     }
@@ -259,7 +569,7 @@ mraa_i2c_read_byte_data(mraa_i2c_context dev, uint8_t command)
     if (IS_FUNC_DEFINED(dev, i2c_read_byte_data_replace))
         return dev->advance_func->i2c_read_byte_data_replace(dev, command);
     i2c_smbus_data_t d;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_READ, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
+    if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_READ, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
        syslog(LOG_ERR, "i2c%i: read_byte_data: Access error: %s", dev->busnum, strerror(errno));
        return -1;
     }
@@ -277,7 +587,7 @@ mraa_i2c_read_word_data(mraa_i2c_context dev, uint8_t command)
     if (IS_FUNC_DEFINED(dev, i2c_read_word_data_replace))
         return dev->advance_func->i2c_read_word_data_replace(dev, command);
     i2c_smbus_data_t d;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_READ, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
+    if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_READ, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c%i: read_word_data: Access error: %s", dev->busnum, strerror(errno));
         return -1;
     }
@@ -294,31 +604,27 @@ mraa_i2c_read_bytes_data(mraa_i2c_context dev, uint8_t command, uint8_t* data, i
 
     if (IS_FUNC_DEFINED(dev, i2c_read_bytes_data_replace))
         return dev->advance_func->i2c_read_bytes_data_replace(dev, command, data, length);
-    struct i2c_rdwr_ioctl_data d;
-    struct i2c_msg m[2];
-
-    m[0].addr = dev->addr;
-    m[0].flags = 0x00;
-    m[0].len = 1;
-    m[0].buf = (char*) &command;
-    m[1].addr = dev->addr;
-    m[1].flags = I2C_M_RD;
-    m[1].len = length;
-    m[1].buf = (char*) data;
-
-    d.msgs = m;
-    d.nmsgs = 2;
 
-    int ret = ioctl(dev->fh, I2C_RDWR, &d);
-
-    if (ret < 0)
-    {
+    if (dev->bus->read_bytes_data == NULL) {
+        syslog(LOG_ERR, "i2c%i: read_bytes_data: adapter can't read register blocks", dev->busnum);
+        return -1;
+    }
+    if (dev->bus->read_bytes_data(dev, command, data, length) < 0) {
         syslog(LOG_ERR, "i2c%i: read_bytes_data: Access error: %s", dev->busnum, strerror(errno));
         return -1;
     }
     return length;
 }
 
+mraa_boolean_t
+_mraa_i2c_can_write_block(mraa_i2c_context dev)
+{
+    if (IS_FUNC_DEFINED(dev, i2c_write_replace))
+        return 1;
+
+    return dev->bus->write != NULL && dev->bus->write != mraa_i2c_write_byte_data_only;
+}
+
 mraa_result_t
 mraa_i2c_write(mraa_i2c_context dev, const uint8_t* data, int length)
 {
@@ -327,24 +633,26 @@ mraa_i2c_write(mraa_i2c_context dev, const uint8_t* data, int length)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    if (length > 0)
+        _mraa_i2c_regmap_written(dev, data[0], length - 1);
+
     if (IS_FUNC_DEFINED(dev, i2c_write_replace))
         return dev->advance_func->i2c_write_replace(dev, data, length);
-    i2c_smbus_data_t d;
-    int i;
-    uint8_t command = data[0];
 
-    data = &data[1];
-    length = length - 1;
-    if (length > I2C_SMBUS_I2C_BLOCK_MAX) {
-        length = I2C_SMBUS_I2C_BLOCK_MAX;
+    if (length < 1) {
+        syslog(LOG_ERR, "i2c%i: write: nothing to write", dev->busnum);
+        return MRAA_ERROR_INVALID_PARAMETER;
     }
-
-    for (i = 1; i <= length; i++) {
-        d.block[i] = data[i - 1];
+    if (dev->bus->write == NULL) {
+        syslog(LOG_ERR, "i2c%i: write: adapter can't write register blocks", dev->busnum);
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
     }
-    d.block[0] = length;
-
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, command, I2C_SMBUS_I2C_BLOCK_DATA, &d) < 0) {
+    mraa_result_t ret = dev->bus->write(dev, data, length);
+    if (ret == MRAA_ERROR_FEATURE_NOT_SUPPORTED) {
+        syslog(LOG_ERR, "i2c%i: write: adapter can't write %d bytes in one transaction", dev->busnum, length);
+        return ret;
+    }
+    if (ret != MRAA_SUCCESS) {
         syslog(LOG_ERR, "i2c%i: write: Access error: %s", dev->busnum, strerror(errno));
         return MRAA_ERROR_UNSPECIFIED;
     }
@@ -362,7 +670,7 @@ mraa_i2c_write_byte(mraa_i2c_context dev, const uint8_t data)
     if (IS_FUNC_DEFINED(dev, i2c_write_byte_replace)) {
         return dev->advance_func->i2c_write_byte_replace(dev, data);
     } else {
-        if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, data, I2C_SMBUS_BYTE, NULL) < 0) {
+        if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, data, I2C_SMBUS_BYTE, NULL) < 0) {
             syslog(LOG_ERR, "i2c%i: write_byte: Access error: %s", dev->busnum, strerror(errno));
             return MRAA_ERROR_UNSPECIFIED;
         }
@@ -378,11 +686,13 @@ mraa_i2c_write_byte_data(mraa_i2c_context dev, const uint8_t data, const uint8_t
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    _mraa_i2c_regmap_written(dev, command, 1);
+
     if (IS_FUNC_DEFINED(dev, i2c_write_byte_data_replace))
         return dev->advance_func->i2c_write_byte_data_replace(dev, data, command);
     i2c_smbus_data_t d;
     d.byte = data;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
+    if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_BYTE_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c%i: write_byte_data: Access error: %s", dev->busnum, strerror(errno));
         return MRAA_ERROR_UNSPECIFIED;
     }
@@ -397,17 +707,165 @@ mraa_i2c_write_word_data(mraa_i2c_context dev, const uint16_t data, const uint8_
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    _mraa_i2c_regmap_written(dev, command, 2);
+
     if (IS_FUNC_DEFINED(dev, i2c_write_word_data_replace))
         return dev->advance_func->i2c_write_word_data_replace(dev, data, command);
     i2c_smbus_data_t d;
     d.word = data;
-    if (mraa_i2c_smbus_access(dev->fh, I2C_SMBUS_WRITE, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
+    if (mraa_i2c_bus_smbus(dev, I2C_SMBUS_WRITE, command, I2C_SMBUS_WORD_DATA, &d) < 0) {
         syslog(LOG_ERR, "i2c%i: write_word_data: Access error: %s", dev->busnum, strerror(errno));
         return MRAA_ERROR_UNSPECIFIED;
     }
     return MRAA_SUCCESS;
 }
 
+/*
+ * Run a transfer through the regular per call functions, for backends that
+ * don't talk to i2c-dev. Only the repeated start between a register write and
+ * the following read is kept, by turning the pair into a read_bytes_data.
+ */
+static mraa_result_t
+mraa_i2c_transfer_emulated(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int num_msgs)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+    int saved_addr = dev->addr;
+    int addr = saved_addr;
+    uint8_t* joined = NULL;
+    int i;
+
+    // only writes can be glued together here
+    for (i = 1; i < num_msgs; i++) {
+        if ((msgs[i].flags & MRAA_I2C_MSG_NOSTART) &&
+            ((msgs[i].flags & MRAA_I2C_MSG_RD) || (msgs[i - 1].flags & MRAA_I2C_MSG_RD))) {
+            syslog(LOG_ERR, "i2c%i: transfer: message %d can't continue without a start here", dev->busnum, i);
+            return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+        }
+    }
+
+    i = 0;
+    while (i < num_msgs && ret == MRAA_SUCCESS) {
+        mraa_i2c_msg_t* m = &msgs[i];
+        int next = i + 1;
+
+        if (m->addr != addr) {
+            ret = mraa_i2c_address(dev, m->addr);
+            if (ret != MRAA_SUCCESS) {
+                break;
+            }
+            addr = m->addr;
+        }
+
+        if (m->flags & MRAA_I2C_MSG_RD) {
+            if (mraa_i2c_read(dev, m->buf, m->len) != m->len) {
+                ret = MRAA_ERROR_UNSPECIFIED;
+            }
+        } else if (m->len == 1 && next < num_msgs && msgs[next].addr == m->addr &&
+                   msgs[next].flags == MRAA_I2C_MSG_RD) {
+            if (mraa_i2c_read_bytes_data(dev, m->buf[0], msgs[next].buf, msgs[next].len) != msgs[next].len) {
+                ret = MRAA_ERROR_UNSPECIFIED;
+            }
+            next++;
+        } else {
+            // NOSTART writes continue this one on the wire, so send them together
+            int len = m->len;
+            while (next < num_msgs && msgs[next].flags == MRAA_I2C_MSG_NOSTART) {
+                len += msgs[next++].len;
+            }
+
+            if (next == i + 1) {
+                ret = mraa_i2c_write(dev, m->buf, m->len);
+            } else {
+                joined = realloc(joined, len);
+                if (joined == NULL) {
+                    ret = MRAA_ERROR_NO_RESOURCES;
+                    break;
+                }
+                len = 0;
+                for (int j = i; j < next; j++) {
+                    memcpy(&joined[len], msgs[j].buf, msgs[j].len);
+                    len += msgs[j].len;
+                }
+                ret = mraa_i2c_write(dev, joined, len);
+            }
+        }
+
+        i = next;
+    }
+
+    free(joined);
+    if (addr != saved_addr) {
+        mraa_i2c_address(dev, (uint8_t) saved_addr);
+    }
+
+    return ret;
+}
+
+mraa_result_t
+mraa_i2c_transfer(mraa_i2c_context dev, mraa_i2c_msg_t* msgs, int num_msgs)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: transfer: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (msgs == NULL || num_msgs <= 0 || num_msgs > MRAA_I2C_TRANSFER_MAX_MSGS) {
+        syslog(LOG_ERR, "i2c%i: transfer: need 1 to %d messages", dev->busnum, MRAA_I2C_TRANSFER_MAX_MSGS);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (msgs[0].flags & MRAA_I2C_MSG_NOSTART) {
+        syslog(LOG_ERR, "i2c%i: transfer: the first message needs a start", dev->busnum);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    // a write to the context's slave carries the register first and then
+    // the data, a bare register write only moves the pointer
+    for (int i = 0; i < num_msgs; i++) {
+        if (!(msgs[i].flags & MRAA_I2C_MSG_RD) && msgs[i].addr == dev->addr && msgs[i].len > 1) {
+            _mraa_i2c_regmap_written(dev, msgs[i].buf[0], msgs[i].len - 1);
+        }
+    }
+
+    if (IS_FUNC_DEFINED(dev, i2c_transfer_replace)) {
+        return dev->advance_func->i2c_transfer_replace(dev, msgs, num_msgs);
+    }
+
+    if (IS_FUNC_DEFINED(dev, i2c_read_replace) || IS_FUNC_DEFINED(dev, i2c_write_replace)) {
+        return mraa_i2c_transfer_emulated(dev, msgs, num_msgs);
+    }
+
+    // funcs is 0 when the adapter could not be asked, just try then
+    int nostart = 0;
+    for (int i = 0; i < num_msgs; i++) {
+        nostart |= msgs[i].flags & MRAA_I2C_MSG_NOSTART;
+    }
+    if (dev->funcs != 0 && (!(dev->funcs & I2C_FUNC_I2C) || (nostart && !(dev->funcs & I2C_FUNC_NOSTART)))) {
+        syslog(LOG_ERR, "i2c%i: transfer: adapter can't do combined transfers", dev->busnum);
+        return MRAA_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+
+    struct i2c_msg m[MRAA_I2C_TRANSFER_MAX_MSGS];
+    struct i2c_rdwr_ioctl_data d;
+
+    for (int i = 0; i < num_msgs; i++) {
+        m[i].addr = msgs[i].addr;
+        m[i].flags = msgs[i].flags & (I2C_M_RD | I2C_M_NOSTART);
+        m[i].len = msgs[i].len;
+        m[i].buf = (char*) msgs[i].buf;
+    }
+
+    d.msgs = m;
+    d.nmsgs = num_msgs;
+
+    if (ioctl(dev->fh, I2C_RDWR, &d) < 0) {
+        syslog(LOG_ERR, "i2c%i: transfer: Access error: %s", dev->busnum, strerror(errno));
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+
+    return MRAA_SUCCESS;
+}
+
 mraa_result_t
 mraa_i2c_address(mraa_i2c_context dev, uint8_t addr)
 {
@@ -420,10 +878,12 @@ mraa_i2c_address(mraa_i2c_context dev, uint8_t addr)
     if (IS_FUNC_DEFINED(dev, i2c_address_replace)) {
         return dev->advance_func->i2c_address_replace(dev, addr);
     } else {
-        if (ioctl(dev->fh, I2C_SLAVE_FORCE, addr) < 0) {
+        // binds now to report a bad address early, a no-op if already bound
+        if (mraa_i2c_bus_acquire(dev) < 0) {
             syslog(LOG_ERR, "i2c%i: address: Failed to set slave address %d: %s", dev->busnum, addr, strerror(errno));
             return MRAA_ERROR_UNSPECIFIED;
         }
+        mraa_i2c_bus_release(dev);
         return MRAA_SUCCESS;
     }
 }
@@ -437,11 +897,14 @@ mraa_i2c_stop(mraa_i2c_context dev)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    _mraa_i2c_sched_release(dev);
+    _mraa_i2c_regmap_free(dev);
+
     if (IS_FUNC_DEFINED(dev, i2c_stop_replace)) {
         return dev->advance_func->i2c_stop_replace(dev);
     }
 
-    close(dev->fh);
+    mraa_i2c_bus_put(dev);
     free(dev);
     return MRAA_SUCCESS;
 }
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "i2c.h"
+#include "mraa_internal.h"
+#include "i2c/i2c_regmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest run mraa_i2c_write() puts on the wire in one go, SMBus block size. */
+#define MRAA_I2C_REGMAP_MAX_RUN 32
+
+/* Per register state bits. */
+#define REG_DECLARED 0x01
+#define REG_VOLATILE 0x02
+#define REG_VALID 0x04
+#define REG_DIRTY 0x08
+
+/*
+ * One slot per 8 bit register address. Values are only kept for declared,
+ * non volatile registers and belong to the slave address in addr.
+ */
+struct _i2c_regmap {
+    int addr;
+    mraa_boolean_t cache_only;
+    uint8_t state[256];
+    uint8_t value[256];
+};
+
+static mraa_boolean_t
+mraa_i2c_regmap_cacheable(struct _i2c_regmap* map, uint8_t reg)
+{
+    return (map->state[reg] & (REG_DECLARED | REG_VOLATILE)) == REG_DECLARED;
+}
+
+/* The cache follows the context to a new slave address, empty. */
+static struct _i2c_regmap*
+mraa_i2c_regmap_get(mraa_i2c_context dev)
+{
+    struct _i2c_regmap* map = dev->regmap;
+
+    if (map != NULL && map->addr != dev->addr) {
+        for (int i = 0; i < 256; i++) {
+            if (map->state[i] & REG_DIRTY) {
+                syslog(LOG_WARNING, "i2c%i: regmap: slave address changed, unsynced writes to 0x%x dropped",
+                       dev->busnum, map->addr);
+                break;
+            }
+        }
+        for (int i = 0; i < 256; i++) {
+            map->state[i] &= ~(REG_VALID | REG_DIRTY);
+        }
+        map->addr = dev->addr;
+    }
+
+    return map;
+}
+
+void
+_mraa_i2c_regmap_written(mraa_i2c_context dev, uint8_t reg, int length)
+{
+    struct _i2c_regmap* map = dev->regmap;
+
+    if (map == NULL) {
+        return;
+    }
+
+    for (int i = reg; i < reg + length && i < 256; i++) {
+        map->state[i] &= ~(REG_VALID | REG_DIRTY);
+    }
+}
+
+void
+_mraa_i2c_regmap_free(mraa_i2c_context dev)
+{
+    free(dev->regmap);
+    dev->regmap = NULL;
+}
+
+mraa_result_t
+mraa_i2c_regmap(mraa_i2c_context dev, const mraa_i2c_reg_t* regs, int num_regs)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: regmap: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (regs == NULL || num_regs <= 0) {
+        _mraa_i2c_regmap_free(dev);
+        return MRAA_SUCCESS;
+    }
+
+    struct _i2c_regmap* map = calloc(1, sizeof(struct _i2c_regmap));
+    if (map == NULL) {
+        syslog(LOG_CRIT, "i2c%i: regmap: Failed to allocate memory for register cache", dev->busnum);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    map->addr = dev->addr;
+    for (int i = 0; i < num_regs; i++) {
+        map->state[regs[i].reg] = REG_DECLARED;
+        if (regs[i].flags & MRAA_I2C_REG_VOLATILE) {
+            map->state[regs[i].reg] |= REG_VOLATILE;
+        }
+    }
+
+    free(dev->regmap);
+    dev->regmap = map;
+
+    return MRAA_SUCCESS;
+}
+
+int
+mraa_i2c_regmap_read_bytes(mraa_i2c_context dev, uint8_t reg, uint8_t* data, int length)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: regmap_read_bytes: context is invalid");
+        return -1;
+    }
+
+    struct _i2c_regmap* map = mraa_i2c_regmap_get(dev);
+    if (map == NULL) {
+        return mraa_i2c_read_bytes_data(dev, reg, data, length);
+    }
+
+    if (length <= 0 || reg + length > 256) {
+        syslog(LOG_ERR, "i2c%i: regmap_read_bytes: registers 0x%x+%d out of range", dev->busnum, reg, length);
+        return -1;
+    }
+
+    int cached = 1;
+    for (int i = reg; i < reg + length && cached; i++) {
+        cached = mraa_i2c_regmap_cacheable(map, i) && (map->state[i] & REG_VALID);
+    }
+
+    if (!cached) {
+        if (map->cache_only) {
+            syslog(LOG_ERR, "i2c%i: regmap_read_bytes: 0x%x+%d not cached in cache only mode", dev->busnum, reg, length);
+            return -1;
+        }
+
+        int ret = (length == 1) ? mraa_i2c_read_byte_data(dev, reg) : mraa_i2c_read_bytes_data(dev, reg, data, length);
+        if (ret == -1) {
+            return -1;
+        }
+        if (length == 1) {
+            data[0] = (uint8_t) ret;
+        }
+
+        for (int i = reg; i < reg + length; i++) {
+            if (mraa_i2c_regmap_cacheable(map, i) && !(map->state[i] & REG_DIRTY)) {
+                map->value[i] = data[i - reg];
+                map->state[i] |= REG_VALID;
+            }
+        }
+    }
+
+    // cached values include writes not synced yet
+    for (int i = reg; i < reg + length; i++) {
+        if (mraa_i2c_regmap_cacheable(map, i) && (map->state[i] & REG_VALID)) {
+            data[i - reg] = map->value[i];
+        }
+    }
+
+    return length;
+}
+
+int
+mraa_i2c_regmap_read(mraa_i2c_context dev, uint8_t reg)
+{
+    uint8_t value;
+
+    if (mraa_i2c_regmap_read_bytes(dev, reg, &value, 1) != 1) {
+        return -1;
+    }
+
+    return value;
+}
+
+mraa_result_t
+mraa_i2c_regmap_write(mraa_i2c_context dev, uint8_t reg, uint8_t value)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: regmap_write: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _i2c_regmap* map = mraa_i2c_regmap_get(dev);
+    if (map == NULL) {
+        return mraa_i2c_write_byte_data(dev, value, reg);
+    }
+
+    if (map->cache_only) {
+        if (!mraa_i2c_regmap_cacheable(map, reg)) {
+            syslog(LOG_ERR, "i2c%i: regmap_write: 0x%x can't be written in cache only mode", dev->busnum, reg);
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+        map->value[reg] = value;
+        map->state[reg] |= REG_VALID | REG_DIRTY;
+        return MRAA_SUCCESS;
+    }
+
+    mraa_result_t ret = mraa_i2c_write_byte_data(dev, value, reg);
+    if (ret == MRAA_SUCCESS && mraa_i2c_regmap_cacheable(map, reg)) {
+        map->value[reg] = value;
+        map->state[reg] |= REG_VALID;
+    }
+
+    return ret;
+}
+
+mraa_result_t
+mraa_i2c_regmap_update_bits(mraa_i2c_context dev, uint8_t reg, uint8_t mask, uint8_t value)
+{
+    int old = mraa_i2c_regmap_read(dev, reg);
+    if (old == -1) {
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+
+    uint8_t updated = (old & ~mask) | (value & mask);
+    if (updated == old && dev->regmap != NULL && mraa_i2c_regmap_cacheable(dev->regmap, reg)) {
+        return MRAA_SUCCESS;
+    }
+
+    return mraa_i2c_regmap_write(dev, reg, updated);
+}
+
+mraa_result_t
+mraa_i2c_regmap_cache_only(mraa_i2c_context dev, mraa_boolean_t enable)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: regmap_cache_only: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _i2c_regmap* map = mraa_i2c_regmap_get(dev);
+    if (map == NULL) {
+        syslog(LOG_ERR, "i2c%i: regmap_cache_only: no register map", dev->busnum);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    map->cache_only = enable;
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_regmap_sync(mraa_i2c_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: regmap_sync: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _i2c_regmap* map = mraa_i2c_regmap_get(dev);
+    if (map == NULL) {
+        return MRAA_SUCCESS;
+    }
+
+    if (map->cache_only) {
+        syslog(LOG_ERR, "i2c%i: regmap_sync: still in cache only mode", dev->busnum);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    // byte data only adapters get one write per register
+    int max_run = _mraa_i2c_can_write_block(dev) ? MRAA_I2C_REGMAP_MAX_RUN : 1;
+    int reg = 0;
+    while (reg < 256) {
+        if (!(map->state[reg] & REG_DIRTY)) {
+            reg++;
+            continue;
+        }
+
+        int run = 1;
+        while (reg + run < 256 && run < max_run && (map->state[reg + run] & REG_DIRTY)) {
+            run++;
+        }
+
+        mraa_result_t ret;
+        if (run == 1) {
+            ret = mraa_i2c_write_byte_data(dev, map->value[reg], reg);
+        } else {
+            uint8_t buf[MRAA_I2C_REGMAP_MAX_RUN + 1];
+            buf[0] = reg;
+            memcpy(&buf[1], &map->value[reg], run);
+            ret = mraa_i2c_write(dev, buf, run + 1);
+        }
+        if (ret != MRAA_SUCCESS) {
+            return ret;
+        }
+
+        // the plain write above forgot these, they are in sync now
+        for (int i = reg; i < reg + run; i++) {
+            map->state[i] = (map->state[i] & ~REG_DIRTY) | REG_VALID;
+        }
+        reg += run;
+    }
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_i2c_regmap_invalidate(mraa_i2c_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: regmap_invalidate: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (dev->regmap != NULL) {
+        _mraa_i2c_regmap_written(dev, 0, 256);
+    }
+
+    return MRAA_SUCCESS;
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "i2c.h"
+#include "mraa_internal.h"
+#include "i2c/i2c_sched.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct _i2c_job {
+    struct _i2c_sched* sched;
+    mraa_i2c_context dev;
+    mraa_i2c_msg_t* msgs;
+    int num_msgs;
+    mraa_i2c_prio_t prio;
+    uint64_t deadline_ns; /**< absolute CLOCK_MONOTONIC time, UINT64_MAX if none */
+    uint64_t seq;
+    unsigned int flags;
+    void (*done)(mraa_result_t result, void* args);
+    void* args;
+    mraa_result_t result;
+    mraa_boolean_t finished;
+    int refs; /**< one for the worker, one for the submitter */
+    struct _i2c_job* next;
+};
+
+/*
+ * One worker thread per bus. The queue is kept sorted by priority, then
+ * deadline, then submission order. Jobs being run sit on the running list
+ * and the job whose callback runs on finishing, so that a closing context
+ * can wait for them.
+ */
+struct _i2c_sched {
+    int busnum;
+    mraa_adv_func_t* advance_func;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct _i2c_job* queue;
+    struct _i2c_job* running;
+    struct _i2c_job* finishing;
+    uint64_t seq;
+    int users;
+    mraa_boolean_t stopping;
+    struct _i2c_sched* next;
+};
+
+static struct _i2c_sched* i2c_scheds = NULL;
+static pthread_mutex_t i2c_scheds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t
+mraa_i2c_sched_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+mraa_i2c_job_before(struct _i2c_job* a, struct _i2c_job* b)
+{
+    if (a->prio != b->prio) {
+        return a->prio < b->prio;
+    }
+    if (a->deadline_ns != b->deadline_ns) {
+        return a->deadline_ns < b->deadline_ns;
+    }
+    return a->seq < b->seq;
+}
+
+/* A plain register read, one byte register write then a read from the same slave. */
+static mraa_boolean_t
+mraa_i2c_job_is_reg_read(struct _i2c_job* job)
+{
+    return (job->flags & MRAA_I2C_REQ_COALESCE) && job->num_msgs == 2 && job->msgs[0].flags == 0 &&
+           job->msgs[0].len == 1 && job->msgs[1].flags == MRAA_I2C_MSG_RD &&
+           job->msgs[0].addr == job->msgs[1].addr;
+}
+
+/* Called with sched->lock held, drops the lock while the callback runs. */
+static void
+mraa_i2c_job_finish(struct _i2c_sched* sched, struct _i2c_job* job, mraa_result_t result)
+{
+    job->result = result;
+    if (job->done != NULL) {
+        sched->finishing = job;
+        pthread_mutex_unlock(&sched->lock);
+        job->done(result, job->args);
+        pthread_mutex_lock(&sched->lock);
+        sched->finishing = NULL;
+    }
+
+    job->finished = 1;
+    if (--job->refs == 0) {
+        free(job);
+    }
+    pthread_cond_broadcast(&sched->done);
+}
+
+/*
+ * Pull queued register reads that extend [*lo, *hi) on the same slave into the
+ * batch. Only reads of the same priority that are still in time are taken, an
+ * expired one is left for the worker to fail.
+ */
+static void
+mraa_i2c_sched_coalesce(struct _i2c_sched* sched, struct _i2c_job* first, int* lo, int* hi)
+{
+    mraa_boolean_t grown = 1;
+    struct _i2c_job* tail = first;
+    uint64_t now = mraa_i2c_sched_now();
+
+    *lo = first->msgs[0].buf[0];
+    *hi = *lo + first->msgs[1].len;
+
+    while (grown) {
+        grown = 0;
+        for (struct _i2c_job** it = &sched->queue; *it != NULL; it = &(*it)->next) {
+            struct _i2c_job* job = *it;
+            if (!mraa_i2c_job_is_reg_read(job) || job->msgs[0].addr != first->msgs[0].addr ||
+                job->prio != first->prio || (job->deadline_ns != UINT64_MAX && now > job->deadline_ns)) {
+                continue;
+            }
+
+            int reg = job->msgs[0].buf[0];
+            int len = job->msgs[1].len;
+            if ((reg != *hi && reg + len != *lo) || *hi - *lo + len > MRAA_I2C_SCHED_MAX_COALESCE) {
+                continue;
+            }
+
+            if (reg == *hi) {
+                *hi += len;
+            } else {
+                *lo = reg;
+            }
+            *it = job->next;
+            job->next = NULL;
+            tail->next = job;
+            tail = job;
+            grown = 1;
+            break;
+        }
+    }
+}
+
+static void*
+mraa_i2c_sched_worker(void* arg)
+{
+    struct _i2c_sched* sched = (struct _i2c_sched*) arg;
+
+    pthread_mutex_lock(&sched->lock);
+    for (;;) {
+        struct _i2c_job* job = sched->queue;
+
+        if (job == NULL) {
+            if (sched->stopping) {
+                break;
+            }
+            pthread_cond_wait(&sched->work, &sched->lock);
+            continue;
+        }
+        sched->queue = job->next;
+
+        if (job->deadline_ns != UINT64_MAX && mraa_i2c_sched_now() > job->deadline_ns) {
+            mraa_i2c_job_finish(sched, job, MRAA_ERROR_NO_RESOURCES);
+            continue;
+        }
+
+        job->next = NULL;
+        sched->running = job;
+
+        /* Register reads, merged or not, only move the register pointer and
+         * never touch the regmap of the context. Write jobs drop registers
+         * from it here, mraa_i2c_submit() tells users not to race them. */
+        mraa_result_t result;
+        if (mraa_i2c_job_is_reg_read(job)) {
+            int lo, hi;
+            mraa_i2c_sched_coalesce(sched, job, &lo, &hi);
+            pthread_mutex_unlock(&sched->lock);
+
+            if (sched->running->next == NULL) {
+                result = mraa_i2c_transfer(job->dev, job->msgs, job->num_msgs);
+            } else {
+                uint8_t reg = (uint8_t) lo;
+                uint8_t data[MRAA_I2C_SCHED_MAX_COALESCE];
+                mraa_i2c_msg_t m[2] = { { job->msgs[0].addr, 0, 1, &reg },
+                                        { job->msgs[0].addr, MRAA_I2C_MSG_RD, (uint16_t)(hi - lo), data } };
+
+                result = mraa_i2c_transfer(job->dev, m, 2);
+                if (result == MRAA_SUCCESS) {
+                    for (struct _i2c_job* it = sched->running; it != NULL; it = it->next) {
+                        memcpy(it->msgs[1].buf, &data[it->msgs[0].buf[0] - lo], it->msgs[1].len);
+                    }
+                }
+            }
+        } else {
+            pthread_mutex_unlock(&sched->lock);
+            result = mraa_i2c_transfer(job->dev, job->msgs, job->num_msgs);
+        }
+
+        pthread_mutex_lock(&sched->lock);
+        while (sched->running != NULL) {
+            struct _i2c_job* done = sched->running;
+            sched->running = done->next;
+            mraa_i2c_job_finish(sched, done, result);
+        }
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return NULL;
+}
+
+static struct _i2c_sched*
+mraa_i2c_sched_get(mraa_i2c_context dev)
+{
+    struct _i2c_sched* sched;
+
+    pthread_mutex_lock(&i2c_scheds_lock);
+    for (sched = i2c_scheds; sched != NULL; sched = sched->next) {
+        if (sched->busnum == dev->busnum && sched->advance_func == dev->advance_func) {
+            break;
+        }
+    }
+
+    if (sched == NULL) {
+        pthread_condattr_t attr;
+
+        sched = calloc(1, sizeof(struct _i2c_sched));
+        if (sched == NULL) {
+            syslog(LOG_CRIT, "i2c%i: submit: Failed to allocate memory for bus worker", dev->busnum);
+            pthread_mutex_unlock(&i2c_scheds_lock);
+            return NULL;
+        }
+
+        sched->busnum = dev->busnum;
+        sched->advance_func = dev->advance_func;
+        pthread_mutex_init(&sched->lock, NULL);
+        pthread_cond_init(&sched->work, NULL);
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&sched->done, &attr);
+        pthread_condattr_destroy(&attr);
+
+        if (pthread_create(&sched->thread, NULL, mraa_i2c_sched_worker, sched) != 0) {
+            syslog(LOG_ERR, "i2c%i: submit: Failed to start bus worker", dev->busnum);
+            pthread_cond_destroy(&sched->work);
+            pthread_cond_destroy(&sched->done);
+            pthread_mutex_destroy(&sched->lock);
+            free(sched);
+            pthread_mutex_unlock(&i2c_scheds_lock);
+            return NULL;
+        }
+
+        sched->next = i2c_scheds;
+        i2c_scheds = sched;
+    }
+
+    if (dev->sched != sched) {
+        sched->users++;
+        dev->sched = sched;
+    }
+    pthread_mutex_unlock(&i2c_scheds_lock);
+
+    return sched;
+}
+
+static mraa_boolean_t
+mraa_i2c_sched_busy(struct _i2c_sched* sched, mraa_i2c_context dev)
+{
+    for (struct _i2c_job* it = sched->queue; it != NULL; it = it->next) {
+        if (it->dev == dev) {
+            return 1;
+        }
+    }
+    for (struct _i2c_job* it = sched->running; it != NULL; it = it->next) {
+        if (it->dev == dev) {
+            return 1;
+        }
+    }
+    if (sched->finishing != NULL && sched->finishing->dev == dev) {
+        return 1;
+    }
+
+    return 0;
+}
+
+void
+_mraa_i2c_sched_release(mraa_i2c_context dev)
+{
+    struct _i2c_sched* sched = dev->sched;
+
+    if (sched == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&sched->lock);
+    while (mraa_i2c_sched_busy(sched, dev)) {
+        pthread_cond_wait(&sched->done, &sched->lock);
+    }
+    pthread_mutex_unlock(&sched->lock);
+    dev->sched = NULL;
+
+    pthread_mutex_lock(&i2c_scheds_lock);
+    if (--sched->users > 0) {
+        pthread_mutex_unlock(&i2c_scheds_lock);
+        return;
+    }
+
+    for (struct _i2c_sched** it = &i2c_scheds; *it != NULL; it = &(*it)->next) {
+        if (*it == sched) {
+            *it = sched->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&i2c_scheds_lock);
+
+    pthread_mutex_lock(&sched->lock);
+    sched->stopping = 1;
+    pthread_cond_signal(&sched->work);
+    pthread_mutex_unlock(&sched->lock);
+    pthread_join(sched->thread, NULL);
+
+    pthread_cond_destroy(&sched->work);
+    pthread_cond_destroy(&sched->done);
+    pthread_mutex_destroy(&sched->lock);
+    free(sched);
+}
+
+mraa_i2c_job
+mraa_i2c_submit(mraa_i2c_context dev, const mraa_i2c_request_t* req)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "i2c: submit: context is invalid");
+        return NULL;
+    }
+
+    if (req == NULL || req->msgs == NULL || req->num_msgs <= 0 || req->num_msgs > MRAA_I2C_TRANSFER_MAX_MSGS) {
+        syslog(LOG_ERR, "i2c%i: submit: need 1 to %d messages", dev->busnum, MRAA_I2C_TRANSFER_MAX_MSGS);
+        return NULL;
+    }
+
+    struct _i2c_sched* sched = mraa_i2c_sched_get(dev);
+    if (sched == NULL) {
+        return NULL;
+    }
+
+    struct _i2c_job* job = calloc(1, sizeof(struct _i2c_job));
+    if (job == NULL) {
+        syslog(LOG_CRIT, "i2c%i: submit: Failed to allocate memory for job", dev->busnum);
+        return NULL;
+    }
+
+    job->sched = sched;
+    job->dev = dev;
+    job->msgs = req->msgs;
+    job->num_msgs = req->num_msgs;
+    job->prio = req->prio;
+    job->deadline_ns = req->deadline_us ? mraa_i2c_sched_now() + (uint64_t) req->deadline_us * 1000 : UINT64_MAX;
+    job->flags = req->flags;
+    job->done = req->done;
+    job->args = req->args;
+    job->refs = 2;
+
+    pthread_mutex_lock(&sched->lock);
+    job->seq = sched->seq++;
+
+    struct _i2c_job** it = &sched->queue;
+    while (*it != NULL && !mraa_i2c_job_before(job, *it)) {
+        it = &(*it)->next;
+    }
+    job->next = *it;
+    *it = job;
+
+    pthread_cond_signal(&sched->work);
+    pthread_mutex_unlock(&sched->lock);
+
+    return job;
+}
+
+mraa_result_t
+mraa_i2c_job_wait(mraa_i2c_job job, int timeout_ms)
+{
+    if (job == NULL) {
+        syslog(LOG_ERR, "i2c: job_wait: job is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _i2c_sched* sched = job->sched;
+    struct timespec until;
+
+    if (timeout_ms >= 0) {
+        uint64_t ns = mraa_i2c_sched_now() + (uint64_t) timeout_ms * 1000000;
+        until.tv_sec = ns / 1000000000ULL;
+        until.tv_nsec = ns % 1000000000ULL;
+    }
+
+    pthread_mutex_lock(&sched->lock);
+    while (!job->finished) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&sched->done, &sched->lock);
+        } else if (pthread_cond_timedwait(&sched->done, &sched->lock, &until) != 0 && !job->finished) {
+            pthread_mutex_unlock(&sched->lock);
+            return MRAA_ERROR_NO_DATA_AVAILABLE;
+        }
+    }
+
+    mraa_result_t result = job->result;
+    if (--job->refs == 0) {
+        free(job);
+    }
+    pthread_mutex_unlock(&sched->lock);
+
+    return result;
+}
+
+void
+mraa_i2c_job_release(mraa_i2c_job job)
+{
+    if (job == NULL) {
+        return;
+    }
+
+    struct _i2c_sched* sched = job->sched;
+
+    pthread_mutex_lock(&sched->lock);
+    if (--job->refs == 0) {
+        free(job);
+    }
+    pthread_mutex_unlock(&sched->lock);
+}
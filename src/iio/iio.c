@@ -25,6 +25,7 @@
 #include "iio.h"
 #include "mraa_internal.h"
 #include "dirent.h"
+#include <errno.h>
 #include <string.h>
 #include <poll.h>
 #if defined(MSYS)
@@ -296,20 +297,47 @@ mraa_iio_write_string(mraa_iio_context dev, const char* attr_name, const char* d
 }
 
 static mraa_result_t
-mraa_iio_wait_event(int fd, char* data, int* read_size)
+mraa_iio_wait_event(int fd,
+                    char* data,
+                    int* read_size
+#ifndef HAVE_PTHREAD_CANCEL
+                    ,
+                    int control_fd
+#endif
+)
 {
-    struct pollfd pfd;
+#ifdef HAVE_PTHREAD_CANCEL
+    struct pollfd pfd[1];
+#else
+    struct pollfd pfd[2];
+
+    if (control_fd < 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+#endif
 
     if (fd < 0) {
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    pfd.fd = fd;
-    pfd.events = POLLIN;
+    pfd[0].fd = fd;
+    pfd[0].events = POLLIN;
 
+#ifdef HAVE_PTHREAD_CANCEL
     // Wait for it forever or until pthread_cancel
     // poll is a cancelable point like sleep()
-    poll(&pfd, 1, -1);
+    poll(pfd, 1, -1);
+#else
+    // setup poll on the controling fd
+    pfd[1].fd = control_fd;
+    pfd[1].events = 0; //  POLLHUP, POLLERR, and POLLNVAL
+
+    // Wait for it forever or until control fd is closed
+    poll(pfd, 2, -1);
+    if (pfd[1].revents) {
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+#endif
 
     memset(data, 0, 100);
     *read_size = read(fd, data, 100);
@@ -326,7 +354,12 @@ mraa_iio_trigger_handler(void* arg)
     int read_size;
 
     for (;;) {
-        if (mraa_iio_wait_event(dev->fp, &data[0], &read_size) == MRAA_SUCCESS) {
+        if (mraa_iio_wait_event(dev->fp, &data[0], &read_size
+#ifndef HAVE_PTHREAD_CANCEL
+                                ,
+                                dev->isr_control_pipe[0]
+#endif
+                                ) == MRAA_SUCCESS) {
 #ifdef HAVE_PTHREAD_CANCEL
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 #endif
@@ -361,6 +394,14 @@ mraa_iio_trigger_buffer(mraa_iio_context dev, void (*fptr)(char*, void*), void*
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
+#ifndef HAVE_PTHREAD_CANCEL
+    if (pipe(dev->isr_control_pipe)) {
+        syslog(LOG_ERR, "iio: trigger_buffer: failed to create isr control pipe: %s", strerror(errno));
+        close(dev->fp);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+#endif
+
     dev->isr = fptr;
     dev->isr_args = args;
     pthread_create(&dev->thread_id, NULL, mraa_iio_trigger_handler, (void*) dev);
@@ -426,20 +467,46 @@ mraa_iio_get_event_data(mraa_iio_context dev)
 }
 
 static mraa_result_t
-mraa_iio_event_poll_nonblock(int fd, struct iio_event_data* data)
+mraa_iio_event_poll_nonblock(int fd,
+                             struct iio_event_data* data
+#ifndef HAVE_PTHREAD_CANCEL
+                             ,
+                             int control_fd
+#endif
+)
 {
-    struct pollfd pfd;
+#ifdef HAVE_PTHREAD_CANCEL
+    struct pollfd pfd[1];
+#else
+    struct pollfd pfd[2];
+
+    if (control_fd < 0) {
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+#endif
 
     if (fd < 0) {
         return MRAA_ERROR_INVALID_RESOURCE;
     }
 
-    pfd.fd = fd;
-    pfd.events = POLLIN;
+    pfd[0].fd = fd;
+    pfd[0].events = POLLIN;
 
+#ifdef HAVE_PTHREAD_CANCEL
     // Wait for it forever or until pthread_cancel
     // poll is a cancelable point like sleep()
-    poll(&pfd, 1, -1);
+    poll(pfd, 1, -1);
+#else
+    // setup poll on the controling fd
+    pfd[1].fd = control_fd;
+    pfd[1].events = 0; //  POLLHUP, POLLERR, and POLLNVAL
+
+    // Wait for it forever or until control fd is closed
+    poll(pfd, 2, -1);
+    if (pfd[1].revents) {
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+#endif
 
     read(fd, data, sizeof(struct iio_event_data));
 
@@ -479,7 +546,12 @@ mraa_iio_event_handler(void* arg)
     mraa_iio_context dev = (mraa_iio_context) arg;
 
     for (;;) {
-        if (mraa_iio_event_poll_nonblock(dev->fp_event, &data) == MRAA_SUCCESS) {
+        if (mraa_iio_event_poll_nonblock(dev->fp_event, &data
+#ifndef HAVE_PTHREAD_CANCEL
+                                         ,
+                                         dev->isr_control_pipe[0]
+#endif
+                                         ) == MRAA_SUCCESS) {
 #ifdef HAVE_PTHREAD_CANCEL
             pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 #endif
@@ -518,6 +590,14 @@ mraa_iio_event_setup_callback(mraa_iio_context dev, void (*fptr)(struct iio_even
         return MRAA_ERROR_UNSPECIFIED;
     }
 
+#ifndef HAVE_PTHREAD_CANCEL
+    if (pipe(dev->isr_control_pipe)) {
+        syslog(LOG_ERR, "iio: event_setup_callback: failed to create isr control pipe: %s", strerror(errno));
+        close(dev->fp_event);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+#endif
+
     dev->isr_event = fptr;
     dev->isr_args = args;
     pthread_create(&dev->thread_id, NULL, mraa_iio_event_handler, (void*) dev);
@@ -654,6 +734,31 @@ mraa_iio_update_channels(mraa_iio_context dev)
 mraa_result_t
 mraa_iio_close(mraa_iio_context dev)
 {
+    // stop the trigger or event thread so that its callback can't outlive us
+    if (dev->thread_id != 0) {
+#ifdef HAVE_PTHREAD_CANCEL
+        if (pthread_cancel(dev->thread_id) == 0) {
+            pthread_join(dev->thread_id, NULL);
+        }
+#else
+        // closing the write end wakes the handler's poll, the fds it polls
+        // stay open until it has returned
+        close(dev->isr_control_pipe[1]);
+        pthread_join(dev->thread_id, NULL);
+        close(dev->isr_control_pipe[0]);
+        dev->isr_control_pipe[0] = dev->isr_control_pipe[1] = -1;
+#endif
+        if (dev->isr_event != NULL) {
+            close(dev->fp_event);
+        } else {
+            close(dev->fp);
+        }
+        dev->thread_id = 0;
+        dev->isr = NULL;
+        dev->isr_event = NULL;
+        dev->isr_args = NULL;
+    }
     free(dev->channels);
+    dev->channels = NULL;
     return MRAA_SUCCESS;
 }
@@ -133,6 +133,16 @@ class Spi;
 
 %include ../mraa.i
 
+%{
+    #include "iio.hpp"
+%}
+
+%ignore Iio(void* iio_context);
+%ignore Iio::registerEventHandler(IioHandler* handler) const;
+%ignore IioHandler;
+
+%include "iio.hpp"
+
 %init %{
     //Adding mraa_init() to the module initialisation process
     if (mraa_init() != MRAA_SUCCESS) {
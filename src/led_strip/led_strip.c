@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "led_strip.h"
+#include "mraa_internal.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WS2812_SPI_HZ 2400000
+#define SK6812_SPI_HZ 3200000
+/* low time that latches the one wire strips, 300us covers newer WS2812B */
+#define LED_STRIP_RESET_US 300
+#define APA102_START_FRAME 4
+
+/*
+ * One wire strips see a spi bit as a slice of their bit period. WS2812 bits
+ * are 110 for one and 100 for zero at 2.4MHz, SK6812 bits 1100 and 1000 at
+ * 3.2MHz, so a colour byte becomes 3 or 4 spi bytes looked up whole.
+ */
+static uint8_t ws2812_table[256][3];
+static uint8_t sk6812_table[256][4];
+static pthread_once_t led_strip_tables_once = PTHREAD_ONCE_INIT;
+
+struct _led_strip {
+    mraa_spi_context spi;
+    mraa_led_strip_type_t type;
+    unsigned int num_pixels;
+    float gamma;
+    uint8_t brightness;
+    uint8_t level[256]; /**< gamma and brightness applied to a channel value */
+    uint8_t* buf;
+    int buf_len;
+    int data_offset;    /**< where pixel data starts in buf */
+};
+
+static void
+mraa_led_strip_build_tables()
+{
+    for (int v = 0; v < 256; v++) {
+        uint32_t ws = 0, sk = 0;
+        for (int bit = 7; bit >= 0; bit--) {
+            int one = (v >> bit) & 1;
+            ws = (ws << 3) | (one ? 0x6 : 0x4);
+            sk = (sk << 4) | (one ? 0xC : 0x8);
+        }
+        ws2812_table[v][0] = ws >> 16;
+        ws2812_table[v][1] = ws >> 8;
+        ws2812_table[v][2] = ws;
+        sk6812_table[v][0] = sk >> 24;
+        sk6812_table[v][1] = sk >> 16;
+        sk6812_table[v][2] = sk >> 8;
+        sk6812_table[v][3] = sk;
+    }
+}
+
+static void
+mraa_led_strip_build_levels(mraa_led_strip_context dev)
+{
+    for (int v = 0; v < 256; v++) {
+        double corrected = dev->gamma == 1.0f ? v : 255.0 * pow(v / 255.0, dev->gamma);
+        dev->level[v] = (uint8_t) (corrected * dev->brightness / 255.0 + 0.5);
+    }
+}
+
+mraa_led_strip_context
+mraa_led_strip_init(mraa_spi_context spi, mraa_led_strip_type_t type, unsigned int num_pixels)
+{
+    if (spi == NULL) {
+        syslog(LOG_ERR, "led_strip: init: spi context is invalid");
+        return NULL;
+    }
+
+    if (num_pixels == 0 || num_pixels > 65536 || type > MRAA_LED_STRIP_APA102) {
+        syslog(LOG_ERR, "led_strip: init: invalid strip type or length");
+        return NULL;
+    }
+
+    mraa_led_strip_context dev = calloc(1, sizeof(struct _led_strip));
+    if (dev == NULL) {
+        syslog(LOG_CRIT, "led_strip: Failed to allocate memory for context");
+        return NULL;
+    }
+
+    pthread_once(&led_strip_tables_once, mraa_led_strip_build_tables);
+
+    dev->spi = spi;
+    dev->type = type;
+    dev->num_pixels = num_pixels;
+    dev->gamma = 1.0f;
+    dev->brightness = 255;
+    mraa_led_strip_build_levels(dev);
+
+    // the one wire strips get a leading zero byte, as MOSI may idle high,
+    // and a trailing low period that latches the frame
+    int hz = 0;
+    switch (type) {
+        case MRAA_LED_STRIP_WS2812:
+            hz = WS2812_SPI_HZ;
+            dev->data_offset = 1;
+            dev->buf_len = 1 + num_pixels * 3 * 3 + WS2812_SPI_HZ / 8 / (1000000 / LED_STRIP_RESET_US);
+            break;
+        case MRAA_LED_STRIP_SK6812:
+            hz = SK6812_SPI_HZ;
+            dev->data_offset = 1;
+            dev->buf_len = 1 + num_pixels * 4 * 4 + SK6812_SPI_HZ / 8 / (1000000 / LED_STRIP_RESET_US);
+            break;
+        case MRAA_LED_STRIP_APA102:
+            // the end frame has to supply a clock edge for every two pixels
+            dev->data_offset = APA102_START_FRAME;
+            dev->buf_len = APA102_START_FRAME + num_pixels * 4 + (num_pixels + 15) / 16 + 4;
+            break;
+    }
+
+    // a split transfer leaves MOSI low between messages, which the one wire
+    // strips take as a latch, so the frame has to go out as one message
+    if (hz != 0 && spi->bufsiz > 0 && dev->buf_len > spi->bufsiz) {
+        syslog(LOG_ERR, "led_strip: init: %d byte frame exceeds the spidev bufsiz of %d, raise spidev.bufsiz",
+               dev->buf_len, spi->bufsiz);
+        free(dev);
+        return NULL;
+    }
+
+    dev->buf = calloc(dev->buf_len, 1);
+    if (dev->buf == NULL) {
+        syslog(LOG_CRIT, "led_strip: Failed to allocate memory for %d byte frame", dev->buf_len);
+        free(dev);
+        return NULL;
+    }
+    if (type == MRAA_LED_STRIP_APA102) {
+        memset(dev->buf + dev->buf_len - (num_pixels + 15) / 16 - 4, 0xFF, (num_pixels + 15) / 16 + 4);
+    }
+
+    if (mraa_spi_mode(spi, MRAA_SPI_MODE0) != MRAA_SUCCESS || mraa_spi_lsbmode(spi, 0) != MRAA_SUCCESS ||
+        mraa_spi_bit_per_word(spi, 8) != MRAA_SUCCESS || (hz != 0 && mraa_spi_frequency(spi, hz) != MRAA_SUCCESS)) {
+        syslog(LOG_ERR, "led_strip: init: Failed to configure spi");
+        free(dev->buf);
+        free(dev);
+        return NULL;
+    }
+
+    return dev;
+}
+
+mraa_result_t
+mraa_led_strip_gamma(mraa_led_strip_context dev, float gamma)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "led_strip: gamma: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (!(gamma > 0.0f)) {
+        syslog(LOG_ERR, "led_strip: gamma: has to be greater than 0");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    dev->gamma = gamma;
+    mraa_led_strip_build_levels(dev);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_led_strip_brightness(mraa_led_strip_context dev, uint8_t brightness)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "led_strip: brightness: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    dev->brightness = brightness;
+    mraa_led_strip_build_levels(dev);
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_led_strip_show(mraa_led_strip_context dev, const uint8_t* pixels, int length, mraa_led_strip_format_t format)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "led_strip: show: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    // offsets of red, green, blue and white in an input pixel, -1 if absent
+    int r, g, b, w, size;
+    switch (format) {
+        case MRAA_LED_STRIP_RGB:
+            r = 0, g = 1, b = 2, w = -1, size = 3;
+            break;
+        case MRAA_LED_STRIP_GRB:
+            g = 0, r = 1, b = 2, w = -1, size = 3;
+            break;
+        case MRAA_LED_STRIP_RGBW:
+            r = 0, g = 1, b = 2, w = 3, size = 4;
+            break;
+        default:
+            syslog(LOG_ERR, "led_strip: show: invalid pixel format %d", format);
+            return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    if (pixels == NULL || length != (int) dev->num_pixels * size) {
+        syslog(LOG_ERR, "led_strip: show: expected %d bytes of pixels", dev->num_pixels * size);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    const uint8_t* level = dev->level;
+    const uint8_t* in = pixels;
+    const uint8_t* end = pixels + length;
+    uint8_t* out = dev->buf + dev->data_offset;
+
+    switch (dev->type) {
+        case MRAA_LED_STRIP_WS2812:
+            for (; in < end; in += size) {
+                memcpy(out, ws2812_table[level[in[g]]], 3);
+                memcpy(out + 3, ws2812_table[level[in[r]]], 3);
+                memcpy(out + 6, ws2812_table[level[in[b]]], 3);
+                out += 9;
+            }
+            break;
+        case MRAA_LED_STRIP_SK6812:
+            for (; in < end; in += size) {
+                memcpy(out, sk6812_table[level[in[g]]], 4);
+                memcpy(out + 4, sk6812_table[level[in[r]]], 4);
+                memcpy(out + 8, sk6812_table[level[in[b]]], 4);
+                memcpy(out + 12, sk6812_table[w < 0 ? 0 : level[in[w]]], 4);
+                out += 16;
+            }
+            break;
+        case MRAA_LED_STRIP_APA102:
+            // full global brightness, dimming is done in the 8 bit channels
+            for (; in < end; in += size) {
+                out[0] = 0xFF;
+                out[1] = level[in[b]];
+                out[2] = level[in[g]];
+                out[3] = level[in[r]];
+                out += 4;
+            }
+            break;
+    }
+
+    return mraa_spi_transfer_buf(dev->spi, dev->buf, NULL, dev->buf_len);
+}
+
+mraa_result_t
+mraa_led_strip_close(mraa_led_strip_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "led_strip: close: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    free(dev->buf);
+    free(dev);
+    return MRAA_SUCCESS;
+}
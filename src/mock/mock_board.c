@@ -125,6 +125,7 @@ mraa_mock_board()
     b->adv_func->spi_write_word_replace = &mraa_mock_spi_write_word_replace;
     b->adv_func->spi_transfer_buf_replace = &mraa_mock_spi_transfer_buf_replace;
     b->adv_func->spi_transfer_buf_word_replace = &mraa_mock_spi_transfer_buf_word_replace;
+    b->adv_func->spi_transfer_multi_replace = &mraa_mock_spi_transfer_multi_replace;
     b->adv_func->uart_init_raw_replace = &mraa_mock_uart_init_raw_replace;
     b->adv_func->uart_set_baudrate_replace = &mraa_mock_uart_set_baudrate_replace;
     b->adv_func->uart_flush_replace = &mraa_mock_uart_flush_replace;
@@ -57,6 +57,7 @@ mraa_mock_spi_init_raw_replace(mraa_spi_context dev, unsigned int bus, unsigned
 mraa_result_t
 mraa_mock_spi_stop_replace(mraa_spi_context dev)
 {
+    free(dev->mock_last_tx);
     free(dev);
     return MRAA_SUCCESS;
 }
@@ -76,7 +77,10 @@ mraa_mock_spi_bit_per_word_replace(mraa_spi_context dev, unsigned int bits)
 mraa_result_t
 mraa_mock_spi_lsbmode_replace(mraa_spi_context dev, mraa_boolean_t lsb)
 {
+    // the mock controller only shifts msb first, like many real ones, so
+    // lsb first goes through the software bit reversal
     dev->lsb = lsb;
+    dev->soft_lsb = lsb;
     return MRAA_SUCCESS;
 }
 
@@ -144,6 +148,14 @@ mraa_mock_spi_transfer_buf_replace(mraa_spi_context dev, uint8_t* data, uint8_t*
         return MRAA_ERROR_INVALID_PARAMETER;
     }
 
+    // there is no wire to look at, keep what was sent for the unit tests
+    uint8_t* last_tx = realloc(dev->mock_last_tx, length);
+    if (last_tx != NULL) {
+        memcpy(last_tx, data, length);
+        dev->mock_last_tx = last_tx;
+        dev->mock_last_tx_len = length;
+    }
+
     if (rxbuf != NULL) {
         int i;
         for (i = 0; i < length; ++i) {
@@ -177,3 +189,23 @@ mraa_mock_spi_transfer_buf_word_replace(mraa_spi_context dev, uint16_t* data, ui
 
     return MRAA_SUCCESS;
 }
+
+mraa_result_t
+mraa_mock_spi_transfer_multi_replace(mraa_spi_context dev, mraa_spi_segment_t* segments, int num_segments)
+{
+    int i;
+    uint32_t j;
+
+    // each segment answers like transfer_buf, absent tx bytes count as zeros
+    for (i = 0; i < num_segments; ++i) {
+        if (segments[i].rx_buf == NULL) {
+            continue;
+        }
+        for (j = 0; j < segments[i].len; ++j) {
+            uint8_t tx = segments[i].tx_buf != NULL ? segments[i].tx_buf[j] : 0;
+            segments[i].rx_buf[j] = tx ^ MOCK_SPI_REPLY_DATA_MODIFIER_BYTE;
+        }
+    }
+
+    return MRAA_SUCCESS;
+}
@@ -44,6 +44,7 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <ctype.h>
 #include <limits.h>
 #include <sys/utsname.h>
@@ -59,6 +60,7 @@
 #include "grovepi/grovepi.h"
 #include "gpio.h"
 #include "gpio/gpio_chardev.h"
+#include "gpio/gpio_dispatcher.h"
 #include "version.h"
 #include "i2c.h"
 #include "pwm.h"
@@ -243,6 +245,8 @@ imraa_init()
         return MRAA_ERROR_NO_RESOURCES;
     }
 
+    mraa_mux_pins_build();
+
     plat->chardev_capable = mraa_is_platform_chardev_interface_capable();
     if (plat->chardev_capable) {
         syslog(LOG_NOTICE, "gpio: support for chardev interface is activated");
@@ -269,6 +273,13 @@ mraa_init()
 void
 mraa_deinit()
 {
+    /* Stops the shared isr event loops, including any isr still left on them. */
+    mraa_gpio_dispatcher_shutdown();
+
+    /* Mux gpios stay exported, same as before they were cached. */
+    mraa_mux_cache_clear();
+    mraa_mux_pins_free();
+
     if (plat != NULL) {
         if (plat->pins != NULL) {
             free(plat->pins);
@@ -396,155 +407,357 @@ mraa_iio_detect()
     return MRAA_SUCCESS;
 }
 
-mraa_result_t
-mraa_setup_mux_mapped(mraa_pin_t meta)
+/*
+ * Mux gpios are shared by many pins, so instead of exporting, programming and
+ * unexporting them on every init their contexts are kept open here together
+ * with the last state applied, and commands that would not change anything
+ * are skipped. A state of -1 means unknown.
+ *
+ * The cache assumes this process is the only owner of the mux gpios: changes
+ * made through mraa contexts in this process invalidate it, but another
+ * process (or a shell) writing the same gpios leaves it stale, and the next
+ * init skips reprogramming a mux it believes is already set.
+ */
+typedef struct _mux_cache_entry {
+    int pin;
+    mraa_gpio_context ctx;
+    int dir;
+    int value;
+    int mode;
+    struct _mux_cache_entry* next;
+} mraa_mux_cache_entry_t;
+
+static mraa_mux_cache_entry_t* mux_cache = NULL;
+static pthread_mutex_t mux_cache_lock;
+static pthread_once_t mux_cache_once = PTHREAD_ONCE_INIT;
+
+static void
+mraa_mux_cache_lock_init()
+{
+    pthread_mutexattr_t attr;
+
+    /* Platform hooks run from the mux setup may change other mux gpios. */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mux_cache_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static mraa_boolean_t
+mraa_pin_has_mux(mraa_pin_t* meta, int pin)
 {
     unsigned int mi;
-    mraa_result_t ret;
-    mraa_gpio_context mux_i = NULL;
-    // avoids the unsigned comparison and we should never have a pin that is UINT_MAX!
-    unsigned int last_pin = UINT_MAX;
-
-    for (mi = 0; mi < meta.mux_total; mi++) {
-
-        switch(meta.mux[mi].pincmd) {
-            case PINCMD_UNDEFINED:              // used for backward compatibility
-                if(meta.mux[mi].pin != last_pin) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-                    if (mux_i == NULL) return MRAA_ERROR_INVALID_HANDLE;
-                    last_pin = meta.mux[mi].pin;
-                }
-                // this function will sometimes fail, however this is not critical as
-                // long as the write succeeds - Test case galileo gen2 pin2
-                mraa_gpio_dir(mux_i, MRAA_GPIO_OUT);
-                ret = mraa_gpio_write(mux_i, meta.mux[mi].value);
-                if(ret != MRAA_SUCCESS) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    return MRAA_ERROR_INVALID_RESOURCE;
-                }
-                break;
 
-            case PINCMD_SET_VALUE:
-                if(meta.mux[mi].pin != last_pin) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-                    if (mux_i == NULL) return MRAA_ERROR_INVALID_HANDLE;
-                    last_pin = meta.mux[mi].pin;
-                }
+    for (mi = 0; mi < meta->mux_total; mi++) {
+        if (meta->mux[mi].pincmd != PINCMD_SKIP && meta->mux[mi].pin == (unsigned int) pin) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-                ret = mraa_gpio_write(mux_i, meta.mux[mi].value);
+static mraa_boolean_t
+mraa_scan_mux_pin(int pin)
+{
+    int i;
 
-                if(ret != MRAA_SUCCESS) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    return MRAA_ERROR_INVALID_RESOURCE;
-                }
-                break;
+    if (plat == NULL || plat->pins == NULL) {
+        return 0;
+    }
 
-            case PINCMD_SET_DIRECTION:
-                if(meta.mux[mi].pin != last_pin) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-                    if (mux_i == NULL) return MRAA_ERROR_INVALID_HANDLE;
-                    last_pin = meta.mux[mi].pin;
-                }
+    for (i = 0; i < plat->phy_pin_count; i++) {
+        mraa_pininfo_t* p = &plat->pins[i];
+        if (mraa_pin_has_mux(&p->gpio, pin) || mraa_pin_has_mux(&p->pwm, pin) ||
+            mraa_pin_has_mux(&p->aio, pin) || mraa_pin_has_mux(&p->mmap.gpio, pin) ||
+            mraa_pin_has_mux(&p->i2c, pin) || mraa_pin_has_mux(&p->spi, pin) ||
+            mraa_pin_has_mux(&p->uart, pin)) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-                ret = mraa_gpio_dir(mux_i, meta.mux[mi].value);
+/* Sorted raw gpios used by any mux program, built once the platform is set up. */
+static int* mux_pins = NULL;
+static int mux_pins_count = -1;
 
-                if(ret != MRAA_SUCCESS) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    return MRAA_ERROR_INVALID_RESOURCE;
-                }
-                break;
+static int
+mraa_int_compare(const void* a, const void* b)
+{
+    int x = *(const int*) a, y = *(const int*) b;
+    return (x > y) - (x < y);
+}
 
-            case PINCMD_SET_IN_VALUE:
-                if(meta.mux[mi].pin != last_pin) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-                    if (mux_i == NULL) return MRAA_ERROR_INVALID_HANDLE;
-                    last_pin = meta.mux[mi].pin;
-                }
+static void
+mraa_add_mux_pins(mraa_pin_t* meta, int* pins, int* count)
+{
+    for (unsigned int mi = 0; mi < meta->mux_total; mi++) {
+        if (meta->mux[mi].pincmd != PINCMD_SKIP) {
+            pins[(*count)++] = meta->mux[mi].pin;
+        }
+    }
+}
 
-                ret = mraa_gpio_dir(mux_i, MRAA_GPIO_IN);
+void
+mraa_mux_pins_build()
+{
+    int total = 0, count = 0;
 
-                if(ret == MRAA_SUCCESS)
-                    ret = mraa_gpio_write(mux_i, meta.mux[mi].value);
+    if (plat == NULL || plat->pins == NULL) {
+        return;
+    }
 
-                if(ret != MRAA_SUCCESS) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    return MRAA_ERROR_INVALID_RESOURCE;
-                }
-                break;
+    for (int i = 0; i < plat->phy_pin_count; i++) {
+        mraa_pininfo_t* p = &plat->pins[i];
+        total += p->gpio.mux_total + p->pwm.mux_total + p->aio.mux_total + p->mmap.gpio.mux_total +
+                 p->i2c.mux_total + p->spi.mux_total + p->uart.mux_total;
+    }
 
-            case PINCMD_SET_OUT_VALUE:
-                if(meta.mux[mi].pin != last_pin) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-                    if (mux_i == NULL) return MRAA_ERROR_INVALID_HANDLE;
-                    last_pin = meta.mux[mi].pin;
-                }
+    if (total > 0) {
+        mux_pins = malloc(total * sizeof(int));
+        if (mux_pins == NULL) {
+            /* mraa_is_mux_pin() keeps scanning the pin table. */
+            return;
+        }
+    }
 
-                ret = mraa_gpio_dir(mux_i, MRAA_GPIO_OUT);
+    for (int i = 0; i < plat->phy_pin_count; i++) {
+        mraa_pininfo_t* p = &plat->pins[i];
+        mraa_add_mux_pins(&p->gpio, mux_pins, &count);
+        mraa_add_mux_pins(&p->pwm, mux_pins, &count);
+        mraa_add_mux_pins(&p->aio, mux_pins, &count);
+        mraa_add_mux_pins(&p->mmap.gpio, mux_pins, &count);
+        mraa_add_mux_pins(&p->i2c, mux_pins, &count);
+        mraa_add_mux_pins(&p->spi, mux_pins, &count);
+        mraa_add_mux_pins(&p->uart, mux_pins, &count);
+    }
 
-                if(ret == MRAA_SUCCESS)
-                    ret = mraa_gpio_write(mux_i, meta.mux[mi].value);
+    qsort(mux_pins, count, sizeof(int), mraa_int_compare);
+    mux_pins_count = count;
+}
 
-                if(ret != MRAA_SUCCESS) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    return MRAA_ERROR_INVALID_RESOURCE;
+void
+mraa_mux_pins_free()
+{
+    free(mux_pins);
+    mux_pins = NULL;
+    mux_pins_count = -1;
+}
+
+mraa_boolean_t
+mraa_is_mux_pin(int pin)
+{
+    /* Gpios opened by the platform setup itself come before the set exists. */
+    if (mux_pins_count < 0) {
+        return mraa_scan_mux_pin(pin);
+    }
+
+    return mux_pins_count > 0 && bsearch(&pin, mux_pins, mux_pins_count, sizeof(int), mraa_int_compare) != NULL;
+}
+
+static void
+mraa_mux_cache_forget(mraa_mux_cache_entry_t* entry)
+{
+    entry->dir = entry->value = entry->mode = -1;
+}
+
+static void
+mraa_mux_cache_drop(mraa_mux_cache_entry_t* entry)
+{
+    if (entry->ctx != NULL) {
+        mraa_gpio_owner(entry->ctx, 0);
+        mraa_gpio_close(entry->ctx);
+        entry->ctx = NULL;
+    }
+    mraa_mux_cache_forget(entry);
+}
+
+static mraa_mux_cache_entry_t*
+mraa_mux_cache_get(int pin)
+{
+    mraa_mux_cache_entry_t* entry;
+
+    for (entry = mux_cache; entry != NULL; entry = entry->next) {
+        if (entry->pin == pin) {
+            break;
+        }
+    }
+
+    if (entry == NULL) {
+        entry = calloc(1, sizeof(mraa_mux_cache_entry_t));
+        if (entry == NULL) {
+            syslog(LOG_CRIT, "mraa: Failed to allocate memory for mux cache");
+            return NULL;
+        }
+        entry->pin = pin;
+        mraa_mux_cache_forget(entry);
+        entry->next = mux_cache;
+        mux_cache = entry;
+    }
+
+    if (entry->ctx == NULL) {
+        entry->ctx = mraa_gpio_init_raw(pin);
+        if (entry->ctx == NULL) {
+            return NULL;
+        }
+        /* Our own changes are tracked, don't invalidate on them. */
+        entry->ctx->mux_pin = 0;
+    }
+
+    return entry;
+}
+
+void
+mraa_mux_cache_invalidate(int pin)
+{
+    mraa_mux_cache_entry_t* entry;
+
+    pthread_once(&mux_cache_once, mraa_mux_cache_lock_init);
+    pthread_mutex_lock(&mux_cache_lock);
+    for (entry = mux_cache; entry != NULL; entry = entry->next) {
+        if (entry->pin == pin) {
+            mraa_mux_cache_forget(entry);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mux_cache_lock);
+}
+
+void
+mraa_mux_cache_clear()
+{
+    mraa_mux_cache_entry_t* entry;
+
+    pthread_once(&mux_cache_once, mraa_mux_cache_lock_init);
+    pthread_mutex_lock(&mux_cache_lock);
+    while (mux_cache != NULL) {
+        entry = mux_cache;
+        mux_cache = entry->next;
+        mraa_mux_cache_drop(entry);
+        free(entry);
+    }
+    pthread_mutex_unlock(&mux_cache_lock);
+}
+
+/* Single owner, see the cache above: skipped commands are not re-checked. */
+static mraa_result_t
+mraa_mux_apply(mraa_mux_t* mux)
+{
+    mraa_mux_cache_entry_t* entry;
+    mraa_result_t ret = MRAA_SUCCESS;
+    int value = mux->value;
+
+    entry = mraa_mux_cache_get(mux->pin);
+    if (entry == NULL) {
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    switch (mux->pincmd) {
+        case PINCMD_UNDEFINED: // used for backward compatibility
+            if (entry->dir == MRAA_GPIO_OUT && entry->value == value) {
+                return MRAA_SUCCESS;
+            }
+            // this function will sometimes fail, however this is not critical as
+            // long as the write succeeds - Test case galileo gen2 pin2. Retrying
+            // it on every init would not help either, so it counts as applied.
+            mraa_gpio_dir(entry->ctx, MRAA_GPIO_OUT);
+            ret = mraa_gpio_write(entry->ctx, value);
+            if (ret == MRAA_SUCCESS) {
+                entry->dir = MRAA_GPIO_OUT;
+                entry->value = value;
+            }
+            break;
+
+        case PINCMD_SET_VALUE:
+            if (entry->value == value) {
+                return MRAA_SUCCESS;
+            }
+            ret = mraa_gpio_write(entry->ctx, value);
+            if (ret == MRAA_SUCCESS) {
+                entry->value = value;
+            }
+            break;
+
+        case PINCMD_SET_DIRECTION:
+            if (value == MRAA_GPIO_OUT_HIGH || value == MRAA_GPIO_OUT_LOW) {
+                int level = (value == MRAA_GPIO_OUT_HIGH);
+                if (entry->dir == MRAA_GPIO_OUT && entry->value == level) {
+                    return MRAA_SUCCESS;
+                }
+                ret = mraa_gpio_dir(entry->ctx, value);
+                if (ret == MRAA_SUCCESS) {
+                    entry->dir = MRAA_GPIO_OUT;
+                    entry->value = level;
                 }
                 break;
+            }
+            if (entry->dir == value) {
+                return MRAA_SUCCESS;
+            }
+            ret = mraa_gpio_dir(entry->ctx, value);
+            if (ret == MRAA_SUCCESS) {
+                entry->dir = value;
+            }
+            break;
 
-            case PINCMD_SET_MODE:
-                if(meta.mux[mi].pin != last_pin) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    mux_i = mraa_gpio_init_raw(meta.mux[mi].pin);
-                    if (mux_i == NULL) return MRAA_ERROR_INVALID_HANDLE;
-                    last_pin = meta.mux[mi].pin;
-                }
+        case PINCMD_SET_IN_VALUE:
+        case PINCMD_SET_OUT_VALUE: {
+            int dir = (mux->pincmd == PINCMD_SET_IN_VALUE) ? MRAA_GPIO_IN : MRAA_GPIO_OUT;
+            if (entry->dir == dir && entry->value == value) {
+                return MRAA_SUCCESS;
+            }
+            ret = mraa_gpio_dir(entry->ctx, dir);
+            if (ret == MRAA_SUCCESS) {
+                entry->dir = dir;
+                ret = mraa_gpio_write(entry->ctx, value);
+            }
+            if (ret == MRAA_SUCCESS) {
+                entry->value = value;
+            }
+            break;
+        }
+
+        case PINCMD_SET_MODE:
+            if (entry->mode == value) {
+                return MRAA_SUCCESS;
+            }
+            ret = mraa_gpio_mode(entry->ctx, value);
+            if (ret == MRAA_SUCCESS) {
+                entry->mode = value;
+            }
+            break;
 
-                ret = mraa_gpio_mode(mux_i, meta.mux[mi].value);
+        default:
+            break;
+    }
 
-                if(ret != MRAA_SUCCESS) {
-                    if (mux_i != NULL) {
-                        mraa_gpio_owner(mux_i, 0);
-                        mraa_gpio_close(mux_i);
-                    }
-                    return MRAA_ERROR_INVALID_RESOURCE;
-                }
+    if (ret != MRAA_SUCCESS) {
+        /* Start over from a fresh export next time. */
+        mraa_mux_cache_drop(entry);
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_setup_mux_mapped(mraa_pin_t meta)
+{
+    unsigned int mi;
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    pthread_once(&mux_cache_once, mraa_mux_cache_lock_init);
+    pthread_mutex_lock(&mux_cache_lock);
+
+    for (mi = 0; mi < meta.mux_total && ret == MRAA_SUCCESS; mi++) {
+        switch (meta.mux[mi].pincmd) {
+            case PINCMD_UNDEFINED:
+            case PINCMD_SET_VALUE:
+            case PINCMD_SET_DIRECTION:
+            case PINCMD_SET_IN_VALUE:
+            case PINCMD_SET_OUT_VALUE:
+            case PINCMD_SET_MODE:
+                ret = mraa_mux_apply(&meta.mux[mi]);
                 break;
 
             case PINCMD_SKIP:
@@ -556,12 +769,9 @@ mraa_setup_mux_mapped(mraa_pin_t meta)
         }
     }
 
-    if (mux_i != NULL) {
-        mraa_gpio_owner(mux_i, 0);
-        mraa_gpio_close(mux_i);
-    }
+    pthread_mutex_unlock(&mux_cache_lock);
 
-    return MRAA_SUCCESS;
+    return ret;
 }
 #else
 mraa_result_t
@@ -569,6 +779,32 @@ mraa_setup_mux_mapped(mraa_pin_t meta)
 {
     return MRAA_ERROR_FEATURE_NOT_IMPLEMENTED;
 }
+
+void
+mraa_mux_pins_build()
+{
+}
+
+void
+mraa_mux_pins_free()
+{
+}
+
+mraa_boolean_t
+mraa_is_mux_pin(int pin)
+{
+    return 0;
+}
+
+void
+mraa_mux_cache_invalidate(int pin)
+{
+}
+
+void
+mraa_mux_cache_clear()
+{
+}
 #endif
 
 void
@@ -14,6 +14,7 @@
     #include "aio.hpp"
     #include "uart.hpp"
     #include "led.hpp"
+    #include "led_strip.hpp"
 %}
 
 %exception {
@@ -45,10 +46,8 @@
 %ignore Gpio(void* gpio_context);
 %ignore Led(void* led_context);
 
-%ignore Gpio::nop(uv_work_t* req);
-%ignore Gpio::v8isr(uv_work_t* req);
-%ignore Gpio::v8isr(uv_work_t* req, int status);
-%ignore Gpio::uvwork(void *ctx);
+%ignore Gpio::v8isr(void* owner, const unsigned char* events, unsigned int count);
+%ignore Gpio::uvpush(void* ctx);
 %ignore isr(Edge mode, void (*fptr)(void*), void* args);
 
 %include "gpio.hpp"
@@ -64,3 +63,5 @@
 %include "uart.hpp"
 
 %include "led.hpp"
+
+%include "led_strip.hpp"
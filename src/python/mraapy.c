@@ -24,7 +24,12 @@
 
 #include <syslog.h>
 #include <Python.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
 #include "python/mraapy.h"
+#include "mraa_internal.h"
 
 
 // In order to call a python object (all python functions are objects) we
@@ -89,3 +94,333 @@ mraa_python_isr(void (*isr)(void*), void* isr_args)
 
     PyGILState_Release(gilstate);
 }
+
+/*
+ * Batched delivery. The isr runs as a C callback on the isr thread and only
+ * moves edges into a ring buffer, a delivery thread then takes the GIL once
+ * per batch. Edges can also be drained from Python without a callback.
+ */
+#define MRAA_PYTHON_BATCH_RING_SIZE 1024 /* must be a power of 2 */
+
+typedef struct {
+    mraa_gpio_context dev;
+    mraa_gpio_edge_t mode;
+    PyObject* callback; /* NULL when edges are only drained */
+    unsigned int max_events;
+    uint64_t max_latency_ns;
+    /* Written by the isr thread only, read under lock by the consumers. */
+    unsigned int head;
+    unsigned int tail;
+    unsigned long dropped;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int stopping;
+    int detached; /* stopped from its own callback, the thread frees the batch */
+    mraa_gpio_edge_event events[MRAA_PYTHON_BATCH_RING_SIZE];
+} mraa_python_batch;
+
+static uint64_t
+mraa_python_batch_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+mraa_python_batch_push(mraa_python_batch* batch, const mraa_gpio_edge_event* event)
+{
+    unsigned int head = batch->head;
+
+    /* Full, keep the older edges nobody has seen yet. */
+    if (head - __atomic_load_n(&batch->tail, __ATOMIC_ACQUIRE) >= MRAA_PYTHON_BATCH_RING_SIZE) {
+        __atomic_store_n(&batch->dropped, batch->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    batch->events[head & (MRAA_PYTHON_BATCH_RING_SIZE - 1)] = *event;
+    __atomic_store_n(&batch->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void
+mraa_python_batch_isr(void* args)
+{
+    mraa_python_batch* batch = (mraa_python_batch*) args;
+    mraa_gpio_context dev = batch->dev;
+    mraa_gpio_edge_event buf[64];
+    int num;
+
+    if (dev->event_rings != NULL) {
+        /* chardev, every edge is queued with its direction */
+        while ((num = mraa_gpio_read_events(dev, buf, 64)) > 0) {
+            for (int i = 0; i < num; ++i) {
+                mraa_python_batch_push(batch, &buf[i]);
+            }
+        }
+    } else {
+        /* sysfs, the latest edge of each pin and no direction */
+        mraa_gpio_events_t events = mraa_gpio_get_events(dev);
+        for (unsigned int i = 0; events != NULL && i < dev->num_pins; ++i) {
+            if (events[i].id == -1) {
+                continue;
+            }
+            mraa_gpio_edge_event event = { 0 };
+            event.id = events[i].id;
+            event.timestamp = events[i].timestamp * 1000;
+            event.edge = batch->mode;
+            mraa_python_batch_push(batch, &event);
+        }
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    pthread_cond_signal(&batch->cond);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+/* Called with the GIL and batch->lock held. */
+static PyObject*
+mraa_python_batch_take(mraa_python_batch* batch, unsigned int max)
+{
+    unsigned int head = __atomic_load_n(&batch->head, __ATOMIC_ACQUIRE);
+    unsigned int tail = batch->tail;
+    unsigned int num = head - tail;
+
+    if (num > max) {
+        num = max;
+    }
+
+    PyObject* list = PyList_New(num);
+    if (list == NULL) {
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < num; ++i) {
+        mraa_gpio_edge_event* event = &batch->events[(tail + i) & (MRAA_PYTHON_BATCH_RING_SIZE - 1)];
+        PyObject* item = Py_BuildValue("(iKi)", event->id, (unsigned long long) event->timestamp, (int) event->edge);
+        if (item == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, item);
+    }
+
+    __atomic_store_n(&batch->tail, tail + num, __ATOMIC_RELEASE);
+
+    return list;
+}
+
+static void
+mraa_python_batch_free(mraa_python_batch* batch)
+{
+    Py_XDECREF(batch->callback);
+    pthread_cond_destroy(&batch->cond);
+    pthread_mutex_destroy(&batch->lock);
+    free(batch);
+}
+
+static void*
+mraa_python_batch_run(void* arg)
+{
+    mraa_python_batch* batch = (mraa_python_batch*) arg;
+    uint64_t first_pending = 0;
+
+    pthread_mutex_lock(&batch->lock);
+    while (!batch->stopping) {
+        unsigned int pending = __atomic_load_n(&batch->head, __ATOMIC_ACQUIRE) - batch->tail;
+        uint64_t now = mraa_python_batch_now();
+
+        if (pending == 0) {
+            first_pending = 0;
+            pthread_cond_wait(&batch->cond, &batch->lock);
+            continue;
+        }
+
+        if (first_pending == 0) {
+            first_pending = now;
+        }
+
+        if (pending < batch->max_events && now - first_pending < batch->max_latency_ns) {
+            uint64_t deadline = first_pending + batch->max_latency_ns;
+            struct timespec ts = { (time_t) (deadline / 1000000000ULL), (long) (deadline % 1000000000ULL) };
+            pthread_cond_timedwait(&batch->cond, &batch->lock, &ts);
+            continue;
+        }
+
+        /* Lock order is GIL first, drains from Python hold it already. */
+        pthread_mutex_unlock(&batch->lock);
+        PyGILState_STATE gilstate = PyGILState_Ensure();
+        pthread_mutex_lock(&batch->lock);
+
+        /* isr_exit() may have returned to Python while we waited for the GIL,
+         * the callback must not run after that. */
+        if (batch->stopping) {
+            PyGILState_Release(gilstate);
+            break;
+        }
+
+        PyObject* list = mraa_python_batch_take(batch, batch->max_events);
+        first_pending = 0;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (list == NULL) {
+            syslog(LOG_ERR, "gpio: isr_batch: failed to build the event list");
+            PyErr_Clear();
+        } else {
+            if (PyList_GET_SIZE(list) > 0) {
+                PyObject* ret = PyObject_CallFunctionObjArgs(batch->callback, list, NULL);
+                if (ret == NULL) {
+                    syslog(LOG_ERR, "gpio: isr_batch: callback failed");
+                    PyErr_Print();
+                } else {
+                    Py_DECREF(ret);
+                }
+            }
+            Py_DECREF(list);
+        }
+
+        PyGILState_Release(gilstate);
+        pthread_mutex_lock(&batch->lock);
+    }
+    mraa_boolean_t detached = batch->detached;
+    pthread_mutex_unlock(&batch->lock);
+
+    if (detached) {
+        PyGILState_STATE gilstate = PyGILState_Ensure();
+        mraa_python_batch_free(batch);
+        PyGILState_Release(gilstate);
+    }
+
+    return NULL;
+}
+
+/* Stop the delivery thread, then free the batch. Fine with or without the GIL. */
+static void
+mraa_python_batch_stop(mraa_python_batch* batch)
+{
+    PyGILState_STATE gilstate = PyGILState_Ensure();
+
+    pthread_mutex_lock(&batch->lock);
+    batch->stopping = 1;
+    pthread_cond_signal(&batch->cond);
+    if (pthread_equal(pthread_self(), batch->thread)) {
+        /* isr_exit() from the callback itself, can't join ourselves. */
+        batch->detached = 1;
+        pthread_detach(batch->thread);
+        pthread_mutex_unlock(&batch->lock);
+        PyGILState_Release(gilstate);
+        return;
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    /* The thread may be waiting for the GIL, hand it over while joining. */
+    Py_BEGIN_ALLOW_THREADS
+    pthread_join(batch->thread, NULL);
+    Py_END_ALLOW_THREADS
+
+    mraa_python_batch_free(batch);
+    PyGILState_Release(gilstate);
+}
+
+/* Called by mraa_gpio_isr_exit() with the isr already gone. */
+static void
+mraa_python_batch_release(mraa_gpio_context dev)
+{
+    mraa_python_batch* batch = (mraa_python_batch*) dev->isr_args;
+
+    dev->isr = NULL;
+    dev->isr_args = NULL;
+
+    if (batch->callback == NULL) {
+        mraa_python_batch_free(batch);
+        return;
+    }
+
+    /* Once this returns the callback is not called anymore. */
+    mraa_python_batch_stop(batch);
+}
+
+mraa_result_t
+mraa_python_isr_batch(mraa_gpio_context dev,
+                      mraa_gpio_edge_t mode,
+                      PyObject* pyfunc,
+                      unsigned int max_events,
+                      unsigned int max_latency_us)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "gpio: isr_batch: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (pyfunc != NULL && pyfunc != Py_None && !PyCallable_Check(pyfunc)) {
+        syslog(LOG_ERR, "gpio: isr_batch: callback is not callable");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    mraa_python_batch* batch = calloc(1, sizeof(mraa_python_batch));
+    if (batch == NULL) {
+        syslog(LOG_ERR, "gpio: isr_batch: Failed to allocate memory for batch");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&batch->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&batch->lock, NULL);
+
+    batch->dev = dev;
+    batch->mode = mode;
+    batch->max_events = max_events > 0 ? max_events : 1;
+    batch->max_latency_ns = (uint64_t) max_latency_us * 1000;
+    if (pyfunc != NULL && pyfunc != Py_None) {
+        Py_INCREF(pyfunc);
+        batch->callback = pyfunc;
+    }
+
+    if (batch->callback != NULL && pthread_create(&batch->thread, NULL, mraa_python_batch_run, batch) != 0) {
+        syslog(LOG_ERR, "gpio: isr_batch: failed to start the delivery thread");
+        mraa_python_batch_free(batch);
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    /* Plain C on the isr thread, no GIL involved. */
+    dev->isr_internal = 1;
+    mraa_result_t ret = mraa_gpio_isr(dev, mode, mraa_python_batch_isr, batch);
+    if (ret != MRAA_SUCCESS) {
+        dev->isr_internal = 0;
+        if (batch->callback != NULL) {
+            mraa_python_batch_stop(batch);
+        } else {
+            mraa_python_batch_free(batch);
+        }
+        return ret;
+    }
+
+    dev->isr_release = mraa_python_batch_release;
+
+    return MRAA_SUCCESS;
+}
+
+PyObject*
+mraa_python_read_events(mraa_gpio_context dev, int max)
+{
+    if (dev == NULL || dev->isr != mraa_python_batch_isr) {
+        PyErr_SetString(PyExc_RuntimeError, "no batched isr registered");
+        return NULL;
+    }
+
+    if (max < 0) {
+        PyErr_SetString(PyExc_ValueError, "max must not be negative");
+        return NULL;
+    }
+
+    mraa_python_batch* batch = (mraa_python_batch*) dev->isr_args;
+
+    pthread_mutex_lock(&batch->lock);
+    PyObject* list = mraa_python_batch_take(batch, (unsigned int) max);
+    pthread_mutex_unlock(&batch->lock);
+
+    return list;
+}
@@ -144,6 +144,19 @@ class Spi;
 
 %include ../mraa.i
 
+%extend mraa::Gpio {
+%pythoncode %{
+    def events(self, maxEvents=256):
+        """Iterate over the edges buffered by isrBatch() until none are left"""
+        while True:
+            batch = self.readEvents(maxEvents)
+            if not batch:
+                return
+            for event in batch:
+                yield event
+%}
+}
+
 %init %{
     #include "python/mraapy.h"
     #include "mraa_lang_func.h"
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "sampler.h"
+#include "mraa_internal.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MRAA_SAMPLER_DEFAULT_RING 64
+
+/*
+ * The ring of a job is only written by the sampler thread and only read by
+ * the thread draining it, head and tail are the handover points.
+ */
+typedef struct {
+    mraa_sampler_job_t job;
+    uint64_t period_ns;
+    uint64_t next_ns;
+    mraa_sampler_sample_t* ring;
+    unsigned int mask;
+    unsigned int head;
+    unsigned int tail;
+    unsigned long samples;
+    unsigned long missed;
+    unsigned long dropped;
+    unsigned long errors;
+} mraa_sampler_entry;
+
+struct _sampler {
+    mraa_sampler_entry* jobs;
+    int* order;
+    int num_jobs;
+    int timer_fd;
+    int stop_fd;
+    pthread_t thread;
+    mraa_boolean_t running;
+    mraa_boolean_t failed; /**< the thread gave up on a timer or poll error */
+};
+
+static uint64_t
+mraa_sampler_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static mraa_result_t
+mraa_sampler_take(mraa_sampler_entry* entry, mraa_sampler_sample_t* sample)
+{
+    mraa_sampler_job_t* job = &entry->job;
+
+    switch (job->type) {
+        case MRAA_SAMPLER_I2C: {
+            uint8_t reg = job->reg;
+            mraa_i2c_msg_t m[2] = { { job->addr, 0, 1, &reg },
+                                    { job->addr, MRAA_I2C_MSG_RD, job->len, sample->data } };
+            sample->len = job->len;
+            return mraa_i2c_transfer((mraa_i2c_context) job->context, m, 2);
+        }
+        case MRAA_SAMPLER_SPI: {
+            uint8_t tx[MRAA_SAMPLER_MAX_SAMPLE_LEN + 1] = { 0 };
+            uint8_t rx[MRAA_SAMPLER_MAX_SAMPLE_LEN + 1];
+            tx[0] = job->reg;
+            mraa_result_t ret = mraa_spi_transfer_buf((mraa_spi_context) job->context, tx, rx, job->len + 1);
+            if (ret == MRAA_SUCCESS) {
+                memcpy(sample->data, &rx[1], job->len);
+                sample->len = job->len;
+            }
+            return ret;
+        }
+        case MRAA_SAMPLER_AIO: {
+            int value = mraa_aio_read((mraa_aio_context) job->context);
+            if (value == -1) {
+                return MRAA_ERROR_UNSPECIFIED;
+            }
+            memcpy(sample->data, &value, sizeof(int));
+            sample->len = sizeof(int);
+            return MRAA_SUCCESS;
+        }
+    }
+
+    return MRAA_ERROR_INVALID_PARAMETER;
+}
+
+static void
+mraa_sampler_run(mraa_sampler_entry* entry, uint64_t now)
+{
+    unsigned int head = entry->head;
+
+    if (head - __atomic_load_n(&entry->tail, __ATOMIC_ACQUIRE) > entry->mask) {
+        __atomic_fetch_add(&entry->dropped, 1, __ATOMIC_RELAXED);
+    } else {
+        mraa_sampler_sample_t* sample = &entry->ring[head & entry->mask];
+        sample->timestamp_ns = mraa_sampler_now();
+        if (mraa_sampler_take(entry, sample) == MRAA_SUCCESS) {
+            __atomic_store_n(&entry->head, head + 1, __ATOMIC_RELEASE);
+            __atomic_fetch_add(&entry->samples, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(&entry->errors, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    // a late sampler skips the periods it missed instead of bursting to catch up
+    entry->next_ns += entry->period_ns;
+    if (entry->next_ns <= now) {
+        uint64_t behind = (now - entry->next_ns) / entry->period_ns + 1;
+        __atomic_fetch_add(&entry->missed, (unsigned long) behind, __ATOMIC_RELAXED);
+        entry->next_ns += behind * entry->period_ns;
+    }
+}
+
+static pthread_mutex_t mraa_sampler_sort_lock = PTHREAD_MUTEX_INITIALIZER;
+static mraa_sampler_context mraa_sampler_sorting;
+
+static int
+mraa_sampler_bus(const mraa_sampler_job_t* job)
+{
+    switch (job->type) {
+        case MRAA_SAMPLER_I2C:
+            return ((mraa_i2c_context) job->context)->busnum;
+        case MRAA_SAMPLER_SPI:
+            return ((mraa_spi_context) job->context)->busnum;
+        default:
+            return -1;
+    }
+}
+
+// by bus first, several contexts may share one
+static int
+mraa_sampler_cmp(const void* a, const void* b)
+{
+    const mraa_sampler_job_t* ja = &mraa_sampler_sorting->jobs[*(const int*) a].job;
+    const mraa_sampler_job_t* jb = &mraa_sampler_sorting->jobs[*(const int*) b].job;
+    if (ja->type != jb->type) {
+        return ja->type < jb->type ? -1 : 1;
+    }
+    int ba = mraa_sampler_bus(ja);
+    int bb = mraa_sampler_bus(jb);
+    if (ba != bb) {
+        return ba < bb ? -1 : 1;
+    }
+    if (ja->context != jb->context) {
+        return (uintptr_t) ja->context < (uintptr_t) jb->context ? -1 : 1;
+    }
+    return *(const int*) a - *(const int*) b;
+}
+
+static void*
+mraa_sampler_thread(void* arg)
+{
+    mraa_sampler_context dev = (mraa_sampler_context) arg;
+    struct pollfd pfd[2] = { { dev->timer_fd, POLLIN, 0 }, { dev->stop_fd, POLLIN, 0 } };
+
+    for (;;) {
+        uint64_t next = UINT64_MAX;
+        for (int i = 0; i < dev->num_jobs; i++) {
+            if (dev->jobs[i].next_ns < next) {
+                next = dev->jobs[i].next_ns;
+            }
+        }
+
+        struct itimerspec its = { { 0, 0 }, { next / 1000000000ULL, next % 1000000000ULL } };
+        if (timerfd_settime(dev->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+            syslog(LOG_ERR, "sampler: Failed to arm timer: %s", strerror(errno));
+            __atomic_store_n(&dev->failed, 1, __ATOMIC_RELEASE);
+            return NULL;
+        }
+
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            syslog(LOG_ERR, "sampler: poll failed: %s", strerror(errno));
+            __atomic_store_n(&dev->failed, 1, __ATOMIC_RELEASE);
+            return NULL;
+        }
+        if (pfd[1].revents) {
+            return NULL;
+        }
+
+        uint64_t expirations;
+        if (read(dev->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+            continue;
+        }
+
+        // order is sorted by bus, so reads on one bus go back to back
+        uint64_t now = mraa_sampler_now();
+        for (int i = 0; i < dev->num_jobs; i++) {
+            mraa_sampler_entry* entry = &dev->jobs[dev->order[i]];
+            if (entry->next_ns <= now) {
+                mraa_sampler_run(entry, now);
+            }
+        }
+    }
+}
+
+mraa_sampler_context
+mraa_sampler_init()
+{
+    mraa_sampler_context dev = calloc(1, sizeof(struct _sampler));
+    if (dev == NULL) {
+        syslog(LOG_CRIT, "sampler: Failed to allocate memory for context");
+        return NULL;
+    }
+
+    dev->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    dev->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (dev->timer_fd < 0 || dev->stop_fd < 0) {
+        syslog(LOG_ERR, "sampler: Failed to create timer: %s", strerror(errno));
+        if (dev->timer_fd >= 0)
+            close(dev->timer_fd);
+        if (dev->stop_fd >= 0)
+            close(dev->stop_fd);
+        free(dev);
+        return NULL;
+    }
+
+    return dev;
+}
+
+int
+mraa_sampler_add(mraa_sampler_context dev, const mraa_sampler_job_t* job)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "sampler: add: context is invalid");
+        return -1;
+    }
+
+    if (dev->running) {
+        syslog(LOG_ERR, "sampler: add: stop the sampler first");
+        return -1;
+    }
+
+    if (job == NULL || job->context == NULL || job->period_us == 0 ||
+        (job->type != MRAA_SAMPLER_AIO && (job->len == 0 || job->len > MRAA_SAMPLER_MAX_SAMPLE_LEN))) {
+        syslog(LOG_ERR, "sampler: add: invalid job");
+        return -1;
+    }
+
+    unsigned int size = 1;
+    while (size < (job->ring_size ? job->ring_size : MRAA_SAMPLER_DEFAULT_RING)) {
+        size <<= 1;
+    }
+
+    mraa_sampler_sample_t* ring = calloc(size, sizeof(mraa_sampler_sample_t));
+    mraa_sampler_entry* jobs = realloc(dev->jobs, (dev->num_jobs + 1) * sizeof(mraa_sampler_entry));
+    if (ring == NULL || jobs == NULL) {
+        syslog(LOG_CRIT, "sampler: add: Failed to allocate memory for job");
+        free(ring);
+        if (jobs != NULL)
+            dev->jobs = jobs;
+        return -1;
+    }
+    dev->jobs = jobs;
+
+    mraa_sampler_entry* entry = &dev->jobs[dev->num_jobs];
+    memset(entry, 0, sizeof(mraa_sampler_entry));
+    entry->job = *job;
+    entry->period_ns = (uint64_t) job->period_us * 1000;
+    entry->ring = ring;
+    entry->mask = size - 1;
+
+    return dev->num_jobs++;
+}
+
+mraa_result_t
+mraa_sampler_start(mraa_sampler_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "sampler: start: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (dev->running) {
+        return MRAA_SUCCESS;
+    }
+
+    if (dev->num_jobs == 0) {
+        syslog(LOG_ERR, "sampler: start: no jobs");
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    int* order = realloc(dev->order, dev->num_jobs * sizeof(int));
+    if (order == NULL) {
+        syslog(LOG_CRIT, "sampler: start: Failed to allocate memory");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    dev->order = order;
+    for (int i = 0; i < dev->num_jobs; i++) {
+        order[i] = i;
+    }
+    pthread_mutex_lock(&mraa_sampler_sort_lock);
+    mraa_sampler_sorting = dev;
+    qsort(order, dev->num_jobs, sizeof(int), mraa_sampler_cmp);
+    pthread_mutex_unlock(&mraa_sampler_sort_lock);
+
+    // everything starts together on the next millisecond, jobs sharing a bus
+    // with periods that divide each other then always fire in the same wakeup
+    uint64_t start = (mraa_sampler_now() / 1000000 + 1) * 1000000;
+    for (int i = 0; i < dev->num_jobs; i++) {
+        dev->jobs[i].next_ns = start;
+    }
+
+    uint64_t drain;
+    while (read(dev->stop_fd, &drain, sizeof(drain)) > 0)
+        ;
+
+    dev->failed = 0;
+    if (pthread_create(&dev->thread, NULL, mraa_sampler_thread, dev) != 0) {
+        syslog(LOG_ERR, "sampler: start: Failed to create thread");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+    dev->running = 1;
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_sampler_stop(mraa_sampler_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "sampler: stop: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (!dev->running) {
+        return MRAA_SUCCESS;
+    }
+
+    uint64_t one = 1;
+    if (write(dev->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        syslog(LOG_ERR, "sampler: stop: Failed to wake the sampler: %s", strerror(errno));
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+    pthread_join(dev->thread, NULL);
+    dev->running = 0;
+
+    if (dev->failed) {
+        syslog(LOG_ERR, "sampler: stop: the sampler had stopped on an error");
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+
+    return MRAA_SUCCESS;
+}
+
+int
+mraa_sampler_read(mraa_sampler_context dev, int job_id, mraa_sampler_sample_t* samples, int max_samples)
+{
+    if (dev == NULL || job_id < 0 || job_id >= dev->num_jobs || samples == NULL) {
+        syslog(LOG_ERR, "sampler: read: invalid context or job");
+        return -1;
+    }
+
+    mraa_sampler_entry* entry = &dev->jobs[job_id];
+    unsigned int tail = entry->tail;
+    unsigned int head = __atomic_load_n(&entry->head, __ATOMIC_ACQUIRE);
+    int count = 0;
+
+    while (tail != head && count < max_samples) {
+        samples[count++] = entry->ring[tail & entry->mask];
+        tail++;
+    }
+    __atomic_store_n(&entry->tail, tail, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+mraa_result_t
+mraa_sampler_get_stats(mraa_sampler_context dev, int job_id, mraa_sampler_stats_t* stats)
+{
+    if (dev == NULL || job_id < 0 || job_id >= dev->num_jobs || stats == NULL) {
+        syslog(LOG_ERR, "sampler: get_stats: invalid context or job");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    mraa_sampler_entry* entry = &dev->jobs[job_id];
+    stats->samples = __atomic_load_n(&entry->samples, __ATOMIC_RELAXED);
+    stats->missed = __atomic_load_n(&entry->missed, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&entry->dropped, __ATOMIC_RELAXED);
+    stats->errors = __atomic_load_n(&entry->errors, __ATOMIC_RELAXED);
+
+    if (__atomic_load_n(&dev->failed, __ATOMIC_ACQUIRE)) {
+        return MRAA_ERROR_UNSPECIFIED;
+    }
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_sampler_close(mraa_sampler_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "sampler: close: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    mraa_sampler_stop(dev);
+    for (int i = 0; i < dev->num_jobs; i++) {
+        free(dev->jobs[i].ring);
+    }
+    free(dev->jobs);
+    free(dev->order);
+    close(dev->timer_fd);
+    close(dev->stop_fd);
+    free(dev);
+
+    return MRAA_SUCCESS;
+}
@@ -48,6 +48,177 @@
 
 #define MAX_SIZE 64
 #define SPI_MAX_LENGTH 4096
+#define SPI_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+
+/* Largest message spidev takes, transfers beyond it fail with EMSGSIZE */
+static int
+mraa_spi_read_bufsiz()
+{
+    int bufsiz = 0;
+    FILE* fh = fopen(SPI_BUFSIZ_PATH, "r");
+
+    if (fh != NULL) {
+        if (fscanf(fh, "%d", &bufsiz) != 1) {
+            bufsiz = 0;
+        }
+        fclose(fh);
+    }
+
+    return bufsiz > 0 ? bufsiz : SPI_MAX_LENGTH;
+}
+
+/*
+ * Run a transfer of any length as consecutive messages of at most
+ * dev->bufsiz bytes, step bytes aligned. cs_change on the last (only)
+ * transfer of a message keeps chip select asserted until the next one.
+ */
+static mraa_result_t
+mraa_spi_transfer_chunked(mraa_spi_context dev, uint8_t* data, uint8_t* rxbuf, int length, int step)
+{
+    struct spi_ioc_transfer msg;
+    int bufsiz = dev->bufsiz > 0 ? dev->bufsiz : SPI_MAX_LENGTH;
+    int chunk = bufsiz - bufsiz % step;
+    int done = 0;
+
+    do {
+        int len = length - done > chunk ? chunk : length - done;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.tx_buf = (unsigned long) (data + done);
+        msg.rx_buf = rxbuf != NULL ? (unsigned long) (rxbuf + done) : 0;
+        msg.speed_hz = dev->clock;
+        msg.bits_per_word = dev->bpw;
+        msg.delay_usecs = 0;
+        msg.len = len;
+        msg.cs_change = done + len < length;
+        if (ioctl(dev->devfd, SPI_IOC_MESSAGE(1), &msg) < 0) {
+            syslog(LOG_ERR, "spi: Failed to perform dev transfer: %s", strerror(errno));
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+        done += len;
+    } while (done < length);
+
+    return MRAA_SUCCESS;
+}
+
+/* Reverse the bits of every byte, eight bytes at a time */
+static void
+mraa_spi_reverse_bits(uint8_t* buf, int length)
+{
+    int i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t x;
+        memcpy(&x, buf + i, 8);
+        x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        memcpy(buf + i, &x, 8);
+    }
+    for (; i < length; i++) {
+        uint8_t x = buf[i];
+        x = ((x >> 1) & 0x55) | ((x & 0x55) << 1);
+        x = ((x >> 2) & 0x33) | ((x & 0x33) << 2);
+        buf[i] = (x >> 4) | (x << 4);
+    }
+}
+
+/* Reverse the byte order of every size byte word, a trailing partial word is left alone */
+static void
+mraa_spi_swap_bytes(uint8_t* buf, int length, int size)
+{
+    int i;
+
+    if (size == 2) {
+        for (i = 0; i + 2 <= length; i += 2) {
+            uint16_t w;
+            memcpy(&w, buf + i, 2);
+            w = __builtin_bswap16(w);
+            memcpy(buf + i, &w, 2);
+        }
+    } else if (size == 4) {
+        for (i = 0; i + 4 <= length; i += 4) {
+            uint32_t w;
+            memcpy(&w, buf + i, 4);
+            w = __builtin_bswap32(w);
+            memcpy(buf + i, &w, 4);
+        }
+    }
+}
+
+/*
+ * Whether the 16 bit words of the word functions need their bytes swapped to
+ * go out in dev->word_order. With 16 bits per word the controller shifts the
+ * words out msb first, with 8 bits per word they go out in memory order.
+ */
+static mraa_boolean_t
+mraa_spi_word_swapped(mraa_spi_context dev)
+{
+    mraa_spi_word_order_t wire;
+
+    if (dev->word_order == MRAA_SPI_WORD_NATIVE) {
+        return 0;
+    }
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    wire = MRAA_SPI_WORD_MSB_FIRST;
+#else
+    wire = dev->bpw == 16 ? MRAA_SPI_WORD_MSB_FIRST : MRAA_SPI_WORD_LSB_FIRST;
+#endif
+    return wire != dev->word_order;
+}
+
+static mraa_boolean_t
+mraa_spi_soft_needed(mraa_spi_context dev, mraa_boolean_t words)
+{
+    return dev->soft_lsb || (words && mraa_spi_word_swapped(dev));
+}
+
+/*
+ * Bring a buffer from memory order to wire order or back, both directions
+ * are the same permutation. A word of more than 8 bits sent lsb first is
+ * the word with its bytes swapped and the bits of each byte reversed.
+ */
+static void
+mraa_spi_soft_order(mraa_spi_context dev, uint8_t* buf, int length, mraa_boolean_t words)
+{
+    if (words && mraa_spi_word_swapped(dev)) {
+        mraa_spi_swap_bytes(buf, length, 2);
+    }
+    if (dev->soft_lsb) {
+        mraa_spi_reverse_bits(buf, length);
+        if (dev->bpw == 16 || dev->bpw == 32) {
+            mraa_spi_swap_bytes(buf, length, dev->bpw / 8);
+        }
+    }
+}
+
+/*
+ * Transfer with the bit and byte order fixed up in software. The tx buffer
+ * is converted in place and restored afterwards, unless it is also the rx
+ * buffer, which is converted in place once the data is in.
+ */
+static mraa_result_t
+mraa_spi_transfer_soft(mraa_spi_context dev, uint8_t* data, uint8_t* rxbuf, int length, mraa_boolean_t words)
+{
+    mraa_result_t ret;
+
+    mraa_spi_soft_order(dev, data, length, words);
+    if (words && IS_FUNC_DEFINED(dev, spi_transfer_buf_word_replace)) {
+        ret = dev->advance_func->spi_transfer_buf_word_replace(dev, (uint16_t*) data, (uint16_t*) rxbuf, length);
+    } else if (IS_FUNC_DEFINED(dev, spi_transfer_buf_replace)) {
+        ret = dev->advance_func->spi_transfer_buf_replace(dev, data, rxbuf, length);
+    } else {
+        ret = mraa_spi_transfer_chunked(dev, data, rxbuf, length, words ? sizeof(uint16_t) : 1);
+    }
+    if (rxbuf != data) {
+        mraa_spi_soft_order(dev, data, length, words);
+    }
+    if (rxbuf != NULL && ret == MRAA_SUCCESS) {
+        mraa_spi_soft_order(dev, rxbuf, length, words);
+    }
+
+    return ret;
+}
 
 static mraa_spi_context
 mraa_spi_init_internal(mraa_adv_func_t* func_table)
@@ -146,6 +317,7 @@ mraa_spi_init_raw(unsigned int bus, unsigned int cs)
         status = MRAA_ERROR_NO_RESOURCES;
         goto init_raw_cleanup;
     }
+    dev->busnum = bus;
 
     if (IS_FUNC_DEFINED(dev, spi_init_raw_replace)) {
         status = dev->advance_func->spi_init_raw_replace(dev, bus, cs);
@@ -175,6 +347,8 @@ mraa_spi_init_raw(unsigned int bus, unsigned int cs)
         syslog(LOG_WARNING, "spi: Max speed query failed, setting %d", dev->clock);
     }
 
+    dev->bufsiz = mraa_spi_read_bufsiz();
+
     status = mraa_spi_mode(dev, MRAA_SPI_MODE0);
     if (status != MRAA_SUCCESS) {
         goto init_raw_cleanup;
@@ -279,19 +453,41 @@ mraa_spi_lsbmode(mraa_spi_context dev, mraa_boolean_t lsb)
         return dev->advance_func->spi_lsbmode_replace(dev, lsb);
     }
 
+    // many controllers refuse SPI_LSB_FIRST or quietly stay msb first, the
+    // bits are reversed in software for those
     uint8_t lsb_mode = (uint8_t) lsb;
-    if (ioctl(dev->devfd, SPI_IOC_WR_LSB_FIRST, &lsb_mode) < 0) {
-        syslog(LOG_ERR, "spi: Failed to set bit order");
-        return MRAA_ERROR_INVALID_RESOURCE;
-    }
-    if (ioctl(dev->devfd, SPI_IOC_RD_LSB_FIRST, &lsb_mode) < 0) {
-        syslog(LOG_ERR, "spi: Failed to set bit order");
-        return MRAA_ERROR_INVALID_RESOURCE;
+    dev->soft_lsb = 0;
+    if (ioctl(dev->devfd, SPI_IOC_WR_LSB_FIRST, &lsb_mode) < 0 ||
+        ioctl(dev->devfd, SPI_IOC_RD_LSB_FIRST, &lsb_mode) < 0 || lsb_mode != (uint8_t) lsb) {
+        lsb_mode = 0;
+        if (!lsb || ioctl(dev->devfd, SPI_IOC_WR_LSB_FIRST, &lsb_mode) < 0) {
+            syslog(LOG_ERR, "spi: Failed to set bit order");
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+        syslog(LOG_NOTICE, "spi: controller can't send lsb first, reversing bits in software");
+        dev->soft_lsb = 1;
     }
     dev->lsb = lsb;
     return MRAA_SUCCESS;
 }
 
+mraa_result_t
+mraa_spi_word_order(mraa_spi_context dev, mraa_spi_word_order_t order)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "spi: word_order: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (order != MRAA_SPI_WORD_NATIVE && order != MRAA_SPI_WORD_MSB_FIRST && order != MRAA_SPI_WORD_LSB_FIRST) {
+        syslog(LOG_ERR, "spi: word_order: Invalid word order %d", order);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    dev->word_order = order;
+    return MRAA_SUCCESS;
+}
+
 mraa_result_t
 mraa_spi_bit_per_word(mraa_spi_context dev, unsigned int bits)
 {
@@ -320,8 +516,18 @@ mraa_spi_write(mraa_spi_context dev, uint8_t data)
         return -1;
     }
 
+    if (dev->soft_lsb) {
+        mraa_spi_reverse_bits(&data, 1);
+    }
+
     if (IS_FUNC_DEFINED(dev, spi_write_replace)) {
-        return dev->advance_func->spi_write_replace(dev, data);
+        int ret = dev->advance_func->spi_write_replace(dev, data);
+        if (ret == -1 || !dev->soft_lsb) {
+            return ret;
+        }
+        uint8_t recv = (uint8_t) ret;
+        mraa_spi_reverse_bits(&recv, 1);
+        return (int) recv;
     }
 
     struct spi_ioc_transfer msg;
@@ -340,6 +546,9 @@ mraa_spi_write(mraa_spi_context dev, uint8_t data)
         syslog(LOG_ERR, "spi: Failed to perform dev transfer");
         return -1;
     }
+    if (dev->soft_lsb) {
+        mraa_spi_reverse_bits((uint8_t*) &recv, 1);
+    }
     return (int) recv;
 }
 
@@ -351,25 +560,38 @@ mraa_spi_write_word(mraa_spi_context dev, uint16_t data)
         return -1;
     }
 
-    if (IS_FUNC_DEFINED(dev, spi_write_word_replace)) {
-        return dev->advance_func->spi_write_word_replace(dev, data);
+    mraa_boolean_t soft = mraa_spi_soft_needed(dev, 1);
+    if (soft) {
+        mraa_spi_soft_order(dev, (uint8_t*) &data, 2, 1);
     }
 
-    struct spi_ioc_transfer msg;
-    memset(&msg, 0, sizeof(msg));
-
-    uint16_t length = 2;
-
     uint16_t recv = 0;
-    msg.tx_buf = (unsigned long) &data;
-    msg.rx_buf = (unsigned long) &recv;
-    msg.speed_hz = dev->clock;
-    msg.bits_per_word = dev->bpw;
-    msg.delay_usecs = 0;
-    msg.len = length;
-    if (ioctl(dev->devfd, SPI_IOC_MESSAGE(1), &msg) < 0) {
-        syslog(LOG_ERR, "spi: Failed to perform dev transfer");
-        return -1;
+    if (IS_FUNC_DEFINED(dev, spi_write_word_replace)) {
+        int ret = dev->advance_func->spi_write_word_replace(dev, data);
+        if (ret == -1 || !soft) {
+            return ret;
+        }
+        recv = (uint16_t) ret;
+    } else {
+        struct spi_ioc_transfer msg;
+        memset(&msg, 0, sizeof(msg));
+
+        uint16_t length = 2;
+
+        msg.tx_buf = (unsigned long) &data;
+        msg.rx_buf = (unsigned long) &recv;
+        msg.speed_hz = dev->clock;
+        msg.bits_per_word = dev->bpw;
+        msg.delay_usecs = 0;
+        msg.len = length;
+        if (ioctl(dev->devfd, SPI_IOC_MESSAGE(1), &msg) < 0) {
+            syslog(LOG_ERR, "spi: Failed to perform dev transfer");
+            return -1;
+        }
+    }
+
+    if (soft) {
+        mraa_spi_soft_order(dev, (uint8_t*) &recv, 2, 1);
     }
     return (int) recv;
 }
@@ -382,49 +604,114 @@ mraa_spi_transfer_buf(mraa_spi_context dev, uint8_t* data, uint8_t* rxbuf, int l
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    if (mraa_spi_soft_needed(dev, 0)) {
+        return mraa_spi_transfer_soft(dev, data, rxbuf, length, 0);
+    }
+
     if (IS_FUNC_DEFINED(dev, spi_transfer_buf_replace)) {
         return dev->advance_func->spi_transfer_buf_replace(dev, data, rxbuf, length);
     }
+    return mraa_spi_transfer_chunked(dev, data, rxbuf, length, 1);
+}
 
-    struct spi_ioc_transfer msg;
-    memset(&msg, 0, sizeof(msg));
+mraa_result_t
+mraa_spi_transfer_buf_word(mraa_spi_context dev, uint16_t* data, uint16_t* rxbuf, int length)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "spi: transfer_buf_word: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
 
-    msg.tx_buf = (unsigned long) data;
-    msg.rx_buf = (unsigned long) rxbuf;
-    msg.speed_hz = dev->clock;
-    msg.bits_per_word = dev->bpw;
-    msg.delay_usecs = 0;
-    msg.len = length;
-    if (ioctl(dev->devfd, SPI_IOC_MESSAGE(1), &msg) < 0) {
-        syslog(LOG_ERR, "spi: Failed to perform dev transfer");
-        return MRAA_ERROR_INVALID_RESOURCE;
+    if (!mraa_spi_soft_needed(dev, 1)) {
+        if (IS_FUNC_DEFINED(dev, spi_transfer_buf_word_replace)) {
+            return dev->advance_func->spi_transfer_buf_word_replace(dev, data, rxbuf, length);
+        }
+        return mraa_spi_transfer_chunked(dev, (uint8_t*) data, (uint8_t*) rxbuf, length, sizeof(uint16_t));
     }
-    return MRAA_SUCCESS;
+    return mraa_spi_transfer_soft(dev, (uint8_t*) data, (uint8_t*) rxbuf, length, 1);
+}
+
+/*
+ * Run segments through the backend's transfer_buf, for backends that don't
+ * talk to spidev. Chip select is not held between the segments here.
+ */
+static mraa_result_t
+mraa_spi_transfer_multi_emulated(mraa_spi_context dev, mraa_spi_segment_t* segments, int num_segments)
+{
+    mraa_result_t ret = MRAA_SUCCESS;
+    uint8_t* zeros = NULL;
+
+    for (int i = 0; i < num_segments && ret == MRAA_SUCCESS; i++) {
+        uint8_t* tx = (uint8_t*) segments[i].tx_buf;
+
+        if (segments[i].len > 0) {
+            if (tx == NULL) {
+                free(zeros);
+                zeros = tx = calloc(segments[i].len, 1);
+                if (tx == NULL) {
+                    ret = MRAA_ERROR_NO_RESOURCES;
+                    break;
+                }
+            }
+            ret = mraa_spi_transfer_buf(dev, tx, segments[i].rx_buf, segments[i].len);
+        }
+        if (segments[i].delay_usecs > 0) {
+            usleep(segments[i].delay_usecs);
+        }
+    }
+
+    free(zeros);
+    return ret;
 }
 
 mraa_result_t
-mraa_spi_transfer_buf_word(mraa_spi_context dev, uint16_t* data, uint16_t* rxbuf, int length)
+mraa_spi_transfer_multi(mraa_spi_context dev, mraa_spi_segment_t* segments, int num_segments)
 {
     if (dev == NULL) {
-        syslog(LOG_ERR, "spi: transfer_buf_word: context is invalid");
+        syslog(LOG_ERR, "spi: transfer_multi: context is invalid");
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
-    if (IS_FUNC_DEFINED(dev, spi_transfer_buf_word_replace)) {
-        return dev->advance_func->spi_transfer_buf_word_replace(dev, data, rxbuf, length);
+    if (segments == NULL || num_segments <= 0 || num_segments > MRAA_SPI_TRANSFER_MAX_SEGMENTS) {
+        syslog(LOG_ERR, "spi: transfer_multi: invalid segments");
+        return MRAA_ERROR_INVALID_PARAMETER;
     }
 
-    struct spi_ioc_transfer msg;
-    memset(&msg, 0, sizeof(msg));
+    // spidev refuses a message longer than its bufsiz as a whole
+    if (dev->bufsiz > 0) {
+        size_t total = 0;
+        for (int i = 0; i < num_segments; i++) {
+            total += segments[i].len;
+        }
+        if (total > (size_t) dev->bufsiz) {
+            syslog(LOG_ERR, "spi: transfer_multi: %zu bytes exceed the spidev bufsiz of %d", total, dev->bufsiz);
+            return MRAA_ERROR_INVALID_PARAMETER;
+        }
+    }
 
-    msg.tx_buf = (unsigned long) data;
-    msg.rx_buf = (unsigned long) rxbuf;
-    msg.speed_hz = dev->clock;
-    msg.bits_per_word = dev->bpw;
-    msg.delay_usecs = 0;
-    msg.len = length;
-    if (ioctl(dev->devfd, SPI_IOC_MESSAGE(1), &msg) < 0) {
-        syslog(LOG_ERR, "spi: Failed to perform dev transfer");
+    if (IS_FUNC_DEFINED(dev, spi_transfer_multi_replace)) {
+        return dev->advance_func->spi_transfer_multi_replace(dev, segments, num_segments);
+    }
+
+    if (IS_FUNC_DEFINED(dev, spi_transfer_buf_replace)) {
+        return mraa_spi_transfer_multi_emulated(dev, segments, num_segments);
+    }
+
+    struct spi_ioc_transfer msg[MRAA_SPI_TRANSFER_MAX_SEGMENTS];
+    memset(msg, 0, sizeof(struct spi_ioc_transfer) * num_segments);
+
+    for (int i = 0; i < num_segments; i++) {
+        msg[i].tx_buf = (unsigned long) segments[i].tx_buf;
+        msg[i].rx_buf = (unsigned long) segments[i].rx_buf;
+        msg[i].len = segments[i].len;
+        msg[i].speed_hz = segments[i].speed_hz ? segments[i].speed_hz : (uint32_t) dev->clock;
+        msg[i].bits_per_word = segments[i].bits_per_word ? segments[i].bits_per_word : dev->bpw;
+        msg[i].delay_usecs = segments[i].delay_usecs;
+        msg[i].cs_change = segments[i].cs_change;
+    }
+
+    if (ioctl(dev->devfd, SPI_IOC_MESSAGE(num_segments), msg) < 0) {
+        syslog(LOG_ERR, "spi: transfer_multi: Failed to perform dev transfer: %s", strerror(errno));
         return MRAA_ERROR_INVALID_RESOURCE;
     }
     return MRAA_SUCCESS;
@@ -472,6 +759,8 @@ mraa_spi_stop(mraa_spi_context dev)
         return MRAA_ERROR_INVALID_HANDLE;
     }
 
+    mraa_spi_stream_stop(dev);
+
     if (IS_FUNC_DEFINED(dev, spi_stop_replace)) {
         return dev->advance_func->spi_stop_replace(dev);
     }
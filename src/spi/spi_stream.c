@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "spi.h"
+#include "mraa_internal.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Buffers move from the reader to the consumer and back in order: head
+ * counts filled buffers, next the ones handed out by get and tail the ones
+ * given back by release, so tail <= next <= head <= tail + num_buffers.
+ */
+struct _spi_stream {
+    mraa_spi_stream_config_t config;
+    uint8_t* tx;
+    uint8_t* data;    /**< num_buffers + 1 buffers, the last one catches overruns */
+    int length;       /**< bytes per buffer */
+    uint64_t* timestamps;
+    unsigned long* sequences;
+    unsigned long head;
+    unsigned long next;
+    unsigned long tail;
+    unsigned long overruns;
+    mraa_boolean_t running;
+    mraa_boolean_t failed;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_t thread;
+};
+
+static uint64_t
+mraa_spi_stream_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void*
+mraa_spi_stream_thread(void* arg)
+{
+    mraa_spi_context dev = (mraa_spi_context) arg;
+    struct _spi_stream* stream = dev->stream;
+    mraa_spi_segment_t segments[MRAA_SPI_TRANSFER_MAX_SEGMENTS];
+    int count = stream->config.transfers_per_buffer;
+    unsigned long sequence = 0;
+
+    if (stream->config.rt_priority > 0) {
+        struct sched_param sched_s;
+        memset(&sched_s, 0, sizeof(struct sched_param));
+        sched_s.sched_priority = stream->config.rt_priority;
+        if (sched_s.sched_priority > sched_get_priority_max(SCHED_RR)) {
+            sched_s.sched_priority = sched_get_priority_max(SCHED_RR);
+        }
+        if (pthread_setschedparam(pthread_self(), SCHED_RR, &sched_s) != 0) {
+            syslog(LOG_WARNING, "spi: stream: Failed to set realtime priority, reading at normal priority");
+        }
+    }
+
+    // chip select goes up between transfers but stays down after the last one
+    // if cs_change is set there, so it is only set on the ones before
+    memset(segments, 0, sizeof(segments));
+    for (int i = 0; i < count; i++) {
+        segments[i].tx_buf = stream->tx;
+        segments[i].len = stream->config.transfer_len;
+        segments[i].cs_change = i < count - 1;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    while (stream->running) {
+        unsigned int slot = stream->head % stream->config.num_buffers;
+        mraa_boolean_t full = stream->head - stream->tail >= stream->config.num_buffers;
+        pthread_mutex_unlock(&stream->lock);
+
+        if (full) {
+            slot = stream->config.num_buffers;
+        }
+        uint8_t* data = stream->data + (size_t) slot * stream->length;
+        for (int i = 0; i < count; i++) {
+            segments[i].rx_buf = data + i * stream->config.transfer_len;
+        }
+
+        uint64_t timestamp = mraa_spi_stream_now();
+        mraa_result_t ret = mraa_spi_transfer_multi(dev, segments, count);
+
+        pthread_mutex_lock(&stream->lock);
+        if (ret != MRAA_SUCCESS) {
+            syslog(LOG_ERR, "spi: stream: transfer failed, stopping the reader");
+            stream->failed = 1;
+            break;
+        }
+        if (full) {
+            stream->overruns++;
+        } else {
+            stream->timestamps[slot] = timestamp;
+            stream->sequences[slot] = sequence;
+            stream->head++;
+        }
+        sequence++;
+        pthread_cond_broadcast(&stream->filled);
+    }
+    pthread_cond_broadcast(&stream->filled);
+    pthread_mutex_unlock(&stream->lock);
+
+    return NULL;
+}
+
+mraa_result_t
+mraa_spi_stream_start(mraa_spi_context dev, const mraa_spi_stream_config_t* config)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "spi: stream_start: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    if (dev->stream != NULL) {
+        syslog(LOG_ERR, "spi: stream_start: already streaming");
+        return MRAA_ERROR_INVALID_RESOURCE;
+    }
+
+    if (config == NULL || config->tx_template == NULL || config->transfer_len == 0 ||
+        config->transfers_per_buffer == 0 || config->transfers_per_buffer > MRAA_SPI_TRANSFER_MAX_SEGMENTS ||
+        config->num_buffers < 2) {
+        syslog(LOG_ERR, "spi: stream_start: invalid configuration");
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    // spidev refuses a message longer than its bufsiz as a whole
+    if (dev->bufsiz > 0 && (size_t) config->transfers_per_buffer * config->transfer_len > (size_t) dev->bufsiz) {
+        syslog(LOG_ERR, "spi: stream_start: %u bytes per buffer exceed the spidev bufsiz of %d",
+               (unsigned int) config->transfers_per_buffer * config->transfer_len, dev->bufsiz);
+        return MRAA_ERROR_INVALID_PARAMETER;
+    }
+
+    struct _spi_stream* stream = calloc(1, sizeof(struct _spi_stream));
+    if (stream == NULL) {
+        syslog(LOG_CRIT, "spi: stream_start: Failed to allocate memory for stream");
+        return MRAA_ERROR_NO_RESOURCES;
+    }
+
+    stream->config = *config;
+    stream->length = config->transfers_per_buffer * config->transfer_len;
+    stream->tx = malloc(config->transfer_len);
+    stream->data = malloc((size_t) (config->num_buffers + 1) * stream->length);
+    stream->timestamps = calloc(config->num_buffers, sizeof(uint64_t));
+    stream->sequences = calloc(config->num_buffers, sizeof(unsigned long));
+    if (stream->tx == NULL || stream->data == NULL || stream->timestamps == NULL || stream->sequences == NULL) {
+        syslog(LOG_CRIT, "spi: stream_start: Failed to allocate memory for buffers");
+        goto stream_start_cleanup;
+    }
+    memcpy(stream->tx, config->tx_template, config->transfer_len);
+    stream->config.tx_template = stream->tx;
+
+    pthread_condattr_t attr;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&stream->filled, &attr);
+    pthread_condattr_destroy(&attr);
+
+    stream->running = 1;
+    dev->stream = stream;
+    if (pthread_create(&stream->thread, NULL, mraa_spi_stream_thread, dev) != 0) {
+        syslog(LOG_ERR, "spi: stream_start: Failed to create reader thread");
+        dev->stream = NULL;
+        pthread_cond_destroy(&stream->filled);
+        pthread_mutex_destroy(&stream->lock);
+        goto stream_start_cleanup;
+    }
+
+    return MRAA_SUCCESS;
+
+stream_start_cleanup:
+    free(stream->sequences);
+    free(stream->timestamps);
+    free(stream->data);
+    free(stream->tx);
+    free(stream);
+    return MRAA_ERROR_NO_RESOURCES;
+}
+
+mraa_result_t
+mraa_spi_stream_get(mraa_spi_context dev, mraa_spi_stream_buffer_t* buffer, int timeout_ms)
+{
+    if (dev == NULL || dev->stream == NULL || buffer == NULL) {
+        syslog(LOG_ERR, "spi: stream_get: context is invalid or not streaming");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _spi_stream* stream = dev->stream;
+    struct timespec until;
+
+    if (timeout_ms >= 0) {
+        uint64_t ns = mraa_spi_stream_now() + (uint64_t) timeout_ms * 1000000;
+        until.tv_sec = ns / 1000000000ULL;
+        until.tv_nsec = ns % 1000000000ULL;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    while (stream->next == stream->head) {
+        if (stream->failed) {
+            pthread_mutex_unlock(&stream->lock);
+            return MRAA_ERROR_INVALID_RESOURCE;
+        }
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&stream->filled, &stream->lock);
+        } else if (pthread_cond_timedwait(&stream->filled, &stream->lock, &until) != 0 &&
+                   stream->next == stream->head) {
+            pthread_mutex_unlock(&stream->lock);
+            return MRAA_ERROR_NO_DATA_AVAILABLE;
+        }
+    }
+
+    unsigned int slot = stream->next % stream->config.num_buffers;
+    buffer->data = stream->data + (size_t) slot * stream->length;
+    buffer->length = stream->length;
+    buffer->timestamp_ns = stream->timestamps[slot];
+    buffer->sequence = stream->sequences[slot];
+    stream->next++;
+    pthread_mutex_unlock(&stream->lock);
+
+    return MRAA_SUCCESS;
+}
+
+mraa_result_t
+mraa_spi_stream_release(mraa_spi_context dev)
+{
+    if (dev == NULL || dev->stream == NULL) {
+        syslog(LOG_ERR, "spi: stream_release: context is invalid or not streaming");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _spi_stream* stream = dev->stream;
+    mraa_result_t ret = MRAA_SUCCESS;
+
+    pthread_mutex_lock(&stream->lock);
+    if (stream->tail == stream->next) {
+        syslog(LOG_ERR, "spi: stream_release: no buffer taken");
+        ret = MRAA_ERROR_INVALID_PARAMETER;
+    } else {
+        stream->tail++;
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    return ret;
+}
+
+unsigned long
+mraa_spi_stream_overruns(mraa_spi_context dev)
+{
+    if (dev == NULL || dev->stream == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&dev->stream->lock);
+    unsigned long overruns = dev->stream->overruns;
+    pthread_mutex_unlock(&dev->stream->lock);
+
+    return overruns;
+}
+
+mraa_result_t
+mraa_spi_stream_stop(mraa_spi_context dev)
+{
+    if (dev == NULL) {
+        syslog(LOG_ERR, "spi: stream_stop: context is invalid");
+        return MRAA_ERROR_INVALID_HANDLE;
+    }
+
+    struct _spi_stream* stream = dev->stream;
+    if (stream == NULL) {
+        return MRAA_SUCCESS;
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    stream->running = 0;
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    dev->stream = NULL;
+    pthread_cond_destroy(&stream->filled);
+    pthread_mutex_destroy(&stream->lock);
+    free(stream->sequences);
+    free(stream->timestamps);
+    free(stream->data);
+    free(stream->tx);
+    free(stream);
+
+    return MRAA_SUCCESS;
+}
@@ -751,6 +751,27 @@ mraa_intel_edison_mmap_write(mraa_gpio_context dev, int value)
     return MRAA_SUCCESS;
 }
 
+static mraa_result_t
+mraa_intel_edison_mmap_write_bank(mraa_gpio_context dev, unsigned int bank, uint32_t set, uint32_t clear)
+{
+    uint8_t offset = bank * sizeof(uint32_t);
+
+    if (set) {
+        *(volatile uint32_t*) (mmap_reg + offset + 0x34) = set;
+    }
+    if (clear) {
+        *(volatile uint32_t*) (mmap_reg + offset + 0x4c) = clear;
+    }
+
+    return MRAA_SUCCESS;
+}
+
+static uint32_t
+mraa_intel_edison_mmap_read_bank(mraa_gpio_context dev, unsigned int bank)
+{
+    return *(volatile uint32_t*) (mmap_reg + 0x04 + bank * sizeof(uint32_t));
+}
+
 int
 mraa_intel_edison_mmap_read(mraa_gpio_context dev)
 {
@@ -779,6 +800,8 @@ mraa_intel_edison_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
         }
         dev->mmap_write = NULL;
         dev->mmap_read = NULL;
+        dev->mmap_write_bank = NULL;
+        dev->mmap_read_bank = NULL;
         mmap_count--;
         if (mmap_count == 0) {
             return mraa_intel_edison_mmap_unsetup();
@@ -818,6 +841,8 @@ mraa_intel_edison_mmap_setup(mraa_gpio_context dev, mraa_boolean_t en)
     }
     dev->mmap_write = &mraa_intel_edison_mmap_write;
     dev->mmap_read = &mraa_intel_edison_mmap_read;
+    dev->mmap_write_bank = &mraa_intel_edison_mmap_write_bank;
+    dev->mmap_read_bank = &mraa_intel_edison_mmap_read_bank;
     mmap_count++;
 
     return MRAA_SUCCESS;
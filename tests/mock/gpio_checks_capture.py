@@ -0,0 +1,44 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2018 Intel Corporation.
+#
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+# NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+# OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+# WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+import mraa as m
+import unittest as u
+
+MRAA_TEST_PIN = 0
+
+class GpioChecksCapture(u.TestCase):
+  def setUp(self):
+    self.pin = m.Gpio(MRAA_TEST_PIN)
+
+  def tearDown(self):
+    del self.pin
+
+  def test_capture(self):
+      res = self.pin.captureStart(m.EDGE_BOTH, 100)
+      self.assertEqual(res, m.ERROR_FEATURE_NOT_SUPPORTED, "Capture without chardev did not return unsupported")
+      self.assertRaises(RuntimeError, self.pin.captureRead)
+      res = self.pin.captureStop()
+      self.assertEqual(res, m.SUCCESS, "Stopping a capture that never ran did not return success")
+
+if __name__ == '__main__':
+  u.main()
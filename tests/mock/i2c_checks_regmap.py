@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2018 Intel Corporation.
+#
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+# NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+# OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+# WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+import mraa as m
+import unittest as u
+
+from i2c_checks_shared import *
+
+# Without a register map attached the regmap calls go straight to the device
+class I2cChecksRegmap(u.TestCase):
+  def setUp(self):
+    self.i2c = m.I2c(MRAA_I2C_BUS_NUM)
+    self.i2c.address(MRAA_MOCK_I2C_ADDR)
+
+  def tearDown(self):
+    del self.i2c
+
+  def test_i2c_regmap_write_read(self):
+    test_byte = 0xEE
+    reg = MRAA_MOCK_I2C_DATA_LEN - 1
+    self.assertEqual(self.i2c.regmapWrite(reg, test_byte),
+                     m.SUCCESS,
+                     "I2C regmapWrite() did not return success")
+    self.assertEqual(self.i2c.readReg(reg),
+                     test_byte,
+                     "I2C readReg() after regmapWrite() returned unexpected data")
+    self.assertEqual(self.i2c.regmapRead(reg),
+                     test_byte,
+                     "I2C regmapRead() after regmapWrite() returned unexpected data")
+
+  def test_i2c_regmap_update_bits(self):
+    reg = MRAA_MOCK_I2C_DATA_LEN - 2
+    self.i2c.writeReg(reg, 0xF0)
+    self.assertEqual(self.i2c.regmapUpdateBits(reg, 0x0F, 0x05),
+                     m.SUCCESS,
+                     "I2C regmapUpdateBits() did not return success")
+    self.assertEqual(self.i2c.readReg(reg),
+                     0xF5,
+                     "I2C readReg() after regmapUpdateBits() returned unexpected data")
+
+  def test_i2c_regmap_sync_invalidate(self):
+    self.assertEqual(self.i2c.regmapSync(),
+                     m.SUCCESS,
+                     "I2C regmapSync() without a register map did not return success")
+    self.assertEqual(self.i2c.regmapInvalidate(),
+                     m.SUCCESS,
+                     "I2C regmapInvalidate() without a register map did not return success")
+
+  def test_i2c_regmap_cache_only_without_map(self):
+    self.assertEqual(self.i2c.regmapCacheOnly(True),
+                     m.ERROR_INVALID_RESOURCE,
+                     "I2C regmapCacheOnly() without a register map did not return an error")
+
+if __name__ == "__main__":
+  u.main()
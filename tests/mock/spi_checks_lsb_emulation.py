@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2018 Intel Corporation.
+#
+# Permission is hereby granted, free of charge, to any person obtaining
+# a copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice shall be
+# included in all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+# NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+# LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+# OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+# WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+import mraa as m
+import unittest as u
+
+from spi_checks_shared import *
+
+# The mock controller shifts msb first only, lsb first is emulated by
+# reversing the bits of every byte, 0xAB reversed is 0xD5
+MOCK_SPI_REPLY_DATA_MODIFIER_BYTE_LSB = 0xD5
+
+class SpiChecksLsbEmulation(u.TestCase):
+  def setUp(self):
+    self.spi = m.Spi(MRAA_SPI_BUS_NUM)
+    self.spi.lsbmode(True)
+
+  def tearDown(self):
+    del self.spi
+
+  def test_spi_write_lsb(self):
+    DATA_TO_WRITE = bytearray([0x01 << i for i in range(MOCK_SPI_TEST_DATA_LEN)])
+    DATA_TO_EXPECT = bytearray([(0x01 << i) ^ MOCK_SPI_REPLY_DATA_MODIFIER_BYTE_LSB for i in range(MOCK_SPI_TEST_DATA_LEN)])
+    self.assertEqual(self.spi.write(DATA_TO_WRITE),
+                     DATA_TO_EXPECT,
+                     "SPI write() in lsb mode returned unexpected data")
+
+  def test_spi_write_byte_lsb(self):
+    TEST_BYTE = 0x01
+    self.assertEqual(self.spi.writeByte(TEST_BYTE),
+                     TEST_BYTE ^ MOCK_SPI_REPLY_DATA_MODIFIER_BYTE_LSB,
+                     "SPI writeByte() in lsb mode returned unexpected data")
+
+  def test_spi_write_byte_msb_again(self):
+    TEST_BYTE = 0x01
+    self.spi.lsbmode(False)
+    self.assertEqual(self.spi.writeByte(TEST_BYTE),
+                     TEST_BYTE ^ MOCK_SPI_REPLY_DATA_MODIFIER_BYTE,
+                     "SPI writeByte() after leaving lsb mode returned unexpected data")
+
+  def test_spi_write_word_msb_first(self):
+    TEST_WORD = 0x1234
+    self.spi.lsbmode(False)
+    self.assertEqual(self.spi.wordOrder(m.SPI_WORD_MSB_FIRST),
+                     m.SUCCESS,
+                     "Setting word order did not return success")
+    # The word goes out byte swapped and the reply is swapped back
+    self.assertEqual(self.spi.writeWord(TEST_WORD),
+                     TEST_WORD ^ 0xBAAB,
+                     "SPI writeWord() msb first returned unexpected data")
+
+if __name__ == "__main__":
+  u.main()
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mraa/gpio.h"
+#include "gtest/gtest.h"
+#include <stdlib.h>
+
+/* The mock platform has a single gpio, pin 0, and no chardev interface */
+#define MOCK_GPIO_PIN 0
+#define MOCK_AIO_PIN 1
+
+/* MRAA gpio C API test fixture */
+class mraa_gpio_h_unit : public ::testing::Test
+{
+};
+
+/* Bulk init hands back one usable context per pin. */
+TEST_F(mraa_gpio_h_unit, test_init_bulk)
+{
+    int pins[] = { MOCK_GPIO_PIN };
+    mraa_gpio_context* devs = mraa_gpio_init_bulk(pins, 1);
+    ASSERT_TRUE(devs != NULL);
+    ASSERT_TRUE(devs[0] != NULL);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_dir(devs[0], MRAA_GPIO_OUT));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_write(devs[0], 1));
+    ASSERT_EQ(1, mraa_gpio_read(devs[0]));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_close(devs[0]));
+    free(devs);
+}
+
+/* Bulk init fails as a whole if one pin is not a gpio. */
+TEST_F(mraa_gpio_h_unit, test_init_bulk_invalid)
+{
+    int pins[] = { MOCK_GPIO_PIN, MOCK_AIO_PIN };
+    ASSERT_TRUE(mraa_gpio_init_bulk(pins, 2) == NULL);
+    ASSERT_TRUE(mraa_gpio_init_bulk(pins, 0) == NULL);
+    ASSERT_TRUE(mraa_gpio_init_bulk(NULL, 1) == NULL);
+
+    /* The pin that was fine is still free */
+    mraa_gpio_context dev = mraa_gpio_init(MOCK_GPIO_PIN);
+    ASSERT_TRUE(dev != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_close(dev));
+}
+
+/* Masked writes only touch the selected pins, masked reads only report them. */
+TEST_F(mraa_gpio_h_unit, test_write_read_mask)
+{
+    int pins[] = { MOCK_GPIO_PIN };
+    uint32_t values = 0xFFFFFFFF;
+    mraa_gpio_context dev = mraa_gpio_init_multi(pins, 1);
+    ASSERT_TRUE(dev != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_dir(dev, MRAA_GPIO_OUT));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_write_mask(dev, 0x1, 0x1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_read_mask(dev, 0x1, &values));
+    ASSERT_EQ(0x1u, values);
+
+    /* Pins outside the mask are left alone */
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_write_mask(dev, 0x0, 0x0));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_read_mask(dev, 0x1, &values));
+    ASSERT_EQ(0x1u, values);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_write_mask(dev, 0x1, 0x0));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_read_mask(dev, 0x1, &values));
+    ASSERT_EQ(0x0u, values);
+
+    /* Unselected bits read as 0 */
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_write_mask(dev, 0x1, 0x1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_read_mask(dev, 0x0, &values));
+    ASSERT_EQ(0x0u, values);
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_gpio_read_mask(dev, 0x1, NULL));
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_gpio_write_mask(NULL, 0x1, 0x1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_close(dev));
+}
+
+/* The glitch filter can be set and cleared on any context, debounce needs the v2 chardev. */
+TEST_F(mraa_gpio_h_unit, test_filter)
+{
+    mraa_gpio_context dev = mraa_gpio_init(MOCK_GPIO_PIN);
+    ASSERT_TRUE(dev != NULL);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_glitch_filter(dev, 1000, 0, 0));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_glitch_filter(dev, 0, 500, 2000));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_glitch_filter(dev, 0, 0, 0));
+    /* Clearing a filter that was never set is fine too */
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_glitch_filter(dev, 0, 0, 0));
+
+    ASSERT_EQ(MRAA_ERROR_FEATURE_NOT_SUPPORTED, mraa_gpio_debounce(dev, 1000));
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_gpio_glitch_filter(NULL, 1000, 0, 0));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_close(dev));
+}
+
+/* Capture needs kernel edge timestamps, which the mock platform doesn't have. */
+TEST_F(mraa_gpio_h_unit, test_capture)
+{
+    mraa_gpio_capture_stats stats[1];
+    mraa_gpio_context dev = mraa_gpio_init(MOCK_GPIO_PIN);
+    ASSERT_TRUE(dev != NULL);
+
+    ASSERT_EQ(MRAA_ERROR_FEATURE_NOT_SUPPORTED, mraa_gpio_capture_start(dev, MRAA_GPIO_EDGE_BOTH, 100));
+    ASSERT_EQ(MRAA_ERROR_INVALID_RESOURCE, mraa_gpio_capture_read(dev, stats));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_capture_stop(dev));
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_gpio_capture_start(NULL, MRAA_GPIO_EDGE_BOTH, 100));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_gpio_close(dev));
+}
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mraa/i2c.h"
+#include "gtest/gtest.h"
+#include <string.h>
+#include <unistd.h>
+
+/* These are defined in mock_board_i2c.h */
+#define MOCK_I2C_BUS 0
+#define MOCK_I2C_ADDR 0x33
+#define MOCK_I2C_DATA_LEN 10
+#define MOCK_I2C_DATA_INIT_BYTE 0xAB
+
+/* MRAA i2c C API test fixture */
+class mraa_i2c_h_unit : public ::testing::Test
+{
+    protected:
+        /* Per-test setup logic if needed */
+        virtual void SetUp()
+        {
+            i2c = mraa_i2c_init(MOCK_I2C_BUS);
+            ASSERT_TRUE(i2c != NULL);
+            ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_address(i2c, MOCK_I2C_ADDR));
+        }
+
+        /* Per-test tear-down logic if needed */
+        virtual void TearDown()
+        {
+            mraa_i2c_stop(i2c);
+        }
+
+        mraa_i2c_context i2c;
+};
+
+/* A register write followed by a repeated start read */
+TEST_F(mraa_i2c_h_unit, test_transfer_register_read)
+{
+    uint8_t reg = 3;
+    uint8_t data[2] = { 0 };
+    mraa_i2c_msg_t msgs[] = { { MOCK_I2C_ADDR, 0, 1, &reg },
+                              { MOCK_I2C_ADDR, MRAA_I2C_MSG_RD, 2, data } };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_write_byte_data(i2c, 0x5A, reg));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_transfer(i2c, msgs, 2));
+    ASSERT_EQ(0x5A, data[0]);
+    ASSERT_EQ(MOCK_I2C_DATA_INIT_BYTE, data[1]);
+}
+
+/* Messages to another slave fail and leave the context's address alone */
+TEST_F(mraa_i2c_h_unit, test_transfer_other_slave)
+{
+    uint8_t data[1];
+    mraa_i2c_msg_t msgs[] = { { MOCK_I2C_ADDR + 1, MRAA_I2C_MSG_RD, 1, data } };
+
+    ASSERT_NE(MRAA_SUCCESS, mraa_i2c_transfer(i2c, msgs, 1));
+    ASSERT_EQ(MOCK_I2C_DATA_INIT_BYTE, mraa_i2c_read_byte_data(i2c, 0));
+}
+
+TEST_F(mraa_i2c_h_unit, test_transfer_invalid)
+{
+    uint8_t data[1];
+    mraa_i2c_msg_t nostart[] = { { MOCK_I2C_ADDR, MRAA_I2C_MSG_NOSTART, 1, data } };
+    mraa_i2c_msg_t nostart_rd[] = { { MOCK_I2C_ADDR, 0, 1, data },
+                                    { MOCK_I2C_ADDR, MRAA_I2C_MSG_RD | MRAA_I2C_MSG_NOSTART, 1, data } };
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_i2c_transfer(NULL, nostart, 1));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_i2c_transfer(i2c, NULL, 1));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_i2c_transfer(i2c, nostart, 0));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_i2c_transfer(i2c, nostart, MRAA_I2C_TRANSFER_MAX_MSGS + 1));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_i2c_transfer(i2c, nostart, 1));
+    /* The mock bus can't continue a read without a start */
+    ASSERT_EQ(MRAA_ERROR_FEATURE_NOT_SUPPORTED, mraa_i2c_transfer(i2c, nostart_rd, 2));
+}
+
+/* Cached registers are read once, cache only writes reach the device on sync */
+TEST_F(mraa_i2c_h_unit, test_regmap_cache_only)
+{
+    mraa_i2c_reg_t regs[] = { { 1, 0 }, { 2, 0 }, { 4, MRAA_I2C_REG_VOLATILE } };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_write_byte_data(i2c, 0x10, 1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap(i2c, regs, 3));
+    ASSERT_EQ(0x10, mraa_i2c_regmap_read(i2c, 1));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_cache_only(i2c, 1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_write(i2c, 1, 0x55));
+    ASSERT_EQ(0x55, mraa_i2c_regmap_read(i2c, 1));
+    ASSERT_EQ(0x10, mraa_i2c_read_byte_data(i2c, 1));
+    /* Volatile registers can't be held back */
+    ASSERT_EQ(MRAA_ERROR_INVALID_RESOURCE, mraa_i2c_regmap_write(i2c, 4, 0x01));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_cache_only(i2c, 0));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_sync(i2c));
+    ASSERT_EQ(0x55, mraa_i2c_read_byte_data(i2c, 1));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap(i2c, NULL, 0));
+}
+
+TEST_F(mraa_i2c_h_unit, test_regmap_update_bits)
+{
+    mraa_i2c_reg_t regs[] = { { 2, 0 } };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_write_byte_data(i2c, 0xF0, 2));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap(i2c, regs, 1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_update_bits(i2c, 2, 0x0F, 0x05));
+    ASSERT_EQ(0xF5, mraa_i2c_read_byte_data(i2c, 2));
+    ASSERT_EQ(0xF5, mraa_i2c_regmap_read(i2c, 2));
+}
+
+/* A transfer drops only the registers it writes from the cache */
+TEST_F(mraa_i2c_h_unit, test_regmap_transfer_invalidates)
+{
+    mraa_i2c_reg_t regs[] = { { 5, 0 }, { 6, 0 }, { 7, 0 } };
+    uint8_t write[] = { 6, 0x77 };
+    uint8_t reg = 5;
+    uint8_t data[1];
+    mraa_i2c_msg_t write_msgs[] = { { MOCK_I2C_ADDR, 0, 2, write } };
+    mraa_i2c_msg_t read_msgs[] = { { MOCK_I2C_ADDR, 0, 1, &reg },
+                                   { MOCK_I2C_ADDR, MRAA_I2C_MSG_RD, 1, data } };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap(i2c, regs, 3));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_cache_only(i2c, 1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_write(i2c, 5, 0x55));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_write(i2c, 6, 0x66));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_write(i2c, 7, 0x77));
+
+    /* Only moving the register pointer changes nothing */
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_transfer(i2c, read_msgs, 2));
+    ASSERT_EQ(0x55, mraa_i2c_regmap_read(i2c, 5));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_transfer(i2c, write_msgs, 1));
+    ASSERT_EQ(0x55, mraa_i2c_regmap_read(i2c, 5));
+    ASSERT_EQ(0x77, mraa_i2c_regmap_read(i2c, 7));
+    /* Dropped, and the device can't be asked in cache only mode */
+    ASSERT_EQ(-1, mraa_i2c_regmap_read(i2c, 6));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap_cache_only(i2c, 0));
+    ASSERT_EQ(mraa_i2c_read_byte_data(i2c, 6), mraa_i2c_regmap_read(i2c, 6));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_regmap(i2c, NULL, 0));
+}
+
+static char sched_order[16];
+static int sched_done;
+
+static void
+sched_mark(mraa_result_t result, void* args)
+{
+    sched_order[sched_done++] = *(const char*) args;
+}
+
+static void
+sched_block(mraa_result_t result, void* args)
+{
+    usleep(50000);
+    sched_mark(result, args);
+}
+
+TEST_F(mraa_i2c_h_unit, test_submit_wait)
+{
+    uint8_t reg = 0;
+    uint8_t data[2] = { 0 };
+    mraa_i2c_msg_t msgs[] = { { MOCK_I2C_ADDR, 0, 1, &reg },
+                              { MOCK_I2C_ADDR, MRAA_I2C_MSG_RD, 2, data } };
+    mraa_i2c_request_t req = { msgs, 2, MRAA_I2C_PRIO_NORMAL, 0, 0, NULL, NULL };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_write_byte_data(i2c, 0x42, 0));
+    mraa_i2c_job job = mraa_i2c_submit(i2c, &req);
+    ASSERT_TRUE(job != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(job, -1));
+    ASSERT_EQ(0x42, data[0]);
+    ASSERT_EQ(MOCK_I2C_DATA_INIT_BYTE, data[1]);
+
+    ASSERT_TRUE(mraa_i2c_submit(i2c, NULL) == NULL);
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_i2c_job_wait(NULL, -1));
+}
+
+/* Queued jobs run by priority, then deadline, and expired ones fail */
+TEST_F(mraa_i2c_h_unit, test_submit_priority)
+{
+    uint8_t write[] = { 9, 0x01 };
+    mraa_i2c_msg_t msgs[] = { { MOCK_I2C_ADDR, 0, 2, write } };
+    mraa_i2c_request_t first = { msgs, 1, MRAA_I2C_PRIO_LOW, 0, 0, sched_block, (void*) "F" };
+    mraa_i2c_request_t low = { msgs, 1, MRAA_I2C_PRIO_LOW, 0, 0, sched_mark, (void*) "L" };
+    mraa_i2c_request_t normal = { msgs, 1, MRAA_I2C_PRIO_NORMAL, 0, 0, sched_mark, (void*) "N" };
+    mraa_i2c_request_t high = { msgs, 1, MRAA_I2C_PRIO_HIGH, 0, 0, sched_mark, (void*) "H" };
+    mraa_i2c_request_t late = { msgs, 1, MRAA_I2C_PRIO_HIGH, 1, 0, sched_mark, (void*) "D" };
+
+    memset(sched_order, 0, sizeof(sched_order));
+    sched_done = 0;
+
+    /* The worker sits in the first job's callback while the others queue up */
+    mraa_i2c_job blocker = mraa_i2c_submit(i2c, &first);
+    ASSERT_TRUE(blocker != NULL);
+    usleep(10000);
+    mraa_i2c_job jobs[] = { mraa_i2c_submit(i2c, &low), mraa_i2c_submit(i2c, &normal),
+                            mraa_i2c_submit(i2c, &high), mraa_i2c_submit(i2c, &late) };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(blocker, -1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(jobs[0], 1000));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(jobs[1], 1000));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(jobs[2], 1000));
+    ASSERT_EQ(MRAA_ERROR_NO_RESOURCES, mraa_i2c_job_wait(jobs[3], 1000));
+    ASSERT_STREQ("FDHNL", sched_order);
+}
+
+/* Adjacent register reads may be merged, every job still gets its own bytes */
+TEST_F(mraa_i2c_h_unit, test_submit_coalesce)
+{
+    uint8_t write[] = { 9, 0x01 };
+    uint8_t regs[] = { 0, 2, 4 };
+    uint8_t data[3][2];
+    mraa_i2c_msg_t block[] = { { MOCK_I2C_ADDR, 0, 2, write } };
+    mraa_i2c_msg_t msgs[3][2];
+    mraa_i2c_request_t first = { block, 1, MRAA_I2C_PRIO_NORMAL, 0, 0, sched_block, (void*) "F" };
+    mraa_i2c_job jobs[3];
+
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_write_byte_data(i2c, 0x10 + i, i));
+    }
+
+    memset(sched_order, 0, sizeof(sched_order));
+    sched_done = 0;
+
+    mraa_i2c_job blocker = mraa_i2c_submit(i2c, &first);
+    ASSERT_TRUE(blocker != NULL);
+    usleep(10000);
+    for (int i = 0; i < 3; i++) {
+        msgs[i][0] = { MOCK_I2C_ADDR, 0, 1, &regs[i] };
+        msgs[i][1] = { MOCK_I2C_ADDR, MRAA_I2C_MSG_RD, 2, data[i] };
+        /* The last read has another priority and is not merged */
+        mraa_i2c_request_t req = { msgs[i], 2, i == 2 ? MRAA_I2C_PRIO_LOW : MRAA_I2C_PRIO_NORMAL, 0,
+                                   MRAA_I2C_REQ_COALESCE, NULL, NULL };
+        jobs[i] = mraa_i2c_submit(i2c, &req);
+        ASSERT_TRUE(jobs[i] != NULL);
+    }
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(blocker, -1));
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_job_wait(jobs[i], 1000));
+    }
+    /* The blocking job's raw write went to register 0 on the mock device */
+    ASSERT_EQ(9, data[0][0]);
+    ASSERT_EQ(0x01, data[0][1]);
+    ASSERT_EQ(0x12, data[1][0]);
+    ASSERT_EQ(0x13, data[1][1]);
+    ASSERT_EQ(MOCK_I2C_DATA_INIT_BYTE, data[2][0]);
+}
+
+/* Stopping a context waits for the callback of its running job */
+TEST_F(mraa_i2c_h_unit, test_stop_waits_for_callback)
+{
+    uint8_t write[] = { 9, 0x01 };
+    mraa_i2c_msg_t msgs[] = { { MOCK_I2C_ADDR, 0, 2, write } };
+    mraa_i2c_request_t req = { msgs, 1, MRAA_I2C_PRIO_NORMAL, 0, 0, sched_block, (void*) "S" };
+    mraa_i2c_context other = mraa_i2c_init(MOCK_I2C_BUS);
+    ASSERT_TRUE(other != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_address(other, MOCK_I2C_ADDR));
+
+    memset(sched_order, 0, sizeof(sched_order));
+    sched_done = 0;
+
+    mraa_i2c_job_release(mraa_i2c_submit(other, &req));
+    usleep(10000);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_i2c_stop(other));
+    ASSERT_EQ(1, sched_done);
+}
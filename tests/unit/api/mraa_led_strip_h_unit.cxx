@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mraa/led_strip.h"
+#include "mraa/spi.h"
+#include "mraa_internal_types.h"
+#include "gtest/gtest.h"
+#include <string.h>
+
+#define MOCK_SPI_BUS 0
+
+/* Encoded colour bytes, WS2812 bits are 110/100, SK6812 bits 1100/1000 */
+static const uint8_t ws_00[] = { 0x92, 0x49, 0x24 };
+static const uint8_t ws_ff[] = { 0xDB, 0x6D, 0xB6 };
+static const uint8_t ws_0f[] = { 0x92, 0x4D, 0xB6 };
+static const uint8_t sk_00[] = { 0x88, 0x88, 0x88, 0x88 };
+static const uint8_t sk_ff[] = { 0xCC, 0xCC, 0xCC, 0xCC };
+static const uint8_t sk_0f[] = { 0x88, 0x88, 0xCC, 0xCC };
+
+/* MRAA led strip C API test fixture, the mock spi keeps the last frame sent */
+class mraa_led_strip_h_unit : public ::testing::Test
+{
+    protected:
+        /* Per-test setup logic if needed */
+        virtual void SetUp()
+        {
+            spi = mraa_spi_init(MOCK_SPI_BUS);
+            ASSERT_TRUE(spi != NULL);
+        }
+
+        /* Per-test tear-down logic if needed */
+        virtual void TearDown()
+        {
+            mraa_spi_stop(spi);
+        }
+
+        const uint8_t* frame(int offset)
+        {
+            return spi->mock_last_tx + offset;
+        }
+
+        mraa_spi_context spi;
+};
+
+/* GRB on the wire, a leading zero byte and a zero latch period */
+TEST_F(mraa_led_strip_h_unit, test_ws2812)
+{
+    const uint8_t rgb[] = { 0xFF, 0x00, 0x0F, 0x00, 0x00, 0x00 };
+    const uint8_t grb[] = { 0x00, 0xFF, 0x0F, 0x00, 0x00, 0x00 };
+    mraa_led_strip_context strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_WS2812, 2);
+    ASSERT_TRUE(strip != NULL);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgb, sizeof(rgb), MRAA_LED_STRIP_RGB));
+    /* 1 + 2 pixels * 9 + 300us at 2.4MHz */
+    ASSERT_EQ(1 + 18 + 90, spi->mock_last_tx_len);
+    ASSERT_EQ(0, frame(0)[0]);
+    ASSERT_EQ(0, memcmp(frame(1), ws_00, 3));
+    ASSERT_EQ(0, memcmp(frame(4), ws_ff, 3));
+    ASSERT_EQ(0, memcmp(frame(7), ws_0f, 3));
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(0, memcmp(frame(10 + i * 3), ws_00, 3));
+    }
+    for (int i = 19; i < spi->mock_last_tx_len; i++) {
+        ASSERT_EQ(0, frame(0)[i]);
+    }
+
+    uint8_t first[1 + 18];
+    memcpy(first, frame(0), sizeof(first));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, grb, sizeof(grb), MRAA_LED_STRIP_GRB));
+    ASSERT_EQ(0, memcmp(first, frame(0), sizeof(first)));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+}
+
+/* White is the fourth channel, zero for pixels without one */
+TEST_F(mraa_led_strip_h_unit, test_sk6812_rgbw)
+{
+    const uint8_t rgbw[] = { 0x00, 0xFF, 0x00, 0x0F };
+    const uint8_t rgb[] = { 0x00, 0xFF, 0x00 };
+    mraa_led_strip_context strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_SK6812, 1);
+    ASSERT_TRUE(strip != NULL);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgbw, sizeof(rgbw), MRAA_LED_STRIP_RGBW));
+    /* 1 + 1 pixel * 16 + 300us at 3.2MHz */
+    ASSERT_EQ(1 + 16 + 120, spi->mock_last_tx_len);
+    ASSERT_EQ(0, memcmp(frame(1), sk_ff, 4));
+    ASSERT_EQ(0, memcmp(frame(5), sk_00, 4));
+    ASSERT_EQ(0, memcmp(frame(9), sk_00, 4));
+    ASSERT_EQ(0, memcmp(frame(13), sk_0f, 4));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgb, sizeof(rgb), MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(0, memcmp(frame(1), sk_ff, 4));
+    ASSERT_EQ(0, memcmp(frame(13), sk_00, 4));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+}
+
+/* Start frame, BGR pixels at full global brightness, end frame; white is dropped */
+TEST_F(mraa_led_strip_h_unit, test_apa102)
+{
+    const uint8_t rgbw[] = { 0x01, 0x02, 0x03, 0xFF, 0x10, 0x20, 0x30, 0xFF };
+    const uint8_t expected[] = { 0x00, 0x00, 0x00, 0x00, 0xFF, 0x03, 0x02, 0x01, 0xFF, 0x30, 0x20,
+                                 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    mraa_led_strip_context strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_APA102, 2);
+    ASSERT_TRUE(strip != NULL);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgbw, sizeof(rgbw), MRAA_LED_STRIP_RGBW));
+    ASSERT_EQ((int) sizeof(expected), spi->mock_last_tx_len);
+    ASSERT_EQ(0, memcmp(expected, frame(0), sizeof(expected)));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+}
+
+/* Brightness scales after the gamma correction, both rounded */
+TEST_F(mraa_led_strip_h_unit, test_gamma_brightness)
+{
+    const uint8_t rgb[] = { 0xFF, 0x80, 0x00 };
+    mraa_led_strip_context strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_APA102, 1);
+    ASSERT_TRUE(strip != NULL);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_brightness(strip, 128));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgb, sizeof(rgb), MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(0x00, frame(5)[0]);
+    ASSERT_EQ(0x40, frame(6)[0]);
+    ASSERT_EQ(0x80, frame(7)[0]);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_gamma(strip, 2.0f));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgb, sizeof(rgb), MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(0x20, frame(6)[0]);
+    ASSERT_EQ(0x80, frame(7)[0]);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_brightness(strip, 255));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_show(strip, rgb, sizeof(rgb), MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(0x40, frame(6)[0]);
+    ASSERT_EQ(0xFF, frame(7)[0]);
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_led_strip_gamma(strip, 0.0f));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+}
+
+/* One wire frames have to fit the spidev bufsiz, 4096 bytes by default */
+TEST_F(mraa_led_strip_h_unit, test_bufsiz_limit)
+{
+    spi->bufsiz = 4096;
+
+    mraa_led_strip_context strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_WS2812, 445);
+    ASSERT_TRUE(strip != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+    ASSERT_TRUE(mraa_led_strip_init(spi, MRAA_LED_STRIP_WS2812, 446) == NULL);
+    ASSERT_TRUE(mraa_led_strip_init(spi, MRAA_LED_STRIP_WS2812, 1000) == NULL);
+
+    strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_SK6812, 248);
+    ASSERT_TRUE(strip != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+    ASSERT_TRUE(mraa_led_strip_init(spi, MRAA_LED_STRIP_SK6812, 249) == NULL);
+
+    /* APA102 has a clock, its frames may be split */
+    strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_APA102, 1000);
+    ASSERT_TRUE(strip != NULL);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+}
+
+TEST_F(mraa_led_strip_h_unit, test_invalid)
+{
+    const uint8_t rgb[] = { 0x00, 0x00, 0x00 };
+
+    ASSERT_TRUE(mraa_led_strip_init(NULL, MRAA_LED_STRIP_WS2812, 1) == NULL);
+    ASSERT_TRUE(mraa_led_strip_init(spi, MRAA_LED_STRIP_WS2812, 0) == NULL);
+    ASSERT_TRUE(mraa_led_strip_init(spi, (mraa_led_strip_type_t) 3, 1) == NULL);
+
+    mraa_led_strip_context strip = mraa_led_strip_init(spi, MRAA_LED_STRIP_WS2812, 1);
+    ASSERT_TRUE(strip != NULL);
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_led_strip_show(strip, rgb, 2, MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_led_strip_show(strip, rgb, 3, MRAA_LED_STRIP_RGBW));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_led_strip_show(strip, NULL, 3, MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_led_strip_show(NULL, rgb, 3, MRAA_LED_STRIP_RGB));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_led_strip_close(strip));
+}
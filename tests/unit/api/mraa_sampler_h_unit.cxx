@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mraa/aio.h"
+#include "mraa/i2c.h"
+#include "mraa/sampler.h"
+#include "gtest/gtest.h"
+#include <unistd.h>
+
+/* These are defined in mock_board_i2c.h */
+#define MOCK_I2C_BUS 0
+#define MOCK_I2C_ADDR 0x33
+#define MOCK_I2C_DATA_INIT_BYTE 0xAB
+#define MOCK_AIO_PIN 0
+
+/* MRAA sampler C API test fixture */
+class mraa_sampler_h_unit : public ::testing::Test
+{
+    protected:
+        /* Per-test setup logic if needed */
+        virtual void SetUp()
+        {
+            sampler = mraa_sampler_init();
+            ASSERT_TRUE(sampler != NULL);
+            i2c = mraa_i2c_init(MOCK_I2C_BUS);
+            ASSERT_TRUE(i2c != NULL);
+        }
+
+        /* Per-test tear-down logic if needed */
+        virtual void TearDown()
+        {
+            mraa_sampler_close(sampler);
+            mraa_i2c_stop(i2c);
+        }
+
+        mraa_sampler_context sampler;
+        mraa_i2c_context i2c;
+};
+
+/* A 1 kHz register read fills the ring with timestamped samples */
+TEST_F(mraa_sampler_h_unit, test_i2c_job)
+{
+    mraa_sampler_job_t job = { MRAA_SAMPLER_I2C, i2c, MOCK_I2C_ADDR, 0, 4, 1000, 16 };
+    mraa_sampler_sample_t samples[16];
+    mraa_sampler_stats_t stats;
+
+    int id = mraa_sampler_add(sampler, &job);
+    ASSERT_EQ(0, id);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_sampler_start(sampler));
+    /* Jobs can't be added while running */
+    ASSERT_EQ(-1, mraa_sampler_add(sampler, &job));
+    usleep(20000);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_sampler_stop(sampler));
+
+    int n = mraa_sampler_read(sampler, id, samples, 16);
+    ASSERT_TRUE(n > 1);
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(4, samples[i].len);
+        ASSERT_EQ(MOCK_I2C_DATA_INIT_BYTE, samples[i].data[0]);
+        ASSERT_EQ(MOCK_I2C_DATA_INIT_BYTE, samples[i].data[3]);
+        if (i > 0) {
+            ASSERT_TRUE(samples[i].timestamp_ns > samples[i - 1].timestamp_ns);
+        }
+    }
+    /* Drained */
+    ASSERT_EQ(0, mraa_sampler_read(sampler, id, samples, 16));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_sampler_get_stats(sampler, id, &stats));
+    ASSERT_TRUE(stats.samples >= (unsigned long) n);
+    ASSERT_EQ(0UL, stats.errors);
+}
+
+TEST_F(mraa_sampler_h_unit, test_aio_job)
+{
+    mraa_aio_context aio = mraa_aio_init(MOCK_AIO_PIN);
+    ASSERT_TRUE(aio != NULL);
+    mraa_sampler_job_t job = { MRAA_SAMPLER_AIO, aio, 0, 0, 0, 2000, 0 };
+    mraa_sampler_sample_t samples[4];
+
+    int id = mraa_sampler_add(sampler, &job);
+    ASSERT_EQ(0, id);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_sampler_start(sampler));
+    usleep(10000);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_sampler_stop(sampler));
+
+    int n = mraa_sampler_read(sampler, id, samples, 4);
+    ASSERT_TRUE(n > 0);
+    ASSERT_EQ(sizeof(int), samples[0].len);
+
+    mraa_sampler_close(sampler);
+    sampler = NULL;
+    mraa_aio_close(aio);
+}
+
+TEST_F(mraa_sampler_h_unit, test_invalid)
+{
+    mraa_sampler_job_t job = { MRAA_SAMPLER_I2C, i2c, MOCK_I2C_ADDR, 0, 0, 1000, 0 };
+    mraa_sampler_sample_t sample;
+    mraa_sampler_stats_t stats;
+
+    ASSERT_EQ(-1, mraa_sampler_add(NULL, &job));
+    ASSERT_EQ(-1, mraa_sampler_add(sampler, NULL));
+    /* Zero length */
+    ASSERT_EQ(-1, mraa_sampler_add(sampler, &job));
+    job.len = MRAA_SAMPLER_MAX_SAMPLE_LEN + 1;
+    ASSERT_EQ(-1, mraa_sampler_add(sampler, &job));
+    job.len = 1;
+    job.period_us = 0;
+    ASSERT_EQ(-1, mraa_sampler_add(sampler, &job));
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_RESOURCE, mraa_sampler_start(sampler));
+    ASSERT_EQ(-1, mraa_sampler_read(sampler, 0, &sample, 1));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_sampler_get_stats(sampler, 0, &stats));
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "mraa/spi.h"
+#include "gtest/gtest.h"
+#include <string.h>
+
+/* The mock spi controller answers every byte with tx ^ 0xAB and every word
+ * with tx ^ 0xABBA, see mock_board_spi.c */
+#define MOCK_SPI_BUS 0
+#define MOCK_SPI_REPLY_BYTE 0xAB
+
+/* MRAA spi C API test fixture */
+class mraa_spi_h_unit : public ::testing::Test
+{
+    protected:
+        /* Per-test setup logic if needed */
+        virtual void SetUp()
+        {
+            spi = mraa_spi_init(MOCK_SPI_BUS);
+            ASSERT_TRUE(spi != NULL);
+        }
+
+        /* Per-test tear-down logic if needed */
+        virtual void TearDown()
+        {
+            mraa_spi_stop(spi);
+        }
+
+        mraa_spi_context spi;
+};
+
+/* Segments are clocked out back to back, NULL tx sends zeros */
+TEST_F(mraa_spi_h_unit, test_transfer_multi)
+{
+    uint8_t cmd[] = { 0x01, 0x02 };
+    uint8_t rx_cmd[2] = { 0 };
+    uint8_t rx_data[3] = { 0 };
+    mraa_spi_segment_t segs[3];
+
+    memset(segs, 0, sizeof(segs));
+    segs[0].tx_buf = cmd;
+    segs[0].rx_buf = rx_cmd;
+    segs[0].len = 2;
+    segs[1].rx_buf = rx_data;
+    segs[1].len = 3;
+    /* No rx buffer, the reply is thrown away */
+    segs[2].tx_buf = cmd;
+    segs[2].len = 2;
+    segs[2].cs_change = 1;
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_transfer_multi(spi, segs, 3));
+    ASSERT_EQ(0x01 ^ MOCK_SPI_REPLY_BYTE, rx_cmd[0]);
+    ASSERT_EQ(0x02 ^ MOCK_SPI_REPLY_BYTE, rx_cmd[1]);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(MOCK_SPI_REPLY_BYTE, rx_data[i]);
+    }
+    /* tx is left alone */
+    ASSERT_EQ(0x01, cmd[0]);
+}
+
+TEST_F(mraa_spi_h_unit, test_transfer_multi_invalid)
+{
+    mraa_spi_segment_t segs[MRAA_SPI_TRANSFER_MAX_SEGMENTS + 1];
+
+    memset(segs, 0, sizeof(segs));
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_spi_transfer_multi(NULL, segs, 1));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_spi_transfer_multi(spi, NULL, 1));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_spi_transfer_multi(spi, segs, 0));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER,
+              mraa_spi_transfer_multi(spi, segs, MRAA_SPI_TRANSFER_MAX_SEGMENTS + 1));
+}
+
+/* Every buffer holds transfers_per_buffer replies to the template */
+TEST_F(mraa_spi_h_unit, test_stream)
+{
+    const uint8_t cmd[] = { 0x00, 0x01, 0x02, 0x03 };
+    mraa_spi_stream_config_t config = { cmd, 4, 2, 3, 0 };
+    mraa_spi_stream_buffer_t buffer;
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_stream_start(spi, &config));
+    ASSERT_EQ(MRAA_ERROR_INVALID_RESOURCE, mraa_spi_stream_start(spi, &config));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_stream_get(spi, &buffer, 1000));
+    ASSERT_EQ(8, buffer.length);
+    ASSERT_EQ(0UL, buffer.sequence);
+    ASSERT_EQ(MOCK_SPI_REPLY_BYTE, buffer.data[0]);
+    ASSERT_EQ(0x01 ^ MOCK_SPI_REPLY_BYTE, buffer.data[5]);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_stream_release(spi));
+    /* Nothing is held any more */
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_spi_stream_release(spi));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_stream_get(spi, &buffer, 1000));
+    ASSERT_TRUE(buffer.sequence > 0);
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_stream_release(spi));
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_stream_stop(spi));
+}
+
+TEST_F(mraa_spi_h_unit, test_stream_invalid)
+{
+    const uint8_t cmd[] = { 0x00 };
+    mraa_spi_stream_config_t config = { cmd, 1, 1, 1, 0 };
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_HANDLE, mraa_spi_stream_start(NULL, &config));
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_spi_stream_start(spi, NULL));
+    /* A ring needs at least two buffers */
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_spi_stream_start(spi, &config));
+}
+
+/* The mock controller only shifts msb first, lsb first is done in software */
+TEST_F(mraa_spi_h_unit, test_lsb_emulation)
+{
+    uint8_t tx[] = { 0x01, 0x80, 0x0F };
+    uint8_t rx[3] = { 0 };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_lsbmode(spi, 1));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_transfer_buf(spi, tx, rx, 3));
+    /* The reverse of 0xAB is 0xD5 */
+    ASSERT_EQ(0x01 ^ 0xD5, rx[0]);
+    ASSERT_EQ(0x80 ^ 0xD5, rx[1]);
+    ASSERT_EQ(0x0F ^ 0xD5, rx[2]);
+    /* tx is restored after the reversal */
+    ASSERT_EQ(0x01, tx[0]);
+    ASSERT_EQ(0x80, tx[1]);
+    ASSERT_EQ(0x0F, tx[2]);
+
+    ASSERT_EQ(0x01 ^ 0xD5, mraa_spi_write(spi, 0x01));
+
+    /* In place */
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_transfer_buf(spi, tx, tx, 3));
+    ASSERT_EQ(0x01 ^ 0xD5, tx[0]);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_lsbmode(spi, 0));
+    ASSERT_EQ(0x01 ^ MOCK_SPI_REPLY_BYTE, mraa_spi_write(spi, 0x01));
+}
+
+TEST_F(mraa_spi_h_unit, test_word_order)
+{
+    uint16_t tx[] = { 0x1234, 0x0001 };
+    uint16_t rx[2] = { 0 };
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_word_order(spi, MRAA_SPI_WORD_MSB_FIRST));
+    /* The words go out byte swapped, so the reply is swapped back */
+    ASSERT_EQ(0x1234 ^ 0xBAAB, mraa_spi_write_word(spi, 0x1234));
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_transfer_buf_word(spi, tx, rx, sizeof(tx)));
+    ASSERT_EQ(0x1234 ^ 0xBAAB, rx[0]);
+    ASSERT_EQ(0x0001 ^ 0xBAAB, rx[1]);
+    ASSERT_EQ(0x1234, tx[0]);
+
+    ASSERT_EQ(MRAA_SUCCESS, mraa_spi_word_order(spi, MRAA_SPI_WORD_NATIVE));
+    ASSERT_EQ(0x1234 ^ 0xABBA, mraa_spi_write_word(spi, 0x1234));
+
+    ASSERT_EQ(MRAA_ERROR_INVALID_PARAMETER, mraa_spi_word_order(spi, (mraa_spi_word_order_t) 3));
+}
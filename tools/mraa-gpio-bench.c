@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018 Intel Corporation.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * Measures calls per second of the sysfs gpio value path, the way it was
+ * done before (lseek + read/write) against what mraa does now (pread/pwrite).
+ * Runs against a fake 'value' node on tmpfs so no board is needed and the
+ * numbers only reflect the syscall overhead on our side.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mraa/gpio.h"
+#include "mraa_internal.h"
+
+#define DEFAULT_ROOT "/dev/shm"
+#define DEFAULT_ITERATIONS 1000000
+
+static int
+old_read(int fd)
+{
+    char bu[2];
+
+    lseek(fd, 0, SEEK_SET);
+    if (read(fd, bu, 2 * sizeof(char)) != 2) {
+        return -1;
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    return (int) strtol(bu, NULL, 10);
+}
+
+static int
+old_write(int fd, int value)
+{
+    char bu[64];
+
+    if (lseek(fd, 0, SEEK_SET) == -1) {
+        return -1;
+    }
+    int length = snprintf(bu, sizeof(bu), "%d", value);
+    if (write(fd, bu, length * sizeof(char)) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+report(const char* name, long iterations, double start, int failed)
+{
+    double elapsed = now() - start;
+    if (failed) {
+        fprintf(stdout, "%-12s failed\n", name);
+        return;
+    }
+    fprintf(stdout, "%-12s %12.0f calls/s\n", name, iterations / elapsed);
+}
+
+int
+main(int argc, char** argv)
+{
+    const char* root = argc > 1 ? argv[1] : DEFAULT_ROOT;
+    long iterations = argc > 2 ? atol(argv[2]) : DEFAULT_ITERATIONS;
+    char path[256];
+    double start;
+    long i;
+    int failed;
+
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [tmpfs dir] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* mraa_gpio_read/write look at the platform, an unknown one is fine. */
+    mraa_init();
+    if (plat == NULL) {
+        fprintf(stderr, "No platform structure, cannot run the mraa path\n");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(path, sizeof(path), "%s/mraa-gpio-bench-%d", root, (int) getpid());
+    if (mkdir(path, 0700) != 0) {
+        fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    strncat(path, "/value", sizeof(path) - strlen(path) - 1);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1 || write(fd, "0\n", 2) != 2) {
+        fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* A sysfs context without any platform hooks, bound to the fake node. */
+    struct _gpio ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.value_fp = fd;
+    ctx.isr_value_fp = -1;
+    ctx.phy_pin = -1;
+    ctx.num_pins = 1;
+
+    fprintf(stdout, "%ld iterations on %s\n", iterations, path);
+
+    failed = 0;
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        failed |= old_write(fd, i & 1) != 0;
+    }
+    report("old write", iterations, start, failed);
+
+    failed = 0;
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        failed |= mraa_gpio_write(&ctx, i & 1) != MRAA_SUCCESS;
+    }
+    report("mraa write", iterations, start, failed);
+
+    failed = 0;
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        failed |= old_read(fd) < 0;
+    }
+    report("old read", iterations, start, failed);
+
+    failed = 0;
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        failed |= mraa_gpio_read(&ctx) < 0;
+    }
+    report("mraa read", iterations, start, failed);
+
+    close(fd);
+    unlink(path);
+    *strrchr(path, '/') = '\0';
+    rmdir(path);
+
+    return EXIT_SUCCESS;
+}